@@ -0,0 +1,53 @@
+#!/bin/sh
+#
+# Time the machines of a ragel file in every C code style, using the driver
+# written by ragel --bench.
+#
+# usage: ragel-bench.sh <file.rl> <corpus> [iterations] [ragel options]
+#
+# RAGEL, CC and CFLAGS are taken from the environment. STYLES gives the code
+# styles to time, all of them by default. PERF, if given, is a command to run
+# each driver under, such as "perf stat -e L1-icache-load-misses". Its report
+# goes to stderr.
+
+if [ $# -lt 2 ]; then
+	echo "usage: $0 <file.rl> <corpus> [iterations] [ragel options]" >&2
+	exit 2
+fi
+
+input=$1
+corpus=$2
+shift 2
+iterations=10
+if [ $# -gt 0 ]; then
+	iterations=$1
+	shift
+fi
+
+: ${RAGEL:=ragel}
+: ${CC:=cc}
+: ${CFLAGS:=-O2}
+: ${STYLES:=-T0 -T1 -T2 -F0 -F1 -G0 -G1 -G2}
+
+work=`mktemp -d` || exit 1
+trap 'rm -rf "$work"' 0
+
+printf '%-6s %-20s %10s %10s\n' style machine "MB/s" "ns/byte"
+
+for style in $STYLES; do
+	if ! $RAGEL $style "$@" --bench="$work/bench.c" -o "$work/out.c" "$input"; then
+		echo "$style: ragel failed" >&2
+		continue
+	fi
+	if ! $CC $CFLAGS -o "$work/bench" "$work/bench.c"; then
+		echo "$style: compile failed" >&2
+		continue
+	fi
+	if [ -n "$PERF" ]; then
+		echo "$style:" >&2
+	fi
+	$PERF "$work/bench" "$corpus" $iterations | awk -v style=$style '{
+		name = $1; sub( ":$", "", name );
+		printf "%-6s %-20s %10s %10s\n", style, name, $7, $9
+	}'
+done
@@ -0,0 +1,50 @@
+#!/bin/sh
+#
+# List the tables in C code written by ragel, with the number of entries and
+# the bytes each takes, and their total. Compares the footprint of code styles
+# and table options, such as -F0 with and without --byte-classes.
+#
+# usage: ragel-tables.sh <file.c>
+#
+# Sizes are those of the types on a machine with 2 byte shorts, 4 byte ints
+# and 8 byte longs.
+
+if [ $# -ne 1 ]; then
+	echo "usage: $0 <file.c>" >&2
+	exit 2
+fi
+
+awk '
+/^static const .*\[\] = {$/ {
+	line = $0
+	sub( "^static const ", "", line )
+	sub( "\\[\\] = {$", "", line )
+	name = line
+	sub( ".* ", "", name )
+	type = substr( line, 1, length( line ) - length( name ) - 1 )
+	sub( "^(un)?signed ", "", type )
+	width = 1
+	if ( type == "short" )
+		width = 2
+	else if ( type == "int" )
+		width = 4
+	else if ( type == "long" || type == "long long" )
+		width = 8
+	entries = 0
+	inTable = 1
+	next
+}
+inTable && /^};$/ {
+	printf "%-32s %-10s %10d %10d\n", name, type, entries, entries * width
+	total += entries * width
+	inTable = 0
+	next
+}
+inTable {
+	entries += gsub( ",", "," )
+	if ( $0 !~ /,[ \t]*$/ && $0 ~ /[^ \t]/ )
+		entries += 1
+}
+END {
+	printf "%-32s %-10s %10s %10d\n", "total", "", "", total
+}' "$1"
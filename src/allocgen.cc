@@ -35,6 +35,7 @@
 
 #include "c/binloop.h"
 #include "c/binexp.h"
+#include "c/denseloop.h"
 #include "c/flatloop.h"
 #include "c/flatexp.h"
 #include "c/gotoloop.h"
@@ -90,18 +91,20 @@
 using std::cerr;
 using std::endl;
 
-/* Invoked by the parser when a ragel definition is opened. */
-CodeGenData *cMakeCodeGen( const CodeGenArgs &args )
+static CodeGenData *cAllocCodeGen( CodeStyle style, const CodeGenArgs &args )
 {
 	CodeGenData *codeGen = 0;
 
-	switch ( codeStyle ) {
+	switch ( style ) {
 	case GenTables:
 		codeGen = new C::BinaryLooped(args);
 		break;
 	case GenFTables:
 		codeGen = new C::BinaryExpanded(args);
 		break;
+	case GenDense:
+		codeGen = new C::DenseLooped(args);
+		break;
 	case GenFlat:
 		codeGen = new C::FlatLooped(args);
 		break;
@@ -120,11 +123,99 @@ CodeGenData *cMakeCodeGen( const CodeGenArgs &args )
 	case GenSplit:
 //		codeGen = new C::SplitGoto(args);
 		break;
+	case GenAuto:
+		break;
 	}
 
 	return codeGen;
 }
 
+/* The styles tried by --style=auto, fastest first. */
+static const CodeStyle autoStyles[] = {
+	GenIpGoto, GenFGoto, GenGoto, GenDense, GenFFlat, GenFlat,
+	GenFTables, GenTables
+};
+static const char *autoStyleNames[] = {
+	"-G2", "-G1", "-G0", "-T2", "-F1", "-F0", "-T1", "-T0"
+};
+static const int numAutoStyles = sizeof(autoStyles) / sizeof(autoStyles[0]);
+
+/* Build the machine with each style, writing its data nowhere, and take the
+ * first whose tables and estimated code fit in the budget. If none fit, the
+ * smallest. Diagnostics of the trials are dropped, the chosen style reports
+ * them when it is built for real. */
+static CodeStyle cChooseCodeStyle( const CodeGenArgs &args )
+{
+	ErrorBuffer *prevBuffer = getErrorBuffer();
+
+	int chosen = -1, smallest = -1;
+	long long sizes[numAutoStyles];
+	for ( int s = 0; s < numAutoStyles; s++ ) {
+		output_filter discardBuf( args.sourceFileName );
+		std::ostream discard( &discardBuf );
+		CodeGenArgs trialArgs( args.inputData, args.sourceFileName,
+				args.fsmName, args.pd, args.fsm, discard );
+
+		ErrorBuffer trialBuffer;
+		setErrorBuffer( &trialBuffer );
+
+		C::CodeGen *trial = static_cast<C::CodeGen*>(
+				cAllocCodeGen( autoStyles[s], trialArgs ) );
+		trial->make();
+
+		long long tables = 0, code = 0;
+		if ( trialBuffer.errorCount == 0 ) {
+			trial->writeData();
+			tables = trial->tableFootprint();
+			code = trial->codeFootprint();
+		}
+
+		delete trial;
+		setErrorBuffer( prevBuffer );
+
+		/* A style that failed has written nothing, so it has no size. */
+		if ( trialBuffer.errorCount != 0 ) {
+			if ( printStatistics )
+				cerr << "style " << autoStyleNames[s] << ": failed" << endl;
+			continue;
+		}
+
+		sizes[s] = tables + code;
+		if ( smallest < 0 || sizes[s] < sizes[smallest] )
+			smallest = s;
+		if ( chosen < 0 && ( styleBudget == 0 || sizes[s] <= styleBudget ) )
+			chosen = s;
+
+		if ( printStatistics ) {
+			cerr << "style " << autoStyleNames[s] << ": tables " << tables <<
+					", code " << code << ", total " << sizes[s] << endl;
+		}
+	}
+
+	/* If every style failed, the real build reports the errors. */
+	if ( chosen < 0 )
+		chosen = smallest < 0 ? 0 : smallest;
+
+	if ( printStatistics ) {
+		cerr << "style chosen: " << autoStyleNames[chosen];
+		if ( styleBudget > 0 )
+			cerr << " (budget " << styleBudget << ")";
+		cerr << endl;
+	}
+
+	return autoStyles[chosen];
+}
+
+/* Invoked by the parser when a ragel definition is opened. */
+CodeGenData *cMakeCodeGen( const CodeGenArgs &args )
+{
+	CodeStyle style = codeStyle;
+	if ( style == GenAuto )
+		style = cChooseCodeStyle( args );
+
+	return cAllocCodeGen( style, args );
+}
+
 ///* Invoked by the parser when a ragel definition is opened. */
 //CodeGenData *dMakeCodeGen( const CodeGenArgs &args )
 //{
@@ -361,6 +452,18 @@ CodeGenData *cMakeCodeGen( const CodeGenArgs &args )
 //	return codeGen;
 //}
 
+void writeBenchHeader( std::ostream &out )
+{
+	if ( hostLang == &hostLangC )
+		C::writeBenchHeader( out );
+}
+
+void writeBenchDriver( std::ostream &out, const std::string &entries )
+{
+	if ( hostLang == &hostLangC )
+		C::writeBenchDriver( out, entries );
+}
+
 CodeGenData *makeCodeGen( const CodeGenArgs &args )
 {
 	CodeGenData *cgd = 0;
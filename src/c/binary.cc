@@ -53,7 +53,10 @@ Binary::Binary( const CodeGenArgs &args )
 	eofTransIndexed(    "eof_trans_indexed",     *this ),
 	actions(            "actions",               *this ),
 	keys(               "trans_keys",            *this ),
-	condKeys(           "cond_keys",             *this )
+	condKeys(           "cond_keys",             *this ),
+	condKeysWi(         "cond_keys_wi",          *this ),
+	condTargsWi(        "cond_targs_wi",         *this ),
+	condActionsWi(      "cond_actions_wi",       *this )
 {
 }
 
@@ -183,24 +186,18 @@ void Binary::taEofTransDirect()
 
 void Binary::taEofTransIndexed()
 {
-	/* Transitions must be written ordered by their id. */
-	long t = 0, *transPos = new long[redFsm->transSet.length()];
-	for ( TransApSet::Iter trans = redFsm->transSet; trans.lte(); trans++ )
-		transPos[trans->id] = t++;
-
 	eofTransIndexed.start();
 
+	/* The indexed transitions are written ordered by their id. */
 	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
 		long trans = 0;
 		if ( st->eofTrans != 0 )
-			trans = transPos[st->eofTrans->id] + 1;
+			trans = st->eofTrans->id + 1;
 
 		eofTransIndexed.value( trans );
 	}
 
 	eofTransIndexed.finish();
-
-	delete[] transPos;
 }
 
 void Binary::taKeys()
@@ -373,13 +370,21 @@ void Binary::taTransCondSpacesWi()
 {
 	transCondSpacesWi.start();
 
-	for ( TransApSet::Iter trans = redFsm->transSet; trans.lte(); trans++ ) {
+	/* Transitions must be written ordered by their id. */
+	RedTransAp **transPtrs = new RedTransAp*[redFsm->transSet.length()];
+	for ( TransApSet::Iter trans = redFsm->transSet; trans.lte(); trans++ )
+		transPtrs[trans->id] = trans;
+
+	for ( int t = 0; t < redFsm->transSet.length(); t++ ) {
+		RedTransAp *trans = transPtrs[t];
+
 		/* Cond Space id. */
 		if ( trans->condSpace != 0 )
 			transCondSpacesWi.value( trans->condSpace->condSpaceId );
 		else
 			transCondSpacesWi.value( -1 );
 	}
+	delete[] transPtrs;
 
 	transCondSpacesWi.finish();
 }
@@ -388,15 +393,19 @@ void Binary::taTransOffsetsWi()
 {
 	transOffsetsWi.start();
 
-	int curOffset = 0;
-	for ( TransApSet::Iter trans = redFsm->transSet; trans.lte(); trans++ ) {
-		transOffsetsWi.value( curOffset );
+	/* Transitions must be written ordered by their id. */
+	RedTransAp **transPtrs = new RedTransAp*[redFsm->transSet.length()];
+	for ( TransApSet::Iter trans = redFsm->transSet; trans.lte(); trans++ )
+		transPtrs[trans->id] = trans;
 
-		TransApSet::Iter next = trans;
-		next.increment();
+	int curOffset = 0;
+	for ( int t = 0; t < redFsm->transSet.length(); t++ ) {
+		RedTransAp *trans = transPtrs[t];
 
+		transOffsetsWi.value( curOffset );
 		curOffset += trans->outConds.length();
 	}
+	delete[] transPtrs;
 
 	transOffsetsWi.finish();
 }
@@ -405,16 +414,81 @@ void Binary::taTransLengthsWi()
 {
 	transLengthsWi.start();
 
-	for ( TransApSet::Iter trans = redFsm->transSet; trans.lte(); trans++ ) {
-		transLengthsWi.value( trans->outConds.length() );
+	/* Transitions must be written ordered by their id. */
+	RedTransAp **transPtrs = new RedTransAp*[redFsm->transSet.length()];
+	for ( TransApSet::Iter trans = redFsm->transSet; trans.lte(); trans++ )
+		transPtrs[trans->id] = trans;
 
-		TransApSet::Iter next = trans;
-		next.increment();
+	for ( int t = 0; t < redFsm->transSet.length(); t++ ) {
+		RedTransAp *trans = transPtrs[t];
+		transLengthsWi.value( trans->outConds.length() );
 	}
+	delete[] transPtrs;
 
 	transLengthsWi.finish();
 }
 
+void Binary::taCondKeysWi()
+{
+	condKeysWi.start();
+
+	/* Transitions must be written ordered by their id. */
+	RedTransAp **transPtrs = new RedTransAp*[redFsm->transSet.length()];
+	for ( TransApSet::Iter trans = redFsm->transSet; trans.lte(); trans++ )
+		transPtrs[trans->id] = trans;
+
+	for ( int t = 0; t < redFsm->transSet.length(); t++ ) {
+		RedTransAp *trans = transPtrs[t];
+		for ( RedCondList::Iter cond = trans->outConds; cond.lte(); cond++ )
+			condKeysWi.value( cond->key.getVal() );
+	}
+	delete[] transPtrs;
+
+	condKeysWi.finish();
+}
+
+void Binary::taCondTargsWi()
+{
+	condTargsWi.start();
+
+	/* Transitions must be written ordered by their id. */
+	RedTransAp **transPtrs = new RedTransAp*[redFsm->transSet.length()];
+	for ( TransApSet::Iter trans = redFsm->transSet; trans.lte(); trans++ )
+		transPtrs[trans->id] = trans;
+
+	for ( int t = 0; t < redFsm->transSet.length(); t++ ) {
+		RedTransAp *trans = transPtrs[t];
+		for ( RedCondList::Iter cond = trans->outConds; cond.lte(); cond++ ) {
+			RedCondAp *c = cond->value;
+			condTargsWi.value( c->targ->id );
+		}
+	}
+	delete[] transPtrs;
+
+	condTargsWi.finish();
+}
+
+void Binary::taCondActionsWi()
+{
+	condActionsWi.start();
+
+	/* Transitions must be written ordered by their id. */
+	RedTransAp **transPtrs = new RedTransAp*[redFsm->transSet.length()];
+	for ( TransApSet::Iter trans = redFsm->transSet; trans.lte(); trans++ )
+		transPtrs[trans->id] = trans;
+
+	for ( int t = 0; t < redFsm->transSet.length(); t++ ) {
+		RedTransAp *trans = transPtrs[t];
+		for ( RedCondList::Iter cond = trans->outConds; cond.lte(); cond++ ) {
+			RedCondAp *c = cond->value;
+			COND_ACTION( condActionsWi, c );
+		}
+	}
+	delete[] transPtrs;
+
+	condActionsWi.finish();
+}
+
 void Binary::taCondKeys()
 {
 	condKeys.start();
@@ -511,7 +585,7 @@ void Binary::taCondActions()
 			RedTransAp *trans = stel->value;
 			for ( RedCondList::Iter cond = trans->outConds; cond.lte(); cond++ ) {
 				RedCondAp *c = cond->value;
-				COND_ACTION( c );
+				COND_ACTION( condActions, c );
 			}
 		}
 
@@ -520,7 +594,7 @@ void Binary::taCondActions()
 			RedTransAp *trans = rtel->value;
 			for ( RedCondList::Iter cond = trans->outConds; cond.lte(); cond++ ) {
 				RedCondAp *c = cond->value;
-				COND_ACTION( c );
+				COND_ACTION( condActions, c );
 			}
 		}
 
@@ -529,7 +603,7 @@ void Binary::taCondActions()
 			RedTransAp *trans = st->defTrans;
 			for ( RedCondList::Iter cond = trans->outConds; cond.lte(); cond++ ) {
 				RedCondAp *c = cond->value;
-				COND_ACTION( c );
+				COND_ACTION( condActions, c );
 			}
 		}
 	}
@@ -540,7 +614,7 @@ void Binary::taCondActions()
 			RedTransAp *trans = st->eofTrans;
 			for ( RedCondList::Iter cond = trans->outConds; cond.lte(); cond++ ) {
 				RedCondAp *c = cond->value;
-				COND_ACTION( c );
+				COND_ACTION( condActions, c );
 			}
 		}
 	}
@@ -593,13 +667,15 @@ void Binary::taActions()
 }
 
 
-void Binary::LOCATE_TRANS()
+/* Find the transition taken from the state in cs on key, leaving its index in
+ * _trans and going to the match label when found among the keys. */
+void Binary::LOCATE_TRANS_KEY( string cs, string key, string match )
 {
 	out <<
-		"	_keys = " << ARR_REF( keys ) << " + " << ARR_REF( keyOffsets ) << "[" << vCS() << "]" << ";\n"
-		"	_trans = " << ARR_REF( indexOffsets ) << "[" << vCS() << "];\n"
+		"	_keys = " << ARR_REF( keys ) << " + " << ARR_REF( keyOffsets ) << "[" << cs << "]" << ";\n"
+		"	_trans = " << ARR_REF( indexOffsets ) << "[" << cs << "];\n"
 		"\n"
-		"	_klen = " << ARR_REF( singleLens ) << "[" << vCS() << "];\n"
+		"	_klen = " << ARR_REF( singleLens ) << "[" << cs << "];\n"
 		"	if ( _klen > 0 ) {\n"
 		"		const " << ALPH_TYPE() << " *_lower = _keys;\n"
 		"		const " << ALPH_TYPE() << " *_mid;\n"
@@ -609,20 +685,20 @@ void Binary::LOCATE_TRANS()
 		"				break;\n"
 		"\n"
 		"			_mid = _lower + ((_upper-_lower) >> 1);\n"
-		"			if ( " << GET_KEY() << " < *_mid )\n"
+		"			if ( " << key << " < *_mid )\n"
 		"				_upper = _mid - 1;\n"
-		"			else if ( " << GET_KEY() << " > *_mid )\n"
+		"			else if ( " << key << " > *_mid )\n"
 		"				_lower = _mid + 1;\n"
 		"			else {\n"
 		"				_trans += " << "(unsigned int)" << "(_mid - _keys);\n"
-		"				goto _match;\n"
+		"				goto " << match << ";\n"
 		"			}\n"
 		"		}\n"
 		"		_keys += _klen;\n"
 		"		_trans += _klen;\n"
 		"	}\n"
 		"\n"
-		"	_klen = " << ARR_REF( rangeLens ) << "[" << vCS() << "];\n"
+		"	_klen = " << ARR_REF( rangeLens ) << "[" << cs << "];\n"
 		"	if ( _klen > 0 ) {\n"
 		"		const " << ALPH_TYPE() << " *_lower = _keys;\n"
 		"		const " << ALPH_TYPE() << " *_mid;\n"
@@ -632,13 +708,13 @@ void Binary::LOCATE_TRANS()
 		"				break;\n"
 		"\n"
 		"			_mid = _lower + (((_upper-_lower) >> 1) & ~1);\n"
-		"			if ( " << GET_KEY() << " < _mid[0] )\n"
+		"			if ( " << key << " < _mid[0] )\n"
 		"				_upper = _mid - 2;\n"
-		"			else if ( " << GET_KEY() << " > _mid[1] )\n"
+		"			else if ( " << key << " > _mid[1] )\n"
 		"				_lower = _mid + 2;\n"
 		"			else {\n"
 		"				_trans += " << "(unsigned int)" << "((_mid - _keys)>>1);\n"
-		"				goto _match;\n"
+		"				goto " << match << ";\n"
 		"			}\n"
 		"		}\n"
 		"		_trans += _klen;\n"
@@ -646,17 +722,51 @@ void Binary::LOCATE_TRANS()
 		"\n";
 }
 
+void Binary::LOCATE_TRANS()
+{
+	LOCATE_TRANS_KEY( vCS(), GET_KEY(), "_match" );
+}
+
+/* Without conditions a transition has a single target. */
+void Binary::STREAM_STEP( string cs, string p, string suffix )
+{
+	out <<
+		"	{\n"
+		"	int _klen;\n"
+		"	unsigned int _trans;\n"
+		"	const " << ALPH_TYPE() << " *_keys;\n";
+
+	LOCATE_TRANS_KEY( cs, "(*" + p + ")", "_match" + suffix );
+
+	out << "_match" << suffix << ":\n";
+
+	if ( useIndicies )
+		out << "	_trans = " << ARR_REF( indicies ) << "[_trans];\n";
+
+	TableArray &targs = useIndicies ? condTargsWi : condTargs;
+	TableArray &offsets = useIndicies ? transOffsetsWi : transOffsets;
+	out <<
+		"	" << cs << " = " << ARR_REF( targs ) << "[" <<
+				ARR_REF( offsets ) << "[_trans]];\n"
+		"	}\n";
+}
+
 void Binary::LOCATE_COND()
 {
+	TableArray &ckeys = useIndicies ? condKeysWi : condKeys;
+	TableArray &offsets = useIndicies ? transOffsetsWi : transOffsets;
+	TableArray &lengths = useIndicies ? transLengthsWi : transLengths;
+	TableArray &spaces = useIndicies ? transCondSpacesWi : transCondSpaces;
+
 	out <<
-		"	_ckeys = " << ARR_REF( condKeys ) << " + " << ARR_REF( transOffsets ) << "[_trans];\n"
-		"	_klen = " << ARR_REF( transLengths ) << "[_trans];\n"
-		"	_cond = " << ARR_REF( transOffsets ) << "[_trans];\n"
+		"	_ckeys = " << ARR_REF( ckeys ) << " + " << ARR_REF( offsets ) << "[_trans];\n"
+		"	_klen = " << ARR_REF( lengths ) << "[_trans];\n"
+		"	_cond = " << ARR_REF( offsets ) << "[_trans];\n"
 		"\n";
 
 	out <<
 		"	_cpc = 0;\n"
-		"	switch ( " << ARR_REF( transCondSpaces ) << "[_trans] ) {\n"
+		"	switch ( " << ARR_REF( spaces ) << "[_trans] ) {\n"
 		"\n";
 
 	for ( CondSpaceList::Iter csi = condSpaceList; csi.lte(); csi++ ) {
@@ -679,9 +789,9 @@ void Binary::LOCATE_COND()
 	
 	out <<
 		"	{\n"
-		"		const " << ARR_TYPE( condKeys ) << " *_lower = _ckeys;\n"
-		"		const " << ARR_TYPE( condKeys ) << " *_mid;\n"
-		"		const " << ARR_TYPE( condKeys ) << " *_upper = _ckeys + _klen - 1;\n"
+		"		const " << ARR_TYPE( ckeys ) << " *_lower = _ckeys;\n"
+		"		const " << ARR_TYPE( ckeys ) << " *_mid;\n"
+		"		const " << ARR_TYPE( ckeys ) << " *_upper = _ckeys + _klen - 1;\n"
 		"		while (1) {\n"
 		"			if ( _upper < _lower )\n"
 		"				break;\n"
@@ -63,6 +63,9 @@ protected:
 	TableArray actions;
 	TableArray keys;
 	TableArray condKeys;
+	TableArray condKeysWi;
+	TableArray condTargsWi;
+	TableArray condActionsWi;
 
 	std::ostream &COND_KEYS_v1();
 	std::ostream &COND_SPACES_v1();
@@ -94,12 +97,19 @@ protected:
 	void taKeys();
 	void taActions();
 	void taCondKeys();
+	void taCondKeysWi();
+	void taCondTargsWi();
+	void taCondActionsWi();
 
 	void setKeyType();
 
+	void LOCATE_TRANS_KEY( string cs, string key, string match );
 	void LOCATE_TRANS();
 	void LOCATE_COND();
 
+	virtual bool streamable() { return true; }
+	virtual void STREAM_STEP( string cs, string p, string suffix );
+
 	void GOTO( ostream &ret, int gotoDest, bool inFinish );
 	void CALL( ostream &ret, int callDest, int targState, bool inFinish );
 	void NEXT( ostream &ret, int nextDest, bool inFinish );
@@ -114,7 +124,7 @@ protected:
 	virtual void TO_STATE_ACTION( RedStateAp *state ) = 0;
 	virtual void FROM_STATE_ACTION( RedStateAp *state ) = 0;
 	virtual void EOF_ACTION( RedStateAp *state ) = 0;
-	virtual void COND_ACTION( RedCondAp *cond ) = 0;
+	virtual void COND_ACTION( TableArray &table, RedCondAp *cond ) = 0;
 
 	void setTableState( TableArray::State );
 };
@@ -34,22 +34,31 @@ BinaryExpanded::BinaryExpanded( const CodeGenArgs &args )
 {
 }
 
-/* Determine if we should use indicies or not. */
+/* Determine if we should use indicies or not. Choosing them by size is
+ * left off and the direct tables are always written. */
 void BinaryExpanded::calcIndexSize()
 {
+#if 0
 	long long sizeWithInds =
 		indicies.size() +
 		transCondSpacesWi.size() +
 		transOffsetsWi.size() +
-		transLengthsWi.size();
+		transLengthsWi.size() +
+		condKeysWi.size() +
+		condTargsWi.size() +
+		condActionsWi.size();
 
 	long long sizeWithoutInds =
 		transCondSpaces.size() +
 		transOffsets.size() +
-		transLengths.size();
-
-	std::cerr << "sizes: " << sizeWithInds << " " << sizeWithoutInds << std::endl;
-
+		transLengths.size() +
+		condKeys.size() +
+		condTargs.size() +
+		condActions.size();
+
+	/* If using indicies reduces the size, use them. */
+	useIndicies = sizeWithInds < sizeWithoutInds;
+#endif
 	useIndicies = false;
 }
 
@@ -64,6 +73,8 @@ void BinaryExpanded::tableDataPass()
 	taTransCondSpacesWi();
 	taTransOffsetsWi();
 	taTransLengthsWi();
+	taCondTargsWi();
+	taCondActionsWi();
 
 	taTransCondSpaces();
 	taTransOffsets();
@@ -80,6 +91,7 @@ void BinaryExpanded::tableDataPass()
 	taEofTransIndexed();
 
 	taKeys();
+	taCondKeysWi();
 	taCondKeys();
 }
 
@@ -88,7 +100,10 @@ void BinaryExpanded::genAnalysis()
 	redFsm->sortByStateId();
 
 	/* Choose default transitions and the single transition. */
-	redFsm->chooseDefaultSpan();
+	if ( redFsm->profiled )
+		redFsm->chooseDefaultProfile();
+	else
+		redFsm->chooseDefaultSpan();
 		
 	/* Choose single. */
 	redFsm->chooseSingle();
@@ -116,12 +131,12 @@ void BinaryExpanded::genAnalysis()
 }
 
 
-void BinaryExpanded::COND_ACTION( RedCondAp *cond )
+void BinaryExpanded::COND_ACTION( TableArray &table, RedCondAp *cond )
 {
 	int action = 0;
 	if ( cond->action != 0 )
 		action = cond->action->actListId+1;
-	condActions.value( action );
+	table.value( action );
 }
 
 void BinaryExpanded::TO_STATE_ACTION( RedStateAp *state )
@@ -249,17 +264,19 @@ void BinaryExpanded::writeData()
 		taTransCondSpacesWi();
 		taTransOffsetsWi();
 		taTransLengthsWi();
+		taCondKeysWi();
+		taCondTargsWi();
+		taCondActionsWi();
 	}
 	else {
 		taTransCondSpaces();
 		taTransOffsets();
 		taTransLengths();
+		taCondKeys();
+		taCondTargs();
+		taCondActions();
 	}
 
-	taCondKeys();
-	taCondTargs();
-	taCondActions();
-
 	if ( redFsm->anyToStateActions() )
 		taToStateActions();
 
@@ -292,7 +309,7 @@ void BinaryExpanded::writeExec()
 	out <<
 		";\n"
 		"	const " << ALPH_TYPE() << " *_keys;\n"
-		"	const " << ARR_TYPE( condKeys ) << " *_ckeys;\n"
+		"	const " << ARR_TYPE( useIndicies ? condKeysWi : condKeys ) << " *_ckeys;\n"
 		"	int _cpc;\n"
 		"	int _trans;\n"
 		"	unsigned int _cond;\n";
@@ -323,6 +340,9 @@ void BinaryExpanded::writeExec()
 			"\n";
 	}
 
+	SKIP_LOOPS();
+	PROFILE_COUNT( vCS() );
+	LITERAL_RUNS();
 	LOCATE_TRANS();
 
 	out << "_match:\n";
@@ -340,16 +360,18 @@ void BinaryExpanded::writeExec()
 	if ( redFsm->anyRegCurStateRef() )
 		out << "	_ps = " << vCS() << ";\n";
 
+	TableArray &targs = useIndicies ? condTargsWi : condTargs;
+	TableArray &acts = useIndicies ? condActionsWi : condActions;
 	out <<
-		"	" << vCS() << " = " << ARR_REF( condTargs ) << "[_cond];\n"
+		"	" << vCS() << " = " << ARR_REF( targs ) << "[_cond];\n"
 		"\n";
 
 	if ( redFsm->anyRegActions() ) {
 		out << 
-			"	if ( " << ARR_REF( condActions ) << "[_cond] == 0 )\n"
+			"	if ( " << ARR_REF( acts ) << "[_cond] == 0 )\n"
 			"		goto _again;\n"
 			"\n"
-			"	switch ( " << ARR_REF( condActions ) << "[_cond] ) {\n";
+			"	switch ( " << ARR_REF( acts ) << "[_cond] ) {\n";
 			ACTION_SWITCH() <<
 			"	}\n"
 			"\n";
@@ -398,7 +420,7 @@ void BinaryExpanded::writeExec()
 			out <<
 				"	if ( " << ARR_REF( eofTrans ) << "[" << vCS() << "] > 0 ) {\n"
 				"		_trans = " << ARR_REF( eofTrans ) << "[" << vCS() << "] - 1;\n"
-				"		_cond = " << ARR_REF( transOffsets ) << "[_trans];\n"
+				"		_cond = " << ARR_REF( useIndicies ? transOffsetsWi : transOffsets ) << "[_trans];\n"
 				"		goto _eof_trans;\n"
 				"	}\n";
 		}
@@ -53,7 +53,7 @@ protected:
 	virtual void TO_STATE_ACTION( RedStateAp *state );
 	virtual void FROM_STATE_ACTION( RedStateAp *state );
 	virtual void EOF_ACTION( RedStateAp *state );
-	virtual void COND_ACTION( RedCondAp *cond );
+	virtual void COND_ACTION( TableArray &table, RedCondAp *cond );
 
 };
 
@@ -33,24 +33,31 @@ BinaryLooped::BinaryLooped( const CodeGenArgs &args )
 	Binary( args )
 {}
 
-/* Determine if we should use indicies or not. */
+/* Determine if we should use indicies or not. Choosing them by size is
+ * left off and the direct tables are always written. */
 void BinaryLooped::calcIndexSize()
 {
+#if 0
 	long long sizeWithInds =
 		indicies.size() +
 		transCondSpacesWi.size() +
 		transOffsetsWi.size() +
-		transLengthsWi.size();
+		transLengthsWi.size() +
+		condKeysWi.size() +
+		condTargsWi.size() +
+		condActionsWi.size();
 
 	long long sizeWithoutInds =
 		transCondSpaces.size() +
 		transOffsets.size() +
-		transLengths.size();
-
-	std::cerr << "sizes: " << sizeWithInds << " " << sizeWithoutInds << std::endl;
-
-	///* If using indicies reduces the size, use them. */
-	//useIndicies = sizeWithInds < sizeWithoutInds;
+		transLengths.size() +
+		condKeys.size() +
+		condTargs.size() +
+		condActions.size();
+
+	/* If using indicies reduces the size, use them. */
+	useIndicies = sizeWithInds < sizeWithoutInds;
+#endif
 	useIndicies = false;
 }
 
@@ -67,6 +74,8 @@ void BinaryLooped::tableDataPass()
 	taTransCondSpacesWi();
 	taTransOffsetsWi();
 	taTransLengthsWi();
+	taCondTargsWi();
+	taCondActionsWi();
 
 	taTransCondSpaces();
 	taTransOffsets();
@@ -83,6 +92,7 @@ void BinaryLooped::tableDataPass()
 	taEofTransIndexed();
 
 	taKeys();
+	taCondKeysWi();
 	taCondKeys();
 }
 
@@ -91,7 +101,10 @@ void BinaryLooped::genAnalysis()
 	redFsm->sortByStateId();
 
 	/* Choose default transitions and the single transition. */
-	redFsm->chooseDefaultSpan();
+	if ( redFsm->profiled )
+		redFsm->chooseDefaultProfile();
+	else
+		redFsm->chooseDefaultSpan();
 		
 	/* Choose the singles. */
 	redFsm->chooseSingle();
@@ -119,12 +132,12 @@ void BinaryLooped::genAnalysis()
 }
 
 
-void BinaryLooped::COND_ACTION( RedCondAp *cond )
+void BinaryLooped::COND_ACTION( TableArray &table, RedCondAp *cond )
 {
 	int act = 0;
 	if ( cond->action != 0 )
 		act = cond->action->location+1;
-	condActions.value( act );
+	table.value( act );
 }
 
 void BinaryLooped::TO_STATE_ACTION( RedStateAp *state )
@@ -239,18 +252,19 @@ void BinaryLooped::writeData()
 		taTransCondSpacesWi();
 		taTransOffsetsWi();
 		taTransLengthsWi();
+		taCondKeysWi();
+		taCondTargsWi();
+		taCondActionsWi();
 	}
 	else {
 		taTransCondSpaces();
 		taTransOffsets();
 		taTransLengths();
+		taCondKeys();
+		taCondTargs();
+		taCondActions();
 	}
 
-	taCondKeys();
-
-	taCondTargs();
-	taCondActions();
-
 	if ( redFsm->anyToStateActions() )
 		taToStateActions();
 
@@ -295,7 +309,7 @@ void BinaryLooped::writeExec()
 
 	out <<
 		"	const " << ALPH_TYPE() << " *_keys;\n"
-		"	const " << ARR_TYPE( condKeys ) << " *_ckeys;\n"
+		"	const " << ARR_TYPE( useIndicies ? condKeysWi : condKeys ) << " *_ckeys;\n"
 		"	int _cpc;\n"
 		"\n";
 
@@ -328,6 +342,9 @@ void BinaryLooped::writeExec()
 			"\n";
 	}
 
+	SKIP_LOOPS();
+	PROFILE_COUNT( vCS() );
+	LITERAL_RUNS();
 	LOCATE_TRANS();
 
 	out << "_match:\n";
@@ -345,23 +362,34 @@ void BinaryLooped::writeExec()
 	if ( redFsm->anyRegCurStateRef() )
 		out << "	_ps = " << vCS() << ";\n";
 
+	TableArray &targs = useIndicies ? condTargsWi : condTargs;
+	TableArray &acts = useIndicies ? condActionsWi : condActions;
 	out <<
-		"	" << vCS() << " = " << ARR_REF( condTargs ) << "[_cond];\n"
+		"	" << vCS() << " = " << ARR_REF( targs ) << "[_cond];\n"
 		"\n";
 
 	if ( redFsm->anyRegActions() ) {
 		out <<
-			"	if ( " << ARR_REF( condActions ) << "[_cond] == 0 )\n"
+			"	if ( " << ARR_REF( acts ) << "[_cond] == 0 )\n"
 			"		goto _again;\n"
 			"\n"
-			"	_acts = " << ARR_REF( actions ) << " + " << ARR_REF( condActions ) << "[_cond]" << ";\n"
-			"	_nacts = " << "(unsigned int)" << " *_acts++;\n"
+			"	_acts = " << ARR_REF( actions ) << " + " << ARR_REF( acts ) << "[_cond]" << ";\n"
+			"	_nacts = " << "(unsigned int)" << " *_acts++;\n";
+
+		if ( computedGoto )
+			ACTION_DISPATCH();
+
+		out <<
 			"	while ( _nacts-- > 0 )\n	{\n"
 			"		switch ( *_acts++ )\n		{\n";
 			ACTION_SWITCH() <<
 			"		}\n"
-			"	}\n"
-			"\n";
+			"	}\n";
+
+		if ( computedGoto )
+			out << "#endif\n";
+
+		out << "\n";
 	}
 
 //	if ( redFsm->anyRegActions() || redFsm->anyActionGotos() || 
@@ -412,7 +440,7 @@ void BinaryLooped::writeExec()
 			out <<
 				"	if ( " << ARR_REF( eofTrans ) << "[" << vCS() << "] > 0 ) {\n"
 				"		_trans = " << ARR_REF( eofTrans ) << "[" << vCS() << "] - 1;\n"
-				"		_cond = " << ARR_REF( transOffsets ) << "[_trans];\n"
+				"		_cond = " << ARR_REF( useIndicies ? transOffsetsWi : transOffsets ) << "[_trans];\n"
 				"		goto _eof_trans;\n"
 				"	}\n";
 		}
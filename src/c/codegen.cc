@@ -73,6 +73,7 @@ namespace C {
 TableArray::TableArray( const char *name, CodeGen &codeGen )
 :
 	state(InitialState),
+	generated(false),
 	name(name),
 	type("_"),
 	width(0),
@@ -138,6 +139,7 @@ void TableArray::finishAnalyze()
 
 void TableArray::startGenerate()
 {
+	generated = true;
 	out << "static const " << type << " " << 
 		"_" << codeGen.DATA_PREFIX() << name << "[] = {\n\t";
 }
@@ -155,6 +157,13 @@ void TableArray::finishGenerate()
 	out << "0\n};\n\n";
 }
 
+void TableArray::resetAnalyze()
+{
+	values = 0;
+	min = LLONG_MAX;
+	max = LLONG_MIN;
+}
+
 void TableArray::start()
 {
 	switch ( state ) {
@@ -197,6 +206,16 @@ void TableArray::finish()
 	}
 }
 
+long long CodeGen::tableFootprint()
+{
+	long long size = 0;
+	for ( ArrayVector::Iter i = arrayVector; i.lte(); i++ ) {
+		if ( (*i)->generated )
+			size += (*i)->size();
+	}
+	return size;
+}
+
 void CodeGen::genLineDirective( ostream &out )
 {
 	std::streambuf *sbuf = out.rdbuf();
@@ -207,7 +226,9 @@ void CodeGen::genLineDirective( ostream &out )
 /* Init code gen with in parameters. */
 CodeGen::CodeGen( const CodeGenArgs &args )
 :
-	CodeGenData(args)
+	CodeGenData(args),
+	chunkClass( "chunk_class", *this ),
+	chunkNext(  "chunk_next",  *this )
 {
 }
 
@@ -392,6 +413,222 @@ string CodeGen::GET_KEY()
 	return ret.str();
 }
 
+bool CodeGen::skipLoop( RedStateAp *state )
+{
+	/* The scan reads the input directly and needs to know where it ends. */
+	return state->skip && !noEnd && getKeyExpr == 0;
+}
+
+/* Scan whole vectors of the input until one holds a byte that leaves the
+ * state. Written with the GCC vector extensions, which work inside the
+ * function the machine is written in, unlike the intrinsics headers. */
+void CodeGen::SKIP_VECTOR( RedStateAp *state, int width )
+{
+	out <<
+		"	{\n"
+		"	typedef unsigned char _vu __attribute__((vector_size(" << width << ")));\n"
+		"	typedef char _vc __attribute__((vector_size(" << width << ")));\n"
+		"	while ( " << PE() << " - " << P() << " >= " << width << " ) {\n"
+		"		_vu _x;\n"
+		"		__builtin_memcpy( &_x, " << P() << ", " << width << " );\n"
+		"		if ( __builtin_ia32_pmovmskb" << width * 8 << "( (_vc)( ";
+
+	for ( SkipRangeList::Iter range = state->skipExits; range.lte(); range++ ) {
+		if ( !range.first() )
+			out << " | ";
+		if ( range->low == range->high )
+			out << "( _x == " << range->low << " )";
+		else {
+			out << "( (_vu)( _x - " << range->low << " ) <= " << 
+					range->high - range->low << " )";
+		}
+	}
+
+	out << " ) ) != 0 )\n"
+		"			break;\n"
+		"		" << P() << " += " << width << ";\n"
+		"	}\n"
+		"	}\n";
+}
+
+/* Advance p to the next byte that leaves a state with a skip loop, or to
+ * pe. The bytes skipped over would have taken the self transition, which has
+ * no actions. */
+void CodeGen::SKIP_LOOP( RedStateAp *state )
+{
+	if ( state->skipExits.length() == 0 ) {
+		out << "	" << P() << " = " << PE() << ";\n";
+		return;
+	}
+
+	out << "#if defined(__GNUC__) && defined(__AVX2__)\n";
+	SKIP_VECTOR( state, 32 );
+	out << "#elif defined(__GNUC__) && defined(__SSE2__)\n";
+	SKIP_VECTOR( state, 16 );
+	out << "#endif\n";
+
+	string key = "(unsigned char)(*" + P() + ")";
+	out << "	while ( " << P() << " < " << PE() << " && !( ";
+	for ( SkipRangeList::Iter range = state->skipExits; range.lte(); range++ ) {
+		if ( !range.first() )
+			out << " || ";
+		if ( range->low == range->high )
+			out << key << " == " << range->low;
+		else {
+			out << "(unsigned int)(" << key << " - " << range->low << ") <= " << 
+					range->high - range->low;
+		}
+	}
+	out << " ) )\n"
+		"		" << P() << " += 1;\n";
+}
+
+/* Skip loops for the table driven code. They go ahead of the transition
+ * lookup. */
+void CodeGen::SKIP_LOOPS()
+{
+	bool any = false;
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		if ( skipLoop( st ) ) {
+			if ( !any ) 
+				out << "	switch ( " << vCS() << " ) {\n";
+			any = true;
+
+			out << "	case " << st->id << ":\n";
+			SKIP_LOOP( st );
+			out << 
+				"	if ( " << P() << " == " << PE() << " )\n"
+				"		goto _test_eof;\n"
+				"	break;\n";
+		}
+	}
+
+	if ( any ) {
+		testEofUsed = true;
+		out << "	}\n\n";
+	}
+}
+
+/* Run the transition actions at _acts by jumping from each action straight
+ * to the next through a table of label addresses, giving every action its
+ * own indirect branch in place of the one of the switch. Actions that no
+ * transition uses go to _again, as does the end of the list. Opens a
+ * conditional section the caller closes after the portable switch. */
+void CodeGen::ACTION_DISPATCH()
+{
+	int numIds = 0;
+	for ( GenActionList::Iter act = actionList; act.lte(); act++ ) {
+		if ( act->actionId >= numIds )
+			numIds = act->actionId + 1;
+	}
+
+	bool *used = new bool[numIds];
+	memset( used, 0, sizeof(bool) * numIds );
+	for ( GenActionList::Iter act = actionList; act.lte(); act++ )
+		used[act->actionId] = act->numTransRefs > 0;
+
+	out << 
+		"#if defined(__GNUC__)\n"
+		"	{\n"
+		"	static void *const _dispatch[] = {\n\t\t";
+
+	for ( int id = 0; id < numIds; id++ ) {
+		if ( used[id] )
+			out << "&&_action" << id;
+		else
+			out << "&&_again";
+
+		if ( id < numIds - 1 ) {
+			out << ", ";
+			if ( (id+1) % 8 == 0 )
+				out << "\n\t\t";
+		}
+	}
+
+	out << 
+		"\n"
+		"	};\n"
+		"\n"
+		"	goto *_dispatch[(unsigned int)*_acts++];\n";
+
+	for ( GenActionList::Iter act = actionList; act.lte(); act++ ) {
+		if ( act->numTransRefs > 0 ) {
+			out << "_action" << act->actionId << ":\n";
+			ACTION( out, act, 0, false, false );
+			out << 
+				"	if ( --_nacts > 0 )\n"
+				"		goto *_dispatch[(unsigned int)*_acts++];\n"
+				"	goto _again;\n";
+		}
+	}
+
+	genLineDirective( out );
+	out << 
+		"	}\n"
+		"#else\n";
+
+	delete[] used;
+}
+
+bool CodeGen::literalRun( RedStateAp *state )
+{
+	return state->runLength > 0 && !noEnd;
+}
+
+/* Open a block entered when the input holds the keys of the run starting at
+ * state. With GCC the compare is a memcmp of a constant size, which is
+ * expanded to loads of 2, 4 or 8 bytes. Near pe the test fails and the
+ * bytes are taken one at a time. */
+void CodeGen::LITERAL_RUN( RedStateAp *state )
+{
+	out << 
+		"#ifdef __GNUC__\n"
+		"	if ( " << PE() << " - " << P() << " >= " << state->runLength << 
+				" && __builtin_memcmp( " << P() << ", \"";
+
+	for ( int k = 0; k < state->runLength; k++ ) {
+		out << "\\" << std::oct << ( state->runKeys[k].getVal() & 0xff ) << 
+				std::dec;
+	}
+
+	out << "\", " << state->runLength << " ) == 0 ) {\n"
+		"#else\n"
+		"	if ( " << PE() << " - " << P() << " >= " << state->runLength;
+
+	for ( int k = 0; k < state->runLength; k++ ) {
+		out << " && " << P() << "[" << k << "] == " << KEY( state->runKeys[k] );
+	}
+
+	out << " ) {\n"
+		"#endif\n";
+}
+
+/* Literal runs for the table driven code. The last key of the run is
+ * consumed at _again, which enters the state landed in. */
+void CodeGen::LITERAL_RUNS()
+{
+	bool any = false;
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		if ( literalRun( st ) ) {
+			if ( !any ) 
+				out << "	switch ( " << vCS() << " ) {\n";
+			any = true;
+
+			out << "	case " << st->id << ":\n";
+			LITERAL_RUN( st );
+			out << 
+				"		" << P() << " += " << st->runLength - 1 << ";\n"
+				"		" << vCS() << " = " << st->runTarg->id << ";\n"
+				"		goto _again;\n"
+				"	}\n"
+				"	break;\n";
+		}
+	}
+
+	if ( any )
+		out << "	}\n\n";
+}
+
 /* Write out level number of tabs. Makes the nested binary search nice
  * looking. */
 string CodeGen::TABS( int level )
@@ -521,10 +758,30 @@ void CodeGen::SUB_ACTION( ostream &ret, GenInlineItem *item,
 
 /* Write out an inline tree structure. Walks the list and possibly calls out
  * to virtual functions than handle language specific items in the tree. */
+/* The items that are, or are only used inside, host code. Dropped when the
+ * actions are stubbed out. The control items stay, so the machine still
+ * moves the same way. */
+static bool hostItem( GenInlineItem::Type type )
+{
+	switch ( type ) {
+	case GenInlineItem::Text: case GenInlineItem::PChar:
+	case GenInlineItem::Char: case GenInlineItem::Curs:
+	case GenInlineItem::Targs: case GenInlineItem::Entry:
+	case GenInlineItem::GotoExpr: case GenInlineItem::CallExpr:
+	case GenInlineItem::NextExpr: case GenInlineItem::Exec:
+		return true;
+	default:
+		return false;
+	}
+}
+
 void CodeGen::INLINE_LIST( ostream &ret, GenInlineList *inlineList, 
 		int targState, bool inFinish, bool csForced )
 {
 	for ( GenInlineList::Iter item = *inlineList; item.lte(); item++ ) {
+		if ( stubActions && hostItem( item->type ) )
+			continue;
+
 		switch ( item->type ) {
 		case GenInlineItem::Text:
 			ret << item->data;
@@ -628,6 +885,11 @@ void CodeGen::ACTION( ostream &ret, GenAction *action, int targState,
 
 void CodeGen::CONDITION( ostream &ret, GenAction *condition )
 {
+	if ( stubActions ) {
+		ret << "1";
+		return;
+	}
+
 	ret << "\n";
 	cLineDirective( ret, condition->loc.fileName, condition->loc.line );
 	INLINE_LIST( ret, condition->inlineList, 0, false, false );
@@ -715,6 +977,525 @@ void CodeGen::STATE_IDS()
 		}
 		out << "\n";
 	}
+
+	if ( instrument )
+		PROFILE_DATA();
+
+	if ( redFsm->profiled ) {
+		string expect = "_" + DATA_PREFIX() + "expect";
+		out <<
+			"#ifndef " << expect << "\n"
+			"#ifdef __GNUC__\n"
+			"#define " << expect << "(x, v) __builtin_expect(!!(x), v)\n"
+			"#else\n"
+			"#define " << expect << "(x, v) (x)\n"
+			"#endif\n"
+			"#endif\n"
+			"\n";
+	}
+}
+
+/* Counts are kept per key for one byte alphabets and per state otherwise. */
+int CodeGen::profileWidth()
+{
+	return keyOps->alphType->size == 1 ? 256 : 1;
+}
+
+/* The counters and a function writing them out in the format read by
+ * --profile-use. The file the machine is written in must include stdio.h. */
+void CodeGen::PROFILE_DATA()
+{
+	string profile = "_" + DATA_PREFIX() + "profile";
+	int width = profileWidth();
+
+	out <<
+		"static unsigned long " << profile << "[" << 
+				redFsm->stateList.length() * width << "];\n"
+		"\n"
+		"static int " << DATA_PREFIX() << "write_profile( const char *fileName )\n"
+		"{\n"
+		"	FILE *file = fopen( fileName, \"a\" );\n"
+		"	unsigned int i;\n"
+		"	if ( file == 0 )\n"
+		"		return -1;\n"
+		"	fprintf( file, \"machine " << fsmName << "\\n\" );\n"
+		"	for ( i = 0; i < sizeof(" << profile << ") / sizeof(" << 
+				profile << "[0]); i++ ) {\n"
+		"		if ( " << profile << "[i] != 0 ) {\n";
+
+	if ( width == 1 ) {
+		out <<
+			"			fprintf( file, \"%u * %lu\\n\", i, " << profile << "[i] );\n";
+	}
+	else {
+		out <<
+			"			fprintf( file, \"%u %u %lu\\n\", i / " << width << ", i % " << 
+					width << ", " << profile << "[i] );\n";
+	}
+
+	out <<
+		"		}\n"
+		"	}\n"
+		"	return fclose( file );\n"
+		"}\n"
+		"\n";
+}
+
+/* Count the transition about to be taken out of state. */
+void CodeGen::PROFILE_COUNT( string state )
+{
+	if ( !instrument )
+		return;
+
+	out << "	_" << DATA_PREFIX() << "profile[" << state;
+	if ( profileWidth() > 1 )
+		out << "*" << profileWidth() << " + (unsigned char)" << GET_KEY();
+	out << "] += 1;\n";
+}
+
+void CodeGen::PROFILE_COUNT( int state )
+{
+	ostringstream ret;
+	ret << state;
+	PROFILE_COUNT( ret.str() );
+}
+
+/* Hint a test that went one way at least nine times in ten. */
+string CodeGen::EXPECT( string test, unsigned long long taken, unsigned long long total )
+{
+	if ( total == 0 || ( taken * 10 > total && taken * 10 < total * 9 ) )
+		return test;
+
+	return "_" + DATA_PREFIX() + "expect(" + test + ", " + 
+			( taken * 10 >= total * 9 ? "1" : "0" ) + ")";
+}
+
+/* The data of the machine and a function running it once over a buffer,
+ * with the variables a scanner or a machine using fcall needs. */
+void CodeGen::writeBench( std::ostream &entries )
+{
+	/* The driver calls every machine with a buffer of char. */
+	if ( keyOps->alphType->size != 1 )
+		return;
+
+	string exec = DATA_PREFIX() + "bench_exec";
+
+	writeData();
+
+	/* It takes the buffer as char, like the driver, and points at it with
+	 * the alphabet type. */
+	out <<
+		"static int " << exec << "( const char *_data, const char *_data_end )\n"
+		"{\n"
+		"	const " << ALPH_TYPE() << " *p = (const " << ALPH_TYPE() << "*)_data;\n"
+		"	const " << ALPH_TYPE() << " *pe = (const " << ALPH_TYPE() << "*)_data_end;\n"
+		"	const " << ALPH_TYPE() << " *eof = pe;\n"
+		"	const " << ALPH_TYPE() << " *ts = 0, *te = 0;\n"
+		"	int cs, act = 0, top = 0;\n"
+		"	int stack[" << BENCH_STACK << "];\n"
+		"	(void)eof; (void)ts; (void)te; (void)act; (void)top; (void)stack;\n";
+
+	writeInit();
+	writeExec();
+
+	out <<
+		"	return cs;\n"
+		"}\n"
+		"\n";
+
+	entries << "	{ \"" << fsmName << "\", " << exec << ", " <<
+			FIRST_FINAL_STATE() << ", " << ERROR_STATE() << " },\n";
+}
+
+/* The data of the action-stripped machine and a function telling if a buffer
+ * is matched by it. The buffer is the whole input, so eof is pe. */
+void CodeGen::writeMatchExec()
+{
+	writeData();
+
+	out <<
+		"static int " << DATA_PREFIX() << "exec( const " << ALPH_TYPE() <<
+				" *p, const " << ALPH_TYPE() << " *pe )\n"
+		"{\n"
+		"	const " << ALPH_TYPE() << " *eof = pe;\n"
+		"	int cs;\n"
+		"	(void)eof;\n";
+
+	writeInit();
+	writeExec();
+
+	out <<
+		"	return cs >= " << FIRST_FINAL_STATE() << ";\n"
+		"}\n"
+		"\n";
+}
+
+/* A dense table of the machine over classes of bytes that no state tells
+ * apart, and functions running a chunk of the input from all states at once.
+ * The states are run in lockstep, one load per state and byte, which the C
+ * compiler can vectorize. Each block of bytes the states that have come
+ * together are merged, as most machines forget where they started within a
+ * few bytes. */
+void CodeGen::writeExecChunked()
+{
+	string map = DATA_PREFIX() + "chunk_map";
+	string combine = DATA_PREFIX() + "chunk_combine";
+	string run = DATA_PREFIX() + "chunk_run";
+	int numStates = redFsm->nextStateId;
+
+	/* The state reached from each state on each byte, indexed by the byte as
+	 * an unsigned char. */
+	RedStateAp **states = new RedStateAp*[numStates];
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ )
+		states[st->id] = st;
+
+	int *targs = new int[numStates * 256];
+	for ( int s = 0; s < numStates; s++ ) {
+		for ( int b = 0; b < 256; b++ ) {
+			Key key = keyOps->isSigned ? (long)(signed char)b : (long)b;
+			targs[s * 256 + b] = redFsm->keyTarg( states[s], key )->id;
+		}
+	}
+
+	/* Split the classes of the bytes by the state gone to, state by state.
+	 * Classes are numbered in the order of their first byte. */
+	int cls[256];
+	memset( cls, 0, sizeof(cls) );
+	int numClasses = 1;
+	for ( int s = 0; s < numStates; s++ ) {
+		BstMap< long long, int > split;
+		for ( int b = 0; b < 256; b++ ) {
+			long long k = (long long)cls[b] * numStates + targs[s * 256 + b];
+			BstMapEl< long long, int > *el = split.find( k );
+			if ( el == 0 )
+				el = split.insert( k, split.length() );
+			cls[b] = el->value;
+		}
+		numClasses = split.length();
+	}
+
+	/* A byte of each class. */
+	int *first = new int[numClasses];
+	for ( int b = 255; b >= 0; b-- )
+		first[cls[b]] = b;
+
+	for ( int pass = 0; pass < 2; pass++ ) {
+		TableArray::State state = pass == 0 ?
+				TableArray::AnalyzePass : TableArray::GeneratePass;
+		chunkClass.setState( state );
+		chunkNext.setState( state );
+
+		chunkClass.start();
+		for ( int b = 0; b < 256; b++ )
+			chunkClass.value( cls[b] );
+		chunkClass.finish();
+
+		chunkNext.start();
+		for ( int s = 0; s < numStates; s++ ) {
+			for ( int c = 0; c < numClasses; c++ )
+				chunkNext.value( targs[s * 256 + first[c]] );
+		}
+		chunkNext.finish();
+	}
+
+	out <<
+		"/* The state reached from cs over [p, pe). */\n"
+		"static int " << run << "( int cs, const " << ALPH_TYPE() << " *p, const " <<
+				ALPH_TYPE() << " *pe )\n"
+		"{\n"
+		"	for ( ; p < pe; p++ ) {\n"
+		"		cs = " << ARR_REF( chunkNext ) << "[cs * " << numClasses << " + " <<
+				ARR_REF( chunkClass ) << "[(unsigned char)*p]];\n";
+
+	if ( redFsm->errState != 0 ) {
+		out <<
+			"		if ( cs == " << redFsm->errState->id << " )\n"
+			"			break;\n";
+	}
+
+	out <<
+		"	}\n"
+		"	return cs;\n"
+		"}\n"
+		"\n"
+		"/* Fills map, indexed by state, with the state that each state reaches\n"
+		" * over [p, pe). Chunks can be mapped in parallel. Returns zero when more\n"
+		" * than max_live states are still apart after a block of the chunk; run\n"
+		" * the chunk with " << run << " once the state entering it is known. */\n"
+		"static int " << map << "( int *map, const " << ALPH_TYPE() << " *p, const " <<
+				ALPH_TYPE() << " *pe, int max_live )\n"
+		"{\n"
+		"	int cur[" << numStates << "], lane[" << numStates << "], "
+				"seen[" << numStates << "], merged[" << numStates << "];\n"
+		"	int n = " << numStates << ", s, k, m, c;\n"
+		"	const " << ALPH_TYPE() << " *b;\n"
+		"\n"
+		"	for ( s = 0; s < " << numStates << "; s++ ) {\n"
+		"		cur[s] = s;\n"
+		"		lane[s] = s;\n"
+		"		seen[s] = -1;\n"
+		"	}\n"
+		"\n"
+		"	while ( p < pe && n > 1 ) {\n"
+		"		b = pe - p > " << CHUNK_BLOCK << " ? p + " << CHUNK_BLOCK << " : pe;\n"
+		"		for ( ; p < b; p++ ) {\n"
+		"			c = " << ARR_REF( chunkClass ) << "[(unsigned char)*p];\n"
+		"			for ( k = 0; k < n; k++ )\n"
+		"				cur[k] = " << ARR_REF( chunkNext ) << "[cur[k] * " <<
+						numClasses << " + c];\n"
+		"		}\n"
+		"\n"
+		"		/* Lanes that are in the same state go on as one. */\n"
+		"		m = 0;\n"
+		"		for ( k = 0; k < n; k++ ) {\n"
+		"			if ( seen[cur[k]] < 0 ) {\n"
+		"				seen[cur[k]] = m;\n"
+		"				cur[m++] = cur[k];\n"
+		"			}\n"
+		"			merged[k] = seen[cur[k]];\n"
+		"		}\n"
+		"		for ( k = 0; k < m; k++ )\n"
+		"			seen[cur[k]] = -1;\n"
+		"		for ( s = 0; s < " << numStates << "; s++ )\n"
+		"			lane[s] = merged[lane[s]];\n"
+		"		n = m;\n"
+		"\n"
+		"		if ( n > max_live )\n"
+		"			return 0;\n"
+		"	}\n"
+		"\n"
+		"	if ( n == 1 )\n"
+		"		cur[0] = " << run << "( cur[0], p, pe );\n"
+		"\n"
+		"	for ( s = 0; s < " << numStates << "; s++ )\n"
+		"		map[s] = cur[lane[s]];\n"
+		"	return 1;\n"
+		"}\n"
+		"\n"
+		"/* The map of the chunk of a followed by the chunk of b. Out may be a. */\n"
+		"static void " << combine << "( int *out, const int *a, const int *b )\n"
+		"{\n"
+		"	int s;\n"
+		"	for ( s = 0; s < " << numStates << "; s++ )\n"
+		"		out[s] = b[a[s]];\n"
+		"}\n"
+		"\n";
+
+	delete[] states;
+	delete[] targs;
+	delete[] first;
+}
+
+/* Many short records are run a few at a time, each stream in its own
+ * variables. The steps of the streams don't depend on each other, so the loads
+ * of their table lookups overlap. Streams are stepped together as far as the
+ * shortest goes, then the streams at the end of a record take the next one.
+ * Once the records run out, a stream repeats the steps of another until all
+ * are done, saving checks in the inner loop. */
+void CodeGen::writeExecStreams()
+{
+	string exec = DATA_PREFIX() + "exec_streams";
+	int errId = redFsm->errState != 0 ? redFsm->errState->id : -1;
+
+	out <<
+		"/* Runs the records from ps[i] to pes[i], for i < n, through the machine,\n"
+		" * " << numStreams << " at a time in lockstep. Sets css[i] to the final state of each. */\n"
+		"static void " << exec << "( const " << ALPH_TYPE() << " *const *ps, const " <<
+				ALPH_TYPE() << " *const *pes, int *css, int n )\n"
+		"{\n";
+
+	for ( int k = 0; k < numStreams; k++ ) {
+		out <<
+			"	const " << ALPH_TYPE() << " *_p" << k << ", *_pe" << k << ";\n"
+			"	int _s" << k << ", _r" << k << ";\n";
+	}
+
+	out <<
+		"	int _next = 0, _live = 0;\n"
+		"	long _m;\n"
+		"\n"
+		"	if ( n <= 0 )\n"
+		"		return;\n"
+		"\n";
+
+	for ( int k = 0; k < numStreams; k++ ) {
+		out <<
+			"	_p" << k << " = _pe" << k << " = ps[0];\n"
+			"	_s" << k << " = " << START_STATE_ID() << ";\n"
+			"	_r" << k << " = -1;\n";
+	}
+
+	out <<
+		"\n"
+		"	while ( 1 ) {\n";
+
+	for ( int k = 0; k < numStreams; k++ ) {
+		out << "		if ( _p" << k << " == _pe" << k;
+		if ( errId >= 0 )
+			out << " || _s" << k << " == " << errId;
+		out << " ) {\n"
+			"			if ( _r" << k << " >= 0 ) {\n"
+			"				css[_r" << k << "] = _s" << k << ";\n"
+			"				_r" << k << " = -1;\n"
+			"				_live -= 1;\n"
+			"			}\n"
+			"			if ( _next < n ) {\n"
+			"				_r" << k << " = _next++;\n"
+			"				_p" << k << " = ps[_r" << k << "];\n"
+			"				_pe" << k << " = pes[_r" << k << "];\n"
+			"				_s" << k << " = " << START_STATE_ID() << ";\n"
+			"				_live += 1;\n"
+			"			}\n";
+
+		/* Out of records, follow a stream that has some way to go. */
+		for ( int j = 0; j < numStreams; j++ ) {
+			if ( j == k )
+				continue;
+
+			out << "			else if ( _r" << j << " >= 0 && _p" << j << " < _pe" << j;
+			if ( errId >= 0 )
+				out << " && _s" << j << " != " << errId;
+			out << " ) {\n"
+				"				_p" << k << " = _p" << j << ";\n"
+				"				_pe" << k << " = _pe" << j << ";\n"
+				"				_s" << k << " = _s" << j << ";\n"
+				"			}\n";
+		}
+
+		out << "		}\n";
+	}
+
+	out <<
+		"\n"
+		"		if ( _live == 0 )\n"
+		"			break;\n"
+		"\n"
+		"		_m = _pe0 - _p0;\n";
+
+	for ( int k = 1; k < numStreams; k++ ) {
+		out <<
+			"		if ( _pe" << k << " - _p" << k << " < _m )\n"
+			"			_m = _pe" << k << " - _p" << k << ";\n";
+	}
+
+	out <<
+		"\n"
+		"		for ( ; _m > 0; _m-- ) {\n";
+
+	for ( int k = 0; k < numStreams; k++ ) {
+		STREAM_STEP( "_s" + itoa( k ), "_p" + itoa( k ), itoa( k ) );
+		out << "	_p" << k << " += 1;\n";
+	}
+
+	if ( errId >= 0 ) {
+		out << "			if ( ";
+		for ( int k = 0; k < numStreams; k++ ) {
+			if ( k > 0 )
+				out << " || ";
+			out << "_s" << k << " == " << errId;
+		}
+		out << " )\n"
+			"				break;\n";
+	}
+
+	out <<
+		"		}\n"
+		"	}\n"
+		"}\n"
+		"\n";
+}
+
+void writeBenchHeader( std::ostream &out )
+{
+	out <<
+		"#define _POSIX_C_SOURCE 200809L\n"
+		"#include <stdio.h>\n"
+		"#include <stdlib.h>\n"
+		"#include <string.h>\n"
+		"#include <time.h>\n"
+		"#include <fcntl.h>\n"
+		"#include <unistd.h>\n"
+		"#include <sys/mman.h>\n"
+		"#include <sys/stat.h>\n"
+		"\n";
+}
+
+/* The driver runs each machine of the input over a corpus file. */
+void writeBenchDriver( std::ostream &out, const std::string &entries )
+{
+	out <<
+		"\n"
+		"typedef int (*bench_exec_t)( const char *p, const char *pe );\n"
+		"\n"
+		"struct bench_machine\n"
+		"{\n"
+		"	const char *name;\n"
+		"	bench_exec_t exec;\n"
+		"	int first_final;\n"
+		"	int error;\n"
+		"};\n"
+		"\n"
+		"static const struct bench_machine bench_machines[] = {\n" <<
+		entries <<
+		"	{ 0, 0, 0, 0 }\n"
+		"};\n"
+		"\n"
+		"int main( int argc, char **argv )\n"
+		"{\n"
+		"	const struct bench_machine *m;\n"
+		"	struct stat st;\n"
+		"	const char *data;\n"
+		"	long iterations = argc > 2 ? atol( argv[2] ) : 10;\n"
+		"	int fd;\n"
+		"\n"
+		"	if ( argc < 2 || iterations <= 0 ) {\n"
+		"		fprintf( stderr, \"usage: %s <corpus> [iterations] [machine]\\n\", argv[0] );\n"
+		"		return 2;\n"
+		"	}\n"
+		"\n"
+		"	fd = open( argv[1], O_RDONLY );\n"
+		"	if ( fd < 0 || fstat( fd, &st ) != 0 || st.st_size == 0 ) {\n"
+		"		fprintf( stderr, \"%s: could not read %s\\n\", argv[0], argv[1] );\n"
+		"		return 1;\n"
+		"	}\n"
+		"\n"
+		"	data = mmap( 0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );\n"
+		"	if ( data == MAP_FAILED ) {\n"
+		"		fprintf( stderr, \"%s: could not map %s\\n\", argv[0], argv[1] );\n"
+		"		return 1;\n"
+		"	}\n"
+		"\n"
+		"	for ( m = bench_machines; m->name != 0; m++ ) {\n"
+		"		struct timespec start, end;\n"
+		"		long i, final = 0, error = 0, other = 0;\n"
+		"		double secs, bytes;\n"
+		"\n"
+		"		if ( argc > 3 && strcmp( argv[3], m->name ) != 0 )\n"
+		"			continue;\n"
+		"\n"
+		"		clock_gettime( CLOCK_MONOTONIC, &start );\n"
+		"		for ( i = 0; i < iterations; i++ ) {\n"
+		"			int cs = m->exec( data, data + st.st_size );\n"
+		"			if ( cs >= m->first_final )\n"
+		"				final += 1;\n"
+		"			else if ( cs == m->error )\n"
+		"				error += 1;\n"
+		"			else\n"
+		"				other += 1;\n"
+		"		}\n"
+		"		clock_gettime( CLOCK_MONOTONIC, &end );\n"
+		"\n"
+		"		secs = ( end.tv_sec - start.tv_sec ) + ( end.tv_nsec - start.tv_nsec ) / 1e9;\n"
+		"		bytes = (double)st.st_size * iterations;\n"
+		"		printf( \"%s: %.0f bytes in %.6f s, %.2f MB/s, %.3f ns/byte, \"\n"
+		"				\"final %ld, error %ld, other %ld\\n\", m->name, bytes, secs,\n"
+		"				bytes / secs / 1e6, secs * 1e9 / bytes, final, error, other );\n"
+		"	}\n"
+		"\n"
+		"	munmap( (void*)data, st.st_size );\n"
+		"	close( fd );\n"
+		"	return 0;\n"
+		"}\n";
 }
 
 void CodeGen::writeStart()
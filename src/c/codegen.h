@@ -51,6 +51,12 @@ struct LongestMatchPart;
 
 string itoa( int i );
 
+/* Depth of the call stack given to machines in the benchmark driver. */
+#define BENCH_STACK 1024
+
+/* Bytes run by write exec_chunked between merges of the states. */
+#define CHUNK_BLOCK 64
+
 namespace C
 {
 
@@ -88,12 +94,17 @@ struct TableArray
 	void finishAnalyze();
 	void finishGenerate();
 
+	/* Forget the values of an analysis pass so the table can be analyzed
+	 * again. */
+	void resetAnalyze();
+
 	void setState( TableArray::State state )
 		{ this->state = state; }
 
 	long long size();
 
 	State state;
+	bool generated;
 	const char *name;
 	std::string type;
 	int width;
@@ -120,12 +131,31 @@ public:
 	virtual void writeStart();
 	virtual void writeFirstFinal();
 	virtual void writeError();
+	virtual void writeBench( std::ostream &entries );
+	virtual void writeExecChunked();
+	virtual void writeExecStreams();
+	virtual void writeMatchExec();
+
+	/* Move the state in cs of a stream of write exec_streams on the key at
+	 * p, in a block of its own. Labels end in suffix. */
+	virtual void STREAM_STEP( string cs, string p, string suffix ) {}
+
+	/* Bytes of the tables written by writeData. */
+	long long tableFootprint();
+
+	/* Estimated bytes of machine code for the transitions, where it grows
+	 * with the machine. Zero for the table styles. */
+	virtual long long codeFootprint() { return 0; }
 
 protected:
 	friend class TableArray;
 	typedef Vector<TableArray*> ArrayVector;
 	ArrayVector arrayVector;
 
+	/* Tables of write exec_chunked. */
+	TableArray chunkClass;
+	TableArray chunkNext;
+
 	string FSM_NAME();
 	string START_STATE_ID();
 	void taActions();
@@ -192,6 +222,29 @@ protected:
 			int targState, bool inFinish, bool csForced );
 	void STATE_IDS();
 
+	/* Counting the transitions taken (--instrument). */
+	int profileWidth();
+	void PROFILE_DATA();
+	void PROFILE_COUNT( string state );
+	void PROFILE_COUNT( int state );
+
+	/* Branch hints from the profile (--profile-use). */
+	string EXPECT( string test, unsigned long long taken, unsigned long long total );
+
+	/* Scanning over input in states that loop on themselves (--simd). */
+	bool skipLoop( RedStateAp *state );
+	void SKIP_VECTOR( RedStateAp *state, int width );
+	void SKIP_LOOP( RedStateAp *state );
+	void SKIP_LOOPS();
+
+	/* Transition actions threaded with labels as values (--computed-goto). */
+	void ACTION_DISPATCH();
+
+	/* Matching chains of single key states at once (--literal-runs). */
+	bool literalRun( RedStateAp *state );
+	void LITERAL_RUN( RedStateAp *state );
+	void LITERAL_RUNS();
+
 	string ERROR_STATE();
 	string FIRST_FINAL_STATE();
 
@@ -211,6 +264,10 @@ public:
 	virtual void writeExports();
 };
 
+/* The parts of the benchmark driver around the machines (--bench). */
+void writeBenchHeader( std::ostream &out );
+void writeBenchDriver( std::ostream &out, const std::string &entries );
+
 }
 
 #endif
@@ -0,0 +1,444 @@
+/*
+ *  Copyright 2026 agent <agent@local>
+ */
+
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
+ */
+
+
+#include "ragel.h"
+#include "denseloop.h"
+#include "redfsm.h"
+#include "gendata.h"
+
+namespace C {
+
+DenseLooped::DenseLooped( const CodeGenArgs &args )
+:
+	FlatLooped( args ),
+	denseTargs(       "dense_targs",         *this ),
+	denseActions(     "dense_actions",       *this ),
+	eofTransTargs(    "eof_trans_targs",     *this ),
+	eofTransActions(  "eof_trans_actions",   *this ),
+	dense(false)
+{}
+
+/* The dense tables hold one target and one action per entry, so they can't
+ * express conditions. */
+bool DenseLooped::denseAllowed()
+{
+	if ( redFsm->byteClass == 0 )
+		return false;
+
+	for ( TransApSet::Iter trans = redFsm->transSet; trans.lte(); trans++ ) {
+		if ( trans->condSpace != 0 )
+			return false;
+	}
+
+	return true;
+}
+
+/* Bytes taken by the tables indexed on every byte, after the analysis pass
+ * has chosen their element types. */
+long long DenseLooped::denseSize()
+{
+	long long size = charClass.size() + denseTargs.size();
+	if ( redFsm->anyRegActions() )
+		size += denseActions.size();
+	return size;
+}
+
+RedTransAp *DenseLooped::denseTrans( RedStateAp *state, int cls )
+{
+	if ( state->transList != 0 && state->lowKey.getVal() <= cls &&
+			cls <= state->highKey.getVal() )
+		return state->transList[cls - state->lowKey.getVal()];
+	return state->defTrans;
+}
+
+void DenseLooped::taDenseTargs()
+{
+	denseTargs.start();
+
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		for ( int c = 0; c < redFsm->numByteClasses; c++ ) {
+			/* The error state has no transitions and stays put. */
+			RedTransAp *trans = denseTrans( st, c );
+			if ( trans != 0 )
+				denseTargs.value( trans->outConds[0].value->targ->id );
+			else
+				denseTargs.value( st->id );
+		}
+	}
+
+	denseTargs.finish();
+}
+
+void DenseLooped::taDenseActions()
+{
+	denseActions.start();
+
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		for ( int c = 0; c < redFsm->numByteClasses; c++ ) {
+			RedTransAp *trans = denseTrans( st, c );
+			int act = 0;
+			if ( trans != 0 && trans->outConds[0].value->action != 0 )
+				act = trans->outConds[0].value->action->location+1;
+			denseActions.value( act );
+		}
+	}
+
+	denseActions.finish();
+}
+
+void DenseLooped::taEofTransTargs()
+{
+	eofTransTargs.start();
+
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		/* Zero for no eof transition, otherwise the target plus one. */
+		long targ = 0;
+		if ( st->eofTrans != 0 )
+			targ = st->eofTrans->outConds[0].value->targ->id + 1;
+		eofTransTargs.value( targ );
+	}
+
+	eofTransTargs.finish();
+}
+
+void DenseLooped::taEofTransActions()
+{
+	eofTransActions.start();
+
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		int act = 0;
+		if ( st->eofTrans != 0 && st->eofTrans->outConds[0].value->action != 0 )
+			act = st->eofTrans->outConds[0].value->action->location+1;
+		eofTransActions.value( act );
+	}
+
+	eofTransActions.finish();
+}
+
+void DenseLooped::denseTableDataPass()
+{
+	taActions();
+	taCharClass();
+	taDenseTargs();
+	taDenseActions();
+
+	taToStateActions();
+	taFromStateActions();
+	taEofActions();
+	taEofTransTargs();
+	taEofTransActions();
+}
+
+void DenseLooped::genAnalysis()
+{
+	redFsm->sortByStateId();
+
+	/* Choose default transitions and the single transition. */
+	redFsm->chooseDefaultSpan();
+
+	/* The dense tables are indexed by byte class. The flat tables we may fall
+	 * back to are built over the same classes, or in pages for wide
+	 * alphabets. */
+	redFsm->makeByteClasses();
+	if ( pagedTables && keyOps->alphType->size > 1 )
+		redFsm->makePaged();
+	else
+		redFsm->makeFlat();
+
+	/* If any errors have occured in the input file then don't write anything. */
+	if ( gblErrorCount > 0 )
+		return;
+
+	/* Anlayze Machine will find the final action reference counts, among other
+	 * things. We will use these in reporting the usage of fsm directives in
+	 * action code. */
+	analyzeMachine();
+
+	setKeyType();
+
+	/* Run the analysis pass over the table data. The element types it picks
+	 * decide if the dense tables fit in the budget. */
+	setTableState( TableArray::AnalyzePass );
+
+	dense = denseAllowed();
+	if ( dense ) {
+		denseTableDataPass();
+		if ( denseSize() > denseBudget )
+			dense = false;
+	}
+
+	if ( !dense ) {
+		/* Overlay the flat rows. */
+		if ( combTables )
+			redFsm->makeComb();
+
+		/* The dense pass counted the values of the tables it shares with the
+		 * flat ones. Count them again from the start. */
+		for ( ArrayVector::Iter i = arrayVector; i.lte(); i++ )
+			(*i)->resetAnalyze();
+
+		tableDataPass();
+	}
+
+	/* Switch the tables over to the code gen mode. */
+	setTableState( TableArray::GeneratePass );
+}
+
+void DenseLooped::STREAM_STEP( string cs, string p, string suffix )
+{
+	if ( !dense ) {
+		FlatLooped::STREAM_STEP( cs, p, suffix );
+		return;
+	}
+
+	out <<
+		"	" << cs << " = " << ARR_REF( denseTargs ) << "[" << cs << " * " <<
+				redFsm->numByteClasses << " + " << ARR_REF( charClass ) <<
+				"[(unsigned char)*" << p << "]];\n";
+}
+
+void DenseLooped::writeData()
+{
+	if ( !dense ) {
+		FlatLooped::writeData();
+		return;
+	}
+
+	/* If there are any transtion functions then output the array. If there
+	 * are none, don't bother emitting an empty array that won't be used. */
+	if ( redFsm->anyActions() )
+		taActions();
+
+	taCharClass();
+	taDenseTargs();
+
+	if ( redFsm->anyRegActions() )
+		taDenseActions();
+
+	if ( redFsm->anyToStateActions() )
+		taToStateActions();
+
+	if ( redFsm->anyFromStateActions() )
+		taFromStateActions();
+
+	if ( redFsm->anyEofActions() )
+		taEofActions();
+
+	if ( redFsm->anyEofTrans() ) {
+		taEofTransTargs();
+		if ( redFsm->anyRegActions() )
+			taEofTransActions();
+	}
+
+	STATE_IDS();
+}
+
+void DenseLooped::writeExec()
+{
+	if ( !dense )
+		FlatLooped::writeExec();
+	else
+		writeDenseExec();
+}
+
+void DenseLooped::writeDenseExec()
+{
+	testEofUsed = false;
+	outLabelUsed = false;
+
+	out << 
+		"	{\n"
+		"	int _trans, _targ";
+
+	if ( redFsm->anyRegActions() )
+		out << ", _act";
+
+	if ( redFsm->anyRegCurStateRef() )
+		out << ", _ps";
+
+	out << ";\n";
+
+	if ( redFsm->anyToStateActions() || 
+			redFsm->anyRegActions() || redFsm->anyFromStateActions() )
+	{
+		out << 
+			"	const " << ARR_TYPE( actions ) << " *_acts;\n"
+			"	unsigned int _nacts;\n"; 
+	}
+
+	out << "\n";
+
+	if ( !noEnd ) {
+		testEofUsed = true;
+		out << 
+			"	if ( " << P() << " == " << PE() << " )\n"
+			"		goto _test_eof;\n";
+	}
+
+	if ( redFsm->errState != 0 ) {
+		outLabelUsed = true;
+		out << 
+			"	if ( " << vCS() << " == " << redFsm->errState->id << " )\n"
+			"		goto _out;\n";
+	}
+
+	out << "_resume:\n";
+
+	if ( redFsm->anyFromStateActions() ) {
+		out <<
+			"	_acts = " << ARR_REF( actions ) << " + " << ARR_REF( fromStateActions ) <<
+					"[" << vCS() << "]" << ";\n"
+			"	_nacts = " << "(unsigned int)" << " *_acts++;\n"
+			"	while ( _nacts-- > 0 ) {\n"
+			"		switch ( *_acts++ ) {\n";
+			FROM_STATE_ACTION_SWITCH() <<
+			"		}\n"
+			"	}\n"
+			"\n";
+	}
+
+	SKIP_LOOPS();
+	PROFILE_COUNT( vCS() );
+	LITERAL_RUNS();
+
+	/* One row of byte classes per state. */
+	out <<
+		"	_trans = " << vCS() << " * " << redFsm->numByteClasses << " + " <<
+				ARR_REF( charClass ) << "[(unsigned char)" << GET_KEY() << "];\n"
+		"	_targ = " << ARR_REF( denseTargs ) << "[_trans];\n";
+
+	if ( redFsm->anyRegActions() )
+		out << "	_act = " << ARR_REF( denseActions ) << "[_trans];\n";
+
+	out << "\n";
+
+	if ( redFsm->anyEofTrans() )
+		out << "_eof_trans:\n";
+
+	if ( redFsm->anyRegCurStateRef() )
+		out << "	_ps = " << vCS() << ";\n";
+
+	out <<
+		"	" << vCS() << " = _targ;\n"
+		"\n";
+
+	if ( redFsm->anyRegActions() ) {
+		out <<
+			"	if ( _act == 0 )\n"
+			"		goto _again;\n"
+			"\n"
+			"	_acts = " << ARR_REF( actions ) << " + _act;\n"
+			"	_nacts = " << "(unsigned int)" << " *_acts++;\n";
+
+		if ( computedGoto )
+			ACTION_DISPATCH();
+
+		out <<
+			"	while ( _nacts-- > 0 ) {\n"
+			"		switch ( *(_acts++) )\n		{\n";
+			ACTION_SWITCH() <<
+			"		}\n"
+			"	}\n";
+
+		if ( computedGoto )
+			out << "#endif\n";
+
+		out << "\n";
+	}
+
+	out << "_again:\n";
+
+	if ( redFsm->anyToStateActions() ) {
+		out <<
+			"	_acts = " << ARR_REF( actions ) << " + " << ARR_REF( toStateActions ) << "[" << vCS() << "]" << ";\n"
+			"	_nacts = " << "(unsigned int)" << " *_acts++;\n"
+			"	while ( _nacts-- > 0 ) {\n"
+			"		switch ( *_acts++ ) {\n";
+			TO_STATE_ACTION_SWITCH() <<
+			"		}\n"
+			"	}\n"
+			"\n";
+	}
+
+	if ( redFsm->errState != 0 ) {
+		outLabelUsed = true;
+		out << 
+			"	if ( " << vCS() << " == " << redFsm->errState->id << " )\n"
+			"		goto _out;\n";
+	}
+
+	if ( !noEnd ) {
+		out << 
+			"	if ( ++" << P() << " != " << PE() << " )\n"
+			"		goto _resume;\n";
+	}
+	else {
+		out << 
+			"	" << P() << " += 1;\n"
+			"	goto _resume;\n";
+	}
+
+	if ( testEofUsed )
+		out << "	_test_eof: {}\n";
+
+	if ( redFsm->anyEofTrans() || redFsm->anyEofActions() ) {
+		out << 
+			"	if ( " << P() << " == " << vEOF() << " )\n"
+			"	{\n";
+
+		if ( redFsm->anyEofTrans() ) {
+			out <<
+				"	if ( " << ARR_REF( eofTransTargs ) << "[" << vCS() << "] > 0 ) {\n"
+				"		_targ = " << ARR_REF( eofTransTargs ) << "[" << vCS() << "] - 1;\n";
+
+			if ( redFsm->anyRegActions() )
+				out << "		_act = " << ARR_REF( eofTransActions ) << "[" << vCS() << "];\n";
+
+			out <<
+				"		goto _eof_trans;\n"
+				"	}\n";
+		}
+
+		if ( redFsm->anyEofActions() ) {
+			out <<
+				"	const " << ARR_TYPE( actions ) << " *__acts = " << 
+						ARR_REF( actions ) << " + " << ARR_REF( eofActions ) << "[" << vCS() << "]" << ";\n"
+				"	" << "unsigned int" << " __nacts = " << "(unsigned int)" << " *__acts++;\n"
+				"	while ( __nacts-- > 0 ) {\n"
+				"		switch ( *__acts++ ) {\n";
+				EOF_ACTION_SWITCH() <<
+				"		}\n"
+				"	}\n";
+		}
+
+		out <<
+			"	}\n"
+			"\n";
+	}
+
+	if ( outLabelUsed )
+		out << "	_out: {}\n";
+
+	out << "	}\n";
+}
+
+}
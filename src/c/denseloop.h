@@ -0,0 +1,76 @@
+/*
+ *  Copyright 2026 agent <agent@local>
+ */
+
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
+ */
+
+
+#ifndef _C_DENSELOOP_H
+#define _C_DENSELOOP_H
+
+#include <iostream>
+#include "flatloop.h"
+
+/* Forwards. */
+struct CodeGenData;
+struct NameInst;
+struct RedTransAp;
+struct RedStateAp;
+
+namespace C {
+
+/* Direct indexed tables of the next state and the actions for every pair of
+ * state and byte class. Machines that need conditions, that don't have a one
+ * byte alphabet or whose tables go over the dense budget get the flat tables
+ * of FlatLooped instead. */
+class DenseLooped
+	: public FlatLooped
+{
+public:
+	DenseLooped( const CodeGenArgs &args );
+
+	virtual void genAnalysis();
+	virtual void writeData();
+	virtual void writeExec();
+
+protected:
+	TableArray denseTargs;
+	TableArray denseActions;
+	TableArray eofTransTargs;
+	TableArray eofTransActions;
+
+	bool dense;
+
+	bool denseAllowed();
+	long long denseSize();
+	RedTransAp *denseTrans( RedStateAp *state, int cls );
+
+	void taDenseTargs();
+	void taDenseActions();
+	void taEofTransTargs();
+	void taEofTransActions();
+
+	void denseTableDataPass();
+	void writeDenseExec();
+
+	virtual void STREAM_STEP( string cs, string p, string suffix );
+};
+
+}
+
+#endif
@@ -32,10 +32,23 @@ Flat::Flat( const CodeGenArgs &args )
 :
 	CodeGen( args ),
 	actions(          "actions",             *this ),
+	charClass(        "char_class",          *this ),
 	keys(             "trans_keys",          *this ),
 	keySpans(         "key_spans",           *this ),
 	flatIndexOffset(  "index_offsets",       *this ),
 	indicies(         "indicies",            *this ),
+	combBase(         "comb_base",           *this ),
+	combNext(         "comb_next",           *this ),
+	combCheck(        "comb_check",          *this ),
+	combDefaults(     "comb_defaults",       *this ),
+	pageLows(         "page_lows",           *this ),
+	pageCounts(       "page_counts",         *this ),
+	pageOffsets(      "page_offsets",        *this ),
+	pageRuns(         "page_runs",           *this ),
+	pageStarts(       "page_starts",         *this ),
+	pageIndex(        "page_index",          *this ),
+	pageTrans(        "page_trans",          *this ),
+	pageDefaults(     "page_defaults",       *this ),
 	transCondSpaces(  "trans_cond_spaces",   *this ),
 	transOffsets(     "trans_offsets",       *this ),
 	transLengths(     "trans_lengths",       *this ),
@@ -50,8 +63,11 @@ Flat::Flat( const CodeGenArgs &args )
 
 void Flat::setKeyType()
 {
-	keys.setType( ALPH_TYPE(), keyOps->alphType->size );
-	keys.isSigned = keyOps->isSigned;
+	/* Over byte classes the keys are class ids, sized by the analysis. */
+	if ( redFsm->byteClass == 0 ) {
+		keys.setType( ALPH_TYPE(), keyOps->alphType->size );
+		keys.isSigned = keyOps->isSigned;
+	}
 }
 
 void Flat::setTableState( TableArray::State state )
@@ -165,6 +181,17 @@ void Flat::taEofTrans()
 	delete[] transPos;
 }
 
+/* The class of each byte, indexed by the byte as an unsigned char. */
+void Flat::taCharClass()
+{
+	charClass.start();
+
+	for ( int b = 0; b < 256; b++ )
+		charClass.value( redFsm->byteClass[b] );
+
+	charClass.finish();
+}
+
 void Flat::taKeys()
 {
 	keys.start();
@@ -199,6 +226,133 @@ void Flat::taIndicies()
 	indicies.finish();
 }
 
+void Flat::taCombBase()
+{
+	combBase.start();
+
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ )
+		combBase.value( st->combBase );
+
+	combBase.finish();
+}
+
+void Flat::taCombNext()
+{
+	combNext.start();
+
+	for ( int i = 0; i < redFsm->combLength; i++ ) {
+		RedTransAp *trans = redFsm->combNext[i];
+		combNext.value( trans != 0 ? trans->id : 0 );
+	}
+
+	combNext.finish();
+}
+
+void Flat::taCombCheck()
+{
+	combCheck.start();
+
+	for ( int i = 0; i < redFsm->combLength; i++ )
+		combCheck.value( redFsm->combCheck[i] );
+
+	combCheck.finish();
+}
+
+void Flat::taCombDefaults()
+{
+	combDefaults.start();
+
+	/* The error state has no default but is never looked up. */
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ )
+		combDefaults.value( st->defTrans != 0 ? st->defTrans->id : 0 );
+
+	combDefaults.finish();
+}
+
+void Flat::taPageLows()
+{
+	pageLows.start();
+
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ )
+		pageLows.value( st->pageLow );
+
+	pageLows.finish();
+}
+
+void Flat::taPageCounts()
+{
+	pageCounts.start();
+
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ )
+		pageCounts.value( st->pageCount );
+
+	pageCounts.finish();
+}
+
+void Flat::taPageOffsets()
+{
+	pageOffsets.start();
+
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ )
+		pageOffsets.value( st->pageOffset );
+
+	pageOffsets.finish();
+}
+
+void Flat::taPageRuns()
+{
+	pageRuns.start();
+
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ )
+		pageRuns.value( st->pageRuns );
+
+	pageRuns.finish();
+}
+
+void Flat::taPageStarts()
+{
+	pageStarts.start();
+
+	for ( int i = 0; i < redFsm->pageIndexLength; i++ )
+		pageStarts.value( redFsm->pageStarts[i] );
+
+	pageStarts.finish();
+}
+
+void Flat::taPageIndex()
+{
+	pageIndex.start();
+
+	for ( int i = 0; i < redFsm->pageIndexLength; i++ )
+		pageIndex.value( redFsm->pageIndex[i] );
+
+	pageIndex.finish();
+}
+
+void Flat::taPageTrans()
+{
+	pageTrans.start();
+
+	long length = (long)redFsm->numPages << RedFsmAp::pageBits;
+	for ( long i = 0; i < length; i++ ) {
+		RedTransAp *trans = redFsm->pages[i];
+		pageTrans.value( trans != 0 ? trans->id : 0 );
+	}
+
+	pageTrans.finish();
+}
+
+void Flat::taPageDefaults()
+{
+	pageDefaults.start();
+
+	/* The error state has no default but is never looked up. */
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ )
+		pageDefaults.value( st->defTrans != 0 ? st->defTrans->id : 0 );
+
+	pageDefaults.finish();
+}
+
 void Flat::taTransCondSpaces()
 {
 	transCondSpaces.start();
@@ -359,18 +513,112 @@ void Flat::taActions()
 }
 
 
-void Flat::LOCATE_TRANS()
+/* Variables of the lookup of the transition, not counting conditions. */
+void Flat::LOCATE_TRANS_DECLS()
+{
+	if ( redFsm->pages != 0 )
+		out <<
+			"	unsigned long long _pk, _pg;\n"
+			"	int _plow, _phigh, _pmid;\n";
+	else if ( redFsm->combNext == 0 ) {
+		out <<
+			"	int _slen;\n"
+			"	const " << ARR_TYPE( keys ) << " *_keys;\n"
+			"	const " << ARR_TYPE( indicies ) << " *_inds;\n";
+	}
+
+	if ( redFsm->byteClass != 0 || redFsm->combNext != 0 )
+		out << "	int _ec;\n";
+}
+
+/* Find the transition taken from the state in cs on key, leaving it in
+ * _trans. */
+void Flat::LOCATE_TRANS_KEY( string cs, string key )
+{
+	if ( redFsm->combNext != 0 ) {
+		/* The class of the key, or the key as an index. */
+		out << "	_ec = ";
+		if ( redFsm->byteClass != 0 )
+			out << ARR_REF( charClass ) << "[(unsigned char)" << key << "];\n";
+		else
+			out << "(unsigned char)" << key << ";\n";
+
+		out <<
+			"	_trans = " << ARR_REF( combBase ) << "[" << cs << "] + _ec;\n"
+			"	if ( " << ARR_REF( combCheck ) << "[_trans] == " << cs << " )\n"
+			"		_trans = " << ARR_REF( combNext ) << "[_trans];\n"
+			"	else\n"
+			"		_trans = " << ARR_REF( combDefaults ) << "[" << cs << "];\n"
+			"\n";
+	}
+	else if ( redFsm->pages != 0 ) {
+		/* The position of the key in the alphabet, split into a page and an
+		 * offset. Pages outside of the state's take the default. Inside, the
+		 * page is that of the last run starting at or before it. */
+		out <<
+			"	_pk = (unsigned long long)" << key << " - "
+					"(unsigned long long)" << KEY( keyOps->minKey ) << ";\n"
+			"	_pg = (_pk >> " << RedFsmAp::pageBits << ") - " <<
+					ARR_REF( pageLows ) << "[" << cs << "];\n"
+			"	if ( _pg < " << ARR_REF( pageCounts ) << "[" << cs << "] ) {\n"
+			"		_plow = " << ARR_REF( pageOffsets ) << "[" << cs << "];\n"
+			"		_phigh = _plow + " << ARR_REF( pageRuns ) << "[" << cs << "] - 1;\n"
+			"		while ( _plow < _phigh ) {\n"
+			"			_pmid = _plow + ((_phigh - _plow + 1) >> 1);\n"
+			"			if ( _pg < " << ARR_REF( pageStarts ) << "[_pmid] )\n"
+			"				_phigh = _pmid - 1;\n"
+			"			else\n"
+			"				_plow = _pmid;\n"
+			"		}\n"
+			"		_trans = " << ARR_REF( pageTrans ) << "[((unsigned long long)" <<
+					ARR_REF( pageIndex ) << "[_plow] << " << RedFsmAp::pageBits << ") + "
+					"(_pk & " << ( ( 1 << RedFsmAp::pageBits ) - 1 ) << ")];\n"
+			"	}\n"
+			"	else\n"
+			"		_trans = " << ARR_REF( pageDefaults ) << "[" << cs << "];\n"
+			"\n";
+	}
+	else {
+		out <<
+			"	_keys = " << ARR_REF( keys ) << " + " << "(" << cs << "<<1)" << ";\n"
+			"	_inds = " << ARR_REF( indicies ) << " + " << ARR_REF( flatIndexOffset ) << "[" << cs << "]" << ";\n"
+			"\n";
+
+		/* The keys of the states are byte classes. */
+		if ( redFsm->byteClass != 0 ) {
+			out << "	_ec = " << ARR_REF( charClass ) << "[(unsigned char)" << key << "];\n";
+			key = "_ec";
+		}
+
+		out <<
+			"	_slen = " << ARR_REF( keySpans ) << "[" << cs << "];\n"
+			"	_trans = _inds[ _slen > 0 && _keys[0] <=" << key << " &&\n"
+			"		" << key << " <= _keys[1] ?\n"
+			"		" << key << " - _keys[0] : _slen ];\n"
+
+			"\n";
+	}
+}
+
+/* Without conditions a transition has a single target. */
+void Flat::STREAM_STEP( string cs, string p, string suffix )
 {
 	out <<
-		"	_keys = " << ARR_REF( keys ) << " + " << "(" << vCS() << "<<1)" << ";\n"
-		"	_inds = " << ARR_REF( indicies ) << " + " << ARR_REF( flatIndexOffset ) << "[" << vCS() << "]" << ";\n"
-		"\n"
-		"	_slen = " << ARR_REF( keySpans ) << "[" << vCS() << "];\n"
-		"	_trans = _inds[ _slen > 0 && _keys[0] <=" << GET_KEY() << " &&\n"
-		"		" << GET_KEY() << " <= _keys[1] ?\n"
-		"		" << GET_KEY() << " - _keys[0] : _slen ];\n"
+		"	{\n"
+		"	int _trans;\n";
 
-		"\n";
+	LOCATE_TRANS_DECLS();
+	LOCATE_TRANS_KEY( cs, "(*" + p + ")" );
+
+	out <<
+		"	" << cs << " = " << ARR_REF( condTargs ) << "[" <<
+				ARR_REF( transOffsets ) << "[_trans]];\n"
+		"	}\n";
+}
+
+void Flat::LOCATE_TRANS()
+{
+	LOCATE_TRANS_KEY( vCS(), GET_KEY() );
 
 	out <<
 		"	_ckeys = " << ARR_REF( condKeys ) << " + " << ARR_REF( transOffsets ) << "[_trans];\n"
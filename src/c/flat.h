@@ -45,10 +45,23 @@ public:
 
 protected:
 	TableArray actions;
+	TableArray charClass;
 	TableArray keys;
 	TableArray keySpans;
 	TableArray flatIndexOffset;
 	TableArray indicies;
+	TableArray combBase;
+	TableArray combNext;
+	TableArray combCheck;
+	TableArray combDefaults;
+	TableArray pageLows;
+	TableArray pageCounts;
+	TableArray pageOffsets;
+	TableArray pageRuns;
+	TableArray pageStarts;
+	TableArray pageIndex;
+	TableArray pageTrans;
+	TableArray pageDefaults;
 	TableArray transCondSpaces;
 	TableArray transOffsets;
 	TableArray transLengths;
@@ -60,11 +73,24 @@ protected:
 	TableArray eofActions;
 	TableArray eofTrans;
 
+	void taCharClass();
 	void taKeys();
 	void taKeySpans();
 	void taActions();
 	void taFlatIndexOffset();
 	void taIndicies();
+	void taCombBase();
+	void taCombNext();
+	void taCombCheck();
+	void taCombDefaults();
+	void taPageLows();
+	void taPageCounts();
+	void taPageOffsets();
+	void taPageRuns();
+	void taPageStarts();
+	void taPageIndex();
+	void taPageTrans();
+	void taPageDefaults();
 	void taTransCondSpaces();
 	void taTransOffsets();
 	void taTransLengths();
@@ -90,8 +116,13 @@ protected:
 	std::ostream &COND_TARGS();
 	std::ostream &COND_ACTIONS();
 
+	void LOCATE_TRANS_DECLS();
+	void LOCATE_TRANS_KEY( string cs, string key );
 	void LOCATE_TRANS();
 
+	virtual bool streamable() { return true; }
+	virtual void STREAM_STEP( string cs, string p, string suffix );
+
 	void GOTO( ostream &ret, int gotoDest, bool inFinish );
 	void CALL( ostream &ret, int callDest, int targState, bool inFinish );
 	void NEXT( ostream &ret, int nextDest, bool inFinish );
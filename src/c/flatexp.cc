@@ -30,11 +30,32 @@ namespace C {
 
 void FlatExpanded::tableDataPass()
 {
-	taKeys();
-	taKeySpans();
-	taFlatIndexOffset();
+	if ( redFsm->byteClass != 0 )
+		taCharClass();
+
+	if ( redFsm->combNext != 0 ) {
+		taCombBase();
+		taCombNext();
+		taCombCheck();
+		taCombDefaults();
+	}
+	else if ( redFsm->pages != 0 ) {
+		taPageLows();
+		taPageCounts();
+		taPageOffsets();
+		taPageRuns();
+		taPageStarts();
+		taPageIndex();
+		taPageTrans();
+		taPageDefaults();
+	}
+	else {
+		taKeys();
+		taKeySpans();
+		taFlatIndexOffset();
+		taIndicies();
+	}
 
-	taIndicies();
 	taTransCondSpaces();
 	taTransOffsets();
 	taTransLengths();
@@ -54,9 +75,20 @@ void FlatExpanded::genAnalysis()
 
 	/* Choose default transitions and the single transition. */
 	redFsm->chooseDefaultSpan();
+
+	/* Index the flat tables by byte class. */
+	if ( byteClasses )
+		redFsm->makeByteClasses();
 		
-	/* Do flat expand. */
-	redFsm->makeFlat();
+	/* Do flat expand, in shared pages for wide alphabets. */
+	if ( pagedTables && keyOps->alphType->size > 1 )
+		redFsm->makePaged();
+	else
+		redFsm->makeFlat();
+
+	/* Overlay the flat rows. */
+	if ( combTables )
+		redFsm->makeComb();
 
 	/* If any errors have occured in the input file then don't write anything. */
 	if ( gblErrorCount > 0 )
@@ -197,11 +229,32 @@ std::ostream &FlatExpanded::ACTION_SWITCH()
 
 void FlatExpanded::writeData()
 {
-	taKeys();
-	taKeySpans();
-	taFlatIndexOffset();
+	if ( redFsm->byteClass != 0 )
+		taCharClass();
+
+	if ( redFsm->combNext != 0 ) {
+		taCombBase();
+		taCombNext();
+		taCombCheck();
+		taCombDefaults();
+	}
+	else if ( redFsm->pages != 0 ) {
+		taPageLows();
+		taPageCounts();
+		taPageOffsets();
+		taPageRuns();
+		taPageStarts();
+		taPageIndex();
+		taPageTrans();
+		taPageDefaults();
+	}
+	else {
+		taKeys();
+		taKeySpans();
+		taFlatIndexOffset();
+		taIndicies();
+	}
 
-	taIndicies();
 	taTransCondSpaces();
 	taTransOffsets();
 	taTransLengths();
@@ -231,17 +284,16 @@ void FlatExpanded::writeExec()
 
 	out << 
 		"	{\n"
-		"	int _slen";
+		"	int _trans, _cond";
 
 	if ( redFsm->anyRegCurStateRef() )
 		out << ", _ps";
 	
 	out << ";\n";
-	out << "	int _trans, _cond;\n";
+
+	LOCATE_TRANS_DECLS();
 
 	out <<
-		"	const " << ALPH_TYPE() << " *_keys;\n"
-		"	const " << ARR_TYPE( indicies ) << " *_inds;\n"
 		"	const " << ARR_TYPE( condKeys ) << " *_ckeys;\n"
 		"	int _klen;\n"
 		"	int _cpc;\n";
@@ -270,6 +322,9 @@ void FlatExpanded::writeExec()
 			"\n";
 	}
 
+	SKIP_LOOPS();
+	PROFILE_COUNT( vCS() );
+	LITERAL_RUNS();
 	LOCATE_TRANS();
 
 	out << "_match_cond:\n";
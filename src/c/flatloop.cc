@@ -31,11 +31,33 @@ namespace C {
 void FlatLooped::tableDataPass()
 {
 	taActions();
-	taKeys();
-	taKeySpans();
-	taFlatIndexOffset();
 
-	taIndicies();
+	if ( redFsm->byteClass != 0 )
+		taCharClass();
+
+	if ( redFsm->combNext != 0 ) {
+		taCombBase();
+		taCombNext();
+		taCombCheck();
+		taCombDefaults();
+	}
+	else if ( redFsm->pages != 0 ) {
+		taPageLows();
+		taPageCounts();
+		taPageOffsets();
+		taPageRuns();
+		taPageStarts();
+		taPageIndex();
+		taPageTrans();
+		taPageDefaults();
+	}
+	else {
+		taKeys();
+		taKeySpans();
+		taFlatIndexOffset();
+		taIndicies();
+	}
+
 	taTransCondSpaces();
 	taTransOffsets();
 	taTransLengths();
@@ -55,9 +77,20 @@ void FlatLooped::genAnalysis()
 
 	/* Choose default transitions and the single transition. */
 	redFsm->chooseDefaultSpan();
+
+	/* Index the flat tables by byte class. */
+	if ( byteClasses )
+		redFsm->makeByteClasses();
 		
-	/* Do flat expand. */
-	redFsm->makeFlat();
+	/* Do flat expand, in shared pages for wide alphabets. */
+	if ( pagedTables && keyOps->alphType->size > 1 )
+		redFsm->makePaged();
+	else
+		redFsm->makeFlat();
+
+	/* Overlay the flat rows. */
+	if ( combTables )
+		redFsm->makeComb();
 
 	/* If any errors have occured in the input file then don't write anything. */
 	if ( gblErrorCount > 0 )
@@ -153,11 +186,32 @@ void FlatLooped::writeData()
 	if ( redFsm->anyActions() )
 		taActions();
 
-	taKeys();
-	taKeySpans();
-	taFlatIndexOffset();
+	if ( redFsm->byteClass != 0 )
+		taCharClass();
+
+	if ( redFsm->combNext != 0 ) {
+		taCombBase();
+		taCombNext();
+		taCombCheck();
+		taCombDefaults();
+	}
+	else if ( redFsm->pages != 0 ) {
+		taPageLows();
+		taPageCounts();
+		taPageOffsets();
+		taPageRuns();
+		taPageStarts();
+		taPageIndex();
+		taPageTrans();
+		taPageDefaults();
+	}
+	else {
+		taKeys();
+		taKeySpans();
+		taFlatIndexOffset();
+		taIndicies();
+	}
 
-	taIndicies();
 	taTransCondSpaces();
 	taTransOffsets();
 	taTransLengths();
@@ -187,14 +241,11 @@ void FlatLooped::writeExec()
 
 	out << 
 		"	{\n"
-		"	int _slen";
+		"	int _trans, _cond";
 
 	if ( redFsm->anyRegCurStateRef() )
 		out << ", _ps";
 
-	out << 
-		";\n"
-		"	int _trans, _cond";
 	out << ";\n";
 
 	if ( redFsm->anyToStateActions() || 
@@ -205,9 +256,9 @@ void FlatLooped::writeExec()
 			"	unsigned int _nacts;\n"; 
 	}
 
+	LOCATE_TRANS_DECLS();
+
 	out <<
-		"	const " << ALPH_TYPE() << " *_keys;\n"
-		"	const " << ARR_TYPE( indicies ) << " *_inds;\n"
 		"	const " << ARR_TYPE( condKeys ) << " *_ckeys;\n"
 		"	int _klen;\n"
 		"	int _cpc;\n";
@@ -243,6 +294,9 @@ void FlatLooped::writeExec()
 			"\n";
 	}
 
+	SKIP_LOOPS();
+	PROFILE_COUNT( vCS() );
+	LITERAL_RUNS();
 	LOCATE_TRANS();
 
 	out << "_match_cond:\n";
@@ -263,13 +317,22 @@ void FlatLooped::writeExec()
 			"		goto _again;\n"
 			"\n"
 			"	_acts = " << ARR_REF( actions ) << " + " << ARR_REF( condActions ) << "[_cond]" << ";\n"
-			"	_nacts = " << "(unsigned int)" << " *_acts++;\n"
+			"	_nacts = " << "(unsigned int)" << " *_acts++;\n";
+
+		if ( computedGoto )
+			ACTION_DISPATCH();
+
+		out <<
 			"	while ( _nacts-- > 0 ) {\n"
 			"		switch ( *(_acts++) )\n		{\n";
 			ACTION_SWITCH() <<
 			"		}\n"
-			"	}\n"
-			"\n";
+			"	}\n";
+
+		if ( computedGoto )
+			out << "#endif\n";
+
+		out << "\n";
 	}
 
 //	if ( redFsm->anyRegActions() || redFsm->anyActionGotos() || 
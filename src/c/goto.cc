@@ -89,6 +89,25 @@ std::ostream &Goto::TRANS_GOTO( RedTransAp *trans, int level )
 	return out;
 }
 
+/* A rough model of the machine code of the state gotos on x86: a compare
+ * and branch per single key, two per range searched, a jump per transition
+ * and the advance and test of p per state. Action code is left out as it is
+ * the same whatever the style. */
+long long Goto::codeFootprint()
+{
+	long long size = 0;
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		size += 16;
+		size += 8 * st->outSingle.length();
+		size += 16 * st->outRange.length();
+		if ( st->defTrans != 0 )
+			size += 5;
+	}
+
+	size += 8 * redFsm->condSet.length();
+	return size;
+}
+
 std::ostream &Goto::TO_STATE_ACTION_SWITCH()
 {
 	/* Walk the list of functions, printing the cases. */
@@ -189,10 +208,32 @@ void Goto::SINGLE_SWITCH( RedStateAp *state )
 	int numSingles = state->outSingle.length();
 	RedTransEl *data = state->outSingle.data;
 
+	/* A single key that takes most of the profile is tested ahead of the
+	 * switch. The compiler lowers the switch by value, so the order of the
+	 * cases would not matter. */
+	if ( numSingles > 1 && state->profKeys != 0 ) {
+		int hot = 0;
+		for ( int j = 1; j < numSingles; j++ ) {
+			if ( redFsm->profWeight( state, data[j].lowKey, data[j].lowKey ) >
+					redFsm->profWeight( state, data[hot].lowKey, data[hot].lowKey ) )
+				hot = j;
+		}
+
+		unsigned long long taken = redFsm->profWeight( state,
+				data[hot].lowKey, data[hot].lowKey );
+		if ( taken * 2 > state->profCount ) {
+			out << "\tif ( " << EXPECT( GET_KEY() + " == " + KEY(data[hot].lowKey),
+					taken, state->profCount ) << " ) {\n\t\t";
+			TRANS_GOTO(data[hot].value, 0) << "\n";
+			out << "\t}\n";
+		}
+	}
+
 	if ( numSingles == 1 ) {
 		/* If there is a single single key then write it out as an if. */
-		out << "\tif ( " << GET_KEY() << " == " << 
-				KEY(data[0].lowKey) << " ) {\n\t\t"; 
+		out << "\tif ( " << EXPECT( GET_KEY() + " == " + KEY(data[0].lowKey),
+				redFsm->profWeight( state, data[0].lowKey, data[0].lowKey ),
+				state->profCount ) << " ) {\n\t\t"; 
 
 		/* Virtual function for writing the target of the transition. */
 		TRANS_GOTO(data[0].value, 0) << "\n";
@@ -214,12 +255,45 @@ void Goto::SINGLE_SWITCH( RedStateAp *state )
 	}
 }
 
+unsigned long long Goto::rangeWeight( RedStateAp *state, int low, int high )
+{
+	unsigned long long weight = 0;
+	for ( int r = low; r <= high; r++ ) {
+		weight += redFsm->profWeight( state, state->outRange[r].lowKey,
+				state->outRange[r].highKey );
+	}
+	return weight;
+}
+
+/* The range holding the median of the keys taken in the profile, so the
+ * keys taken most often are found in the fewest tests. Without a profile
+ * it is the middle range, staying on the lower end. */
+int Goto::rangeMid( RedStateAp *state, int low, int high )
+{
+	unsigned long long total = rangeWeight( state, low, high );
+	if ( total == 0 )
+		return (low + high) >> 1;
+
+	unsigned long long sum = 0;
+	for ( int r = low; r < high; r++ ) {
+		sum += rangeWeight( state, r, r );
+		if ( sum * 2 >= total )
+			return r;
+	}
+	return high;
+}
+
 void Goto::RANGE_B_SEARCH( RedStateAp *state, int level, Key lower, Key upper, int low, int high )
 {
-	/* Get the mid position, staying on the lower end of the range. */
-	int mid = (low + high) >> 1;
+	/* Get the mid position. */
+	int mid = rangeMid( state, low, high );
 	RedTransEl *data = state->outRange.data;
 
+	/* Taken below, at and above mid in the profile, for hinting the tests. */
+	unsigned long long below = mid > low ? rangeWeight( state, low, mid-1 ) : 0;
+	unsigned long long above = mid < high ? rangeWeight( state, mid+1, high ) : 0;
+	unsigned long long total = below + rangeWeight( state, mid, mid ) + above;
+
 	/* Determine if we need to look higher or lower. */
 	bool anyLower = mid > low;
 	bool anyHigher = mid < high;
@@ -230,11 +304,11 @@ void Goto::RANGE_B_SEARCH( RedStateAp *state, int level, Key lower, Key upper, i
 
 	if ( anyLower && anyHigher ) {
 		/* Can go lower and higher than mid. */
-		out << TABS(level) << "if ( " << GET_KEY() << " < " << 
-				KEY(data[mid].lowKey) << " ) {\n";
+		out << TABS(level) << "if ( " << EXPECT( GET_KEY() + " < " +
+				KEY(data[mid].lowKey), below, total ) << " ) {\n";
 		RANGE_B_SEARCH( state, level+1, lower, keyOps->sub( data[mid].lowKey, 1 ), low, mid-1 );
-		out << TABS(level) << "} else if ( " << GET_KEY() << " > " << 
-				KEY(data[mid].highKey) << " ) {\n";
+		out << TABS(level) << "} else if ( " << EXPECT( GET_KEY() + " > " +
+				KEY(data[mid].highKey), above, total - below ) << " ) {\n";
 		RANGE_B_SEARCH( state, level+1, keyOps->add( data[mid].highKey, 1 ), upper, mid+1, high );
 		out << TABS(level) << "} else {\n";
 		TRANS_GOTO(data[mid].value, level+1) << "\n";
@@ -242,8 +316,8 @@ void Goto::RANGE_B_SEARCH( RedStateAp *state, int level, Key lower, Key upper, i
 	}
 	else if ( anyLower && !anyHigher ) {
 		/* Can go lower than mid but not higher. */
-		out << TABS(level) << "if ( " << GET_KEY() << " < " << 
-				KEY(data[mid].lowKey) << " ) {\n";
+		out << TABS(level) << "if ( " << EXPECT( GET_KEY() + " < " +
+				KEY(data[mid].lowKey), below, total ) << " ) {\n";
 		RANGE_B_SEARCH( state, level+1, lower, keyOps->sub( data[mid].lowKey, 1 ), low, mid-1 );
 
 		/* if the higher is the highest in the alphabet then there is no
@@ -262,8 +336,8 @@ void Goto::RANGE_B_SEARCH( RedStateAp *state, int level, Key lower, Key upper, i
 	}
 	else if ( !anyLower && anyHigher ) {
 		/* Can go higher than mid but not lower. */
-		out << TABS(level) << "if ( " << GET_KEY() << " > " << 
-				KEY(data[mid].highKey) << " ) {\n";
+		out << TABS(level) << "if ( " << EXPECT( GET_KEY() + " > " +
+				KEY(data[mid].highKey), above, total ) << " ) {\n";
 		RANGE_B_SEARCH( state, level+1, keyOps->add( data[mid].highKey, 1 ), upper, mid+1, high );
 
 		/* If the lower end is the lowest in the alphabet then there is no
@@ -432,6 +506,27 @@ std::ostream &Goto::STATE_GOTOS()
 			/* Writing code above state gotos. */
 			GOTO_HEADER( st );
 
+			/* Scan over the bytes that loop back to the state. */
+			if ( skipLoop( st ) ) {
+				testEofUsed = true;
+				SKIP_LOOP( st );
+				out << 
+					"	if ( " << P() << " == " << PE() << " )\n"
+					"		goto _test_eof;\n";
+			}
+
+			PROFILE_COUNT( st->id );
+
+			/* Take a chain of single key states at once. */
+			if ( literalRun( st ) ) {
+				LITERAL_RUN( st );
+				out <<
+					"		" << P() << " += " << st->runLength - 1 << ";\n"
+					"		" << vCS() << " = " << st->runTarg->id << ";\n"
+					"		goto _again;\n"
+					"	}\n";
+			}
+
 			/* Try singles. */
 			if ( st->outSingle.length() > 0 )
 				SINGLE_SWITCH( st );
@@ -45,6 +45,8 @@ class Goto
 public:
 	Goto( const CodeGenArgs &args );
 
+	long long codeFootprint();
+
 	std::ostream &TO_STATE_ACTION_SWITCH();
 	std::ostream &FROM_STATE_ACTION_SWITCH();
 	std::ostream &EOF_ACTION_SWITCH();
@@ -97,6 +99,10 @@ public:
 	void SINGLE_SWITCH( RedStateAp *state );
 	void RANGE_B_SEARCH( RedStateAp *state, int level, Key lower, Key upper, int low, int high );
 
+	/* Times the ranges from low to high were taken in the profile. */
+	unsigned long long rangeWeight( RedStateAp *state, int low, int high );
+	int rangeMid( RedStateAp *state, int low, int high );
+
 	/* Called from STATE_GOTOS just before writing the gotos */
 	virtual void GOTO_HEADER( RedStateAp *state );
 	virtual void STATE_GOTO_ERROR();
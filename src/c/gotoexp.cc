@@ -41,10 +41,16 @@ void GotoExpanded::genAnalysis()
 	/* For directly executable machines there is no required state
 	 * ordering. Choose a depth-first ordering to increase the
 	 * potential for fall-throughs. */
-	redFsm->depthFirstOrdering();
+	if ( redFsm->profiled )
+		redFsm->profileOrdering();
+	else
+		redFsm->depthFirstOrdering();
 
 	/* Choose default transitions and the single transition. */
-	redFsm->chooseDefaultSpan();
+	if ( redFsm->profiled )
+		redFsm->chooseDefaultProfile();
+	else
+		redFsm->chooseDefaultSpan();
 		
 	/* Choose single. */
 	redFsm->chooseSingle();
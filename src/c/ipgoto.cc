@@ -38,11 +38,23 @@ void IpGoto::genAnalysis()
 	/* For directly executable machines there is no required state
 	 * ordering. Choose a depth-first ordering to increase the
 	 * potential for fall-throughs. */
-	redFsm->depthFirstOrdering();
+	if ( redFsm->profiled )
+		redFsm->profileOrdering();
+	else
+		redFsm->depthFirstOrdering();
 
 	/* Choose default transitions and the single transition. */
-	redFsm->chooseDefaultSpan();
+	if ( redFsm->profiled )
+		redFsm->chooseDefaultProfile();
+	else
+		redFsm->chooseDefaultSpan();
 		
+	/* Move the rarely entered states out of the way of the hot ones. */
+	if ( splitCold ) {
+		redFsm->findColdStates();
+		redFsm->coldOrdering();
+	}
+
 	/* Choose single. */
 	redFsm->chooseSingle();
 
@@ -150,6 +162,15 @@ void IpGoto::BREAK( ostream &ret, int targState, bool csForced )
 	ret << "goto _out;}";
 }
 
+/* With GCC the blocks after a cold label are moved to a separate section of
+ * the text, leaving the code of the hot states dense. */
+string IpGoto::COLD( RedStateAp *state )
+{
+	if ( !state->cold )
+		return "";
+	return " _" + DATA_PREFIX() + "cold;";
+}
+
 bool IpGoto::IN_TRANS_ACTIONS( RedStateAp *state )
 {
 	bool anyWritten = false;
@@ -163,7 +184,7 @@ bool IpGoto::IN_TRANS_ACTIONS( RedStateAp *state )
 			anyWritten = true;
 
 			/* Write the label for the transition so it can be jumped to. */
-			out << "ctr" << trans->id << ":\n";
+			out << "ctr" << trans->id << ":" << COLD( trans->targ ) << "\n";
 
 			/* If the action contains a next, then we must preload the current
 			 * state since the action may or may not set it. */
@@ -196,7 +217,7 @@ void IpGoto::GOTO_HEADER( RedStateAp *state )
 	bool anyWritten = IN_TRANS_ACTIONS( state );
 
 	if ( state->labelNeeded ) 
-		out << "st" << state->id << ":\n";
+		out << "st" << state->id << ":" << COLD( state ) << "\n";
 
 	if ( state->toStateAction != 0 ) {
 		/* Remember that we wrote an action. Write every action in the list. */
@@ -252,7 +273,7 @@ void IpGoto::STATE_GOTO_ERROR()
 		genLineDirective( out );
 
 	if ( state->labelNeeded ) 
-		out << "st" << state->id << ":\n";
+		out << "st" << state->id << ":" << COLD( state ) << "\n";
 
 	/* Break out here. */
 	outLabelUsed = true;
@@ -343,6 +364,28 @@ std::ostream &IpGoto::STATE_GOTOS()
 			/* Writing code above state gotos. */
 			GOTO_HEADER( st );
 
+			/* Scan over the bytes that loop back to the state. The exit
+			 * sets the current state. */
+			if ( skipLoop( st ) ) {
+				st->outNeeded = true;
+				SKIP_LOOP( st );
+				out << 
+					"	if ( " << P() << " == " << PE() << " )\n"
+					"		goto _test_eof" << st->id << ";\n";
+			}
+
+			PROFILE_COUNT( st->id );
+
+			/* Take a chain of single key states at once. The label of the
+			 * state landed in consumes the last key. */
+			if ( literalRun( st ) ) {
+				LITERAL_RUN( st );
+				out <<
+					"		" << P() << " += " << st->runLength - 1 << ";\n"
+					"		goto st" << st->runTarg->id << ";\n"
+					"	}\n";
+			}
+
 			/* Try singles. */
 			if ( st->outSingle.length() > 0 )
 				SINGLE_SWITCH( st );
@@ -452,6 +495,12 @@ void IpGoto::setLabelsNeeded()
 		}
 	}
 
+	/* Literal runs jump to the state they land in. */
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		if ( literalRun( st ) )
+			st->runTarg->labelNeeded = true;
+	}
+
 	if ( !noEnd ) {
 		for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
 			if ( st != redFsm->errState )
@@ -463,6 +512,19 @@ void IpGoto::setLabelsNeeded()
 void IpGoto::writeData()
 {
 	STATE_IDS();
+
+	if ( splitCold ) {
+		string cold = "_" + DATA_PREFIX() + "cold";
+		out <<
+			"#ifndef " << cold << "\n"
+			"#if defined(__GNUC__) && !defined(__clang__)\n"
+			"#define " << cold << " __attribute__((cold, unused))\n"
+			"#else\n"
+			"#define " << cold << "\n"
+			"#endif\n"
+			"#endif\n"
+			"\n";
+	}
 }
 
 void IpGoto::writeExec()
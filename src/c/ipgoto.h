@@ -73,6 +73,9 @@ protected:
 	void GOTO_HEADER( RedStateAp *state );
 	void STATE_GOTO_ERROR();
 
+	/* Marks the labels of cold states (--split-cold). */
+	string COLD( RedStateAp *state );
+
 	/* Set up labelNeeded flag for each state. */
 	void setLabelsNeeded( GenInlineList *inlineList );
 	void setLabelsNeeded();
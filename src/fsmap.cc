@@ -682,6 +682,27 @@ void FsmAp::clearAllPriorities()
 	}
 }
 
+/* Remove all action data from the states and transitions. The graph then
+ * differs from a plain recognizer of its language only in states that the
+ * actions kept apart, which minimization can merge. */
+void FsmAp::stripActions()
+{
+	for ( StateList::Iter state = stateList; state.lte(); state++ ) {
+		state->toStateActionTable.empty();
+		state->fromStateActionTable.empty();
+		state->outActionTable.empty();
+		state->errActionTable.empty();
+		state->eofActionTable.empty();
+
+		for ( TransList::Iter trans = state->outList; trans.lte(); trans++ ) {
+			for ( CondList::Iter cond = trans->condList; cond.lte(); cond++ ) {
+				cond->actionTable.empty();
+				cond->lmActionTable.empty();
+			}
+		}
+	}
+}
+
 /* Zeros out the function ordering keys. This may be called before minimization
  * when it is known that no more fsm operations are going to be done.  This
  * will achieve greater reduction as states will not be separated on the basis
@@ -81,7 +81,7 @@ void FsmAp::detachFromInList( StateAp *from, StateAp *to,
 CondAp *FsmAp::attachNewTrans( TransAp *trans, StateAp *from, StateAp *to, CondKey onChar )
 {
 	/* Sub-transition for conditions. */
-	CondAp *condAp = new CondAp( trans );
+	CondAp *condAp = new( ctx->condPool ) CondAp( trans );
 	condAp->key = onChar;
 	trans->condList.append( condAp );
 
@@ -101,7 +101,7 @@ CondAp *FsmAp::attachNewTrans( TransAp *trans, StateAp *from, StateAp *to, CondK
 TransAp *FsmAp::attachNewTrans( StateAp *from, StateAp *to, Key lowKey, Key highKey )
 {
 	/* Make the new transition. */
-	TransAp *retVal = new TransAp();
+	TransAp *retVal = new( ctx->transPool ) TransAp();
 
 	/* Make the entry in the out list for the transitions. */
 	from->outList.append( retVal );
@@ -111,7 +111,7 @@ TransAp *FsmAp::attachNewTrans( StateAp *from, StateAp *to, Key lowKey, Key high
 	retVal->highKey = highKey;
 
 	/* Sub-transition for conditions. */
-	CondAp *condAp = new CondAp( retVal );
+	CondAp *condAp = new( ctx->condPool ) CondAp( retVal );
 	retVal->condList.append( condAp );
 
 	condAp->fromState = from;
@@ -264,12 +264,12 @@ void FsmAp::detachState( StateAp *state )
 TransAp *FsmAp::dupTrans( StateAp *from, TransAp *srcTrans )
 {
 	/* Make a new transition. */
-	TransAp *newTrans = new TransAp();
+	TransAp *newTrans = new( ctx->transPool ) TransAp();
 	newTrans->condSpace = srcTrans->condSpace;
 
 	for ( CondList::Iter sc = srcTrans->condList; sc.lte(); sc++ ) {
 		/* Sub-transition for conditions. */
-		CondAp *newCond = new CondAp( newTrans );
+		CondAp *newCond = new( ctx->condPool ) CondAp( newTrans );
 		newCond->key = sc->key;
 		newTrans->condList.append( newCond );
 
@@ -291,7 +291,7 @@ TransAp *FsmAp::dupTrans( StateAp *from, TransAp *srcTrans )
 CondAp *FsmAp::dupCondTrans( StateAp *from, TransAp *destParent, CondAp *srcTrans )
 {
 	/* Sub-transition for conditions. */
-	CondAp *newCond = new CondAp( destParent );
+	CondAp *newCond = new( ctx->condPool ) CondAp( destParent );
 
 	/* We can attach the transition, one does not exist. */
 	attachTrans( from, srcTrans->toState, newCond );
@@ -321,24 +321,38 @@ CondAp *FsmAp::fsmAttachStates( MergeData &md, StateAp *from,
 	}
 	else {
 		/* The trans is not a double up. Dest trans cannot be the same as src
-		 * trans. Set up the state set. */
-		StateSet stateSet;
-
-		/* We go to all the states the existing trans goes to, plus... */
-		if ( existingState->stateDictEl == 0 )
-			stateSet.insert( existingState );
-		else
-			stateSet.insert( existingState->stateDictEl->stateSet );
+		 * trans. Set up the state set. We go to all the states the existing
+		 * trans goes to, plus all the states that we have been told to go
+		 * to. */
+		StateAp **set1 = &existingState, **set2 = &toState;
+		long len1 = 1, len2 = 1;
+		if ( existingState->stateDictEl != 0 ) {
+			set1 = existingState->stateDictEl->stateSet;
+			len1 = existingState->stateDictEl->length;
+		}
+		if ( toState->stateDictEl != 0 ) {
+			set2 = toState->stateDictEl->stateSet;
+			len2 = toState->stateDictEl->length;
+		}
 
-		/* ... all the states that we have been told to go to. */
-		if ( toState->stateDictEl == 0 )
-			stateSet.insert( toState );
-		else
-			stateSet.insert( toState->stateDictEl->stateSet );
+		/* Merge the sorted sets, dropping duplicates. */
+		Vector<StateAp*> &stateSet = md.setBuild;
+		stateSet.empty();
+		long i1 = 0, i2 = 0;
+		while ( i1 < len1 || i2 < len2 ) {
+			if ( i2 == len2 || ( i1 < len1 && set1[i1] < set2[i2] ) )
+				stateSet.append( set1[i1++] );
+			else if ( i1 == len1 || set2[i2] < set1[i1] )
+				stateSet.append( set2[i2++] );
+			else {
+				stateSet.append( set1[i1++] );
+				i2 += 1;
+			}
+		}
 
 		/* Look for the state. If it is not there already, make it. */
 		StateDictEl *lastFound;
-		if ( md.stateDict.insert( stateSet, &lastFound ) ) {
+		if ( md.stateDict.insert( stateSet.data, stateSet.length(), &lastFound ) ) {
 			/* Make a new state representing the combination of states in
 			 * stateSet. It gets added to the fill list.  This means that we
 			 * need to fill in it's transitions sometime in the future.  We
@@ -434,12 +448,12 @@ CondAp *FsmAp::crossCondTransitions( MergeData &md, StateAp *from, TransAp *dest
 TransAp *FsmAp::copyTransForExpanision( StateAp *fromState, TransAp *srcTrans )
 {
 	/* This is the dup without the attach. */
-	TransAp *newTrans = new TransAp();
+	TransAp *newTrans = new( ctx->transPool ) TransAp();
 	newTrans->condSpace = srcTrans->condSpace;
 
 	for ( CondList::Iter sc = srcTrans->condList; sc.lte(); sc++ ) {
 		/* Sub-transition for conditions. */
-		CondAp *newCond = new CondAp( newTrans );
+		CondAp *newCond = new( ctx->condPool ) CondAp( newTrans );
 		newCond->key = sc->key;
 
 		attachTrans( sc->fromState, sc->toState, newCond );
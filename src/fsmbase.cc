@@ -22,9 +22,143 @@
 #include "fsmgraph.h"
 
 #include <string.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <iostream>
 
+/* Nodes are preceded by a pointer to their pool. The header is sized to keep
+ * the nodes aligned. */
+union NodeHeader
+{
+	NodePool *pool;
+	long long alignLong;
+	double alignDouble;
+};
+
+/* Size of the slabs nodes are carved from. Slabs hold at least one node. They
+ * are above the size at which malloc maps blocks separately, so the memory
+ * goes back to the system when a pool is destroyed. */
+#define NODE_POOL_SLAB 262144
+
+NodePool::NodePool( size_t size )
+:
+	slabs(0),
+	slabNext(0),
+	slabEnd(0),
+	freeList(0),
+	numAllocs(0),
+	numLive(0),
+	maxLive(0),
+	slabBytes(0)
+{
+	/* Round the node size up to keep the next node aligned. */
+	nodeSize = sizeof(NodeHeader) + 
+			( size + sizeof(NodeHeader) - 1 ) / sizeof(NodeHeader) * sizeof(NodeHeader);
+}
+
+/* Release all the slabs. Any nodes still allocated become invalid. */
+NodePool::~NodePool()
+{
+	while ( slabs != 0 ) {
+		char *next = *(char**)slabs;
+		free( slabs );
+		slabs = next;
+	}
+}
+
+void *NodePool::allocate()
+{
+	char *block;
+	if ( freeList != 0 ) {
+		/* Reuse a deleted node. */
+		block = (char*)freeList - sizeof(NodeHeader);
+		freeList = *(void**)freeList;
+	}
+	else {
+		if ( slabNext == 0 || slabNext + nodeSize > slabEnd ) {
+			/* Need a new slab. The first node starts after the link. */
+			size_t size = sizeof(NodeHeader) + 
+					( nodeSize > NODE_POOL_SLAB ? nodeSize : NODE_POOL_SLAB );
+			char *slab = (char*)malloc( size );
+			if ( slab == 0 )
+				throw std::bad_alloc();
+
+			*(char**)slab = slabs;
+			slabs = slab;
+			slabNext = slab + sizeof(NodeHeader);
+			slabEnd = slab + size;
+			slabBytes += size;
+		}
+
+		block = slabNext;
+		slabNext += nodeSize;
+	}
+
+	((NodeHeader*)block)->pool = this;
+
+	numAllocs += 1;
+	numLive += 1;
+	if ( numLive > maxLive )
+		maxLive = numLive;
+
+	return block + sizeof(NodeHeader);
+}
+
+NodePool &NodePool::poolOf( const void *node )
+{
+	return *((NodeHeader*)node - 1)->pool;
+}
+
+/* Put a node on the freelist of its pool. */
+void NodePool::release( void *node )
+{
+	if ( node == 0 )
+		return;
+
+	NodePool &pool = poolOf( node );
+	*(void**)node = pool.freeList;
+	pool.freeList = node;
+	pool.numLive -= 1;
+}
+
+FsmCtx::FsmCtx()
+:
+	keyOps(new KeyOps),
+	condData(new CondData),
+	statePool(sizeof(StateAp)),
+	transPool(sizeof(TransAp)),
+	condPool(sizeof(CondAp)),
+	stateLimit(0),
+	memoryLimit(0),
+	limitExceeded(false),
+	numMinimizes(0)
+{
+}
+
+/* The pools release their slabs, freeing the nodes of every machine still in
+ * the context. */
+FsmCtx::~FsmCtx()
+{
+	delete keyOps;
+	delete condData;
+}
+
+long FsmCtx::nodeBytes()
+{
+	return statePool.slabBytes + transPool.slabBytes + condPool.slabBytes;
+}
+
+bool FsmCtx::overLimits( long numStates )
+{
+	if ( !limitExceeded ) {
+		if ( stateLimit > 0 && numStates > stateLimit )
+			limitExceeded = true;
+		else if ( memoryLimit > 0 && nodeBytes() > memoryLimit )
+			limitExceeded = true;
+	}
+	return limitExceeded;
+}
+
 
 /* Simple singly linked list append routine for the fill list. The new state
  * goes to the end of the list. */
@@ -44,6 +178,116 @@ void MergeData::fillListAppend( StateAp *state )
 	}
 }
 
+/* Size of the blocks that hold state dict elements. */
+#define STATE_DICT_BLOCK 65536
+
+StateDict::StateDict()
+:
+	buckets(0),
+	numBuckets(0),
+	numEls(0),
+	blocks(0),
+	blockNext(0),
+	blockEnd(0)
+{
+}
+
+StateDict::~StateDict()
+{
+	while ( blocks != 0 ) {
+		char *next = *(char**)blocks;
+		free( blocks );
+		blocks = next;
+	}
+	delete[] buckets;
+}
+
+/* Make an element with room for the states after it. */
+StateDictEl *StateDict::newEl( long length )
+{
+	size_t size = sizeof(StateDictEl) + sizeof(StateAp*) * length;
+	if ( blockNext == 0 || blockNext + size > blockEnd ) {
+		size_t blockSize = sizeof(NodeHeader) + 
+				( size > STATE_DICT_BLOCK ? size : STATE_DICT_BLOCK );
+		char *block = (char*)malloc( blockSize );
+		if ( block == 0 )
+			throw std::bad_alloc();
+
+		*(char**)block = blocks;
+		blocks = block;
+		blockNext = block + sizeof(NodeHeader);
+		blockEnd = block + blockSize;
+	}
+
+	StateDictEl *el = (StateDictEl*)blockNext;
+	blockNext += size;
+	el->stateSet = (StateAp**)(el + 1);
+	el->length = length;
+	return el;
+}
+
+/* Double the number of buckets. */
+void StateDict::rehash()
+{
+	long newNumBuckets = numBuckets == 0 ? 64 : numBuckets * 2;
+	StateDictEl **newBuckets = new StateDictEl*[newNumBuckets];
+	memset( newBuckets, 0, sizeof(StateDictEl*) * newNumBuckets );
+
+	for ( long b = 0; b < numBuckets; b++ ) {
+		StateDictEl *el = buckets[b];
+		while ( el != 0 ) {
+			StateDictEl *next = el->next;
+			long nb = el->hash & ( newNumBuckets - 1 );
+			el->next = newBuckets[nb];
+			newBuckets[nb] = el;
+			el = next;
+		}
+	}
+
+	delete[] buckets;
+	buckets = newBuckets;
+	numBuckets = newNumBuckets;
+}
+
+bool StateDict::insert( StateAp **stateSet, long length, StateDictEl **lastFound )
+{
+	/* Hash the state pointers. */
+	unsigned long hash = 14695981039346656037ULL;
+	for ( long s = 0; s < length; s++ ) {
+		hash ^= (unsigned long)stateSet[s];
+		hash *= 1099511628211ULL;
+	}
+	hash ^= hash >> 29;
+
+	if ( numBuckets > 0 ) {
+		for ( StateDictEl *el = buckets[hash & ( numBuckets - 1 )]; el != 0; el = el->next ) {
+			if ( el->hash == hash && el->length == length &&
+					memcmp( el->stateSet, stateSet, sizeof(StateAp*) * length ) == 0 )
+			{
+				*lastFound = el;
+				return false;
+			}
+		}
+	}
+
+	/* Not found. Keep the load factor at most one. */
+	if ( numEls >= numBuckets )
+		rehash();
+
+	StateDictEl *el = newEl( length );
+	memcpy( el->stateSet, stateSet, sizeof(StateAp*) * length );
+	el->hash = hash;
+	el->targState = 0;
+
+	long b = hash & ( numBuckets - 1 );
+	el->next = buckets[b];
+	buckets[b] = el;
+	numEls += 1;
+
+	*lastFound = el;
+	return true;
+}
+
 /* Graph constructor. */
 FsmAp::FsmAp( FsmCtx *ctx )
 :
@@ -85,7 +329,7 @@ FsmAp::FsmAp( const FsmAp &graph )
 	StateList::Iter origState = graph.stateList;
 	for ( ; origState.lte(); origState++ ) {
 		/* Make the new state. */
-		StateAp *newState = new StateAp( *origState );
+		StateAp *newState = new( ctx->statePool ) StateAp( *origState );
 
 		/* Add the state to the list.  */
 		stateList.append( newState );
@@ -135,12 +379,15 @@ FsmAp::FsmAp( const FsmAp &graph )
 		finStateSet.insert((*st)->alg.stateMap);
 }
 
-/* Deletes all transition data then deletes each state. */
+/* Deletes all transition data then deletes each state. The nodes go back to
+ * the pools of the context. */
 FsmAp::~FsmAp()
 {
 	/* Delete all the transitions. */
 	for ( StateList::Iter state = stateList; state.lte(); state++ ) {
 		/* Iterate the out transitions, deleting them. */
+		for ( TransList::Iter trans = state->outList; trans.lte(); trans++ )
+			trans->condList.empty();
 		state->outList.empty();
 	}
 
@@ -69,7 +69,7 @@ void FsmAp::expandConds( StateAp *fromState, TransAp *trans, const CondSet &from
 			CondList newItems;
 			for ( CondList::Iter cti = trans->condList; cti.lte(); cti++ ) {
 				/* Sub-transition for conditions. */
-				CondAp *cond = new CondAp( trans );
+				CondAp *cond = new( ctx->condPool ) CondAp( trans );
 
 				/* Attach only if our caller wants the expanded transitions
 				 * attached. */
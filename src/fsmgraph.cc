@@ -34,7 +34,7 @@ using std::endl;
 StateAp *FsmAp::addState()
 {
 	/* Make the new state to return. */
-	StateAp *state = new StateAp();
+	StateAp *state = new( ctx->statePool ) StateAp();
 
 	if ( misfitAccounting ) {
 		/* Create the new state on the misfit list. All states are created
@@ -98,6 +98,73 @@ void FsmAp::concatFsmCI( Key *str, int len )
 	setFinState( last );
 }
 
+int CmpKeyString::compare( const KeyString &ks1, const KeyString &ks2 )
+{
+	long length = ks1.length < ks2.length ? ks1.length : ks2.length;
+	for ( long i = 0; i < length; i++ ) {
+		if ( ctx->keyOps->lt( ks1.data[i], ks2.data[i] ) )
+			return -1;
+		else if ( ctx->keyOps->lt( ks2.data[i], ks1.data[i] ) )
+			return 1;
+	}
+
+	if ( ks1.length < ks2.length )
+		return -1;
+	else if ( ks1.length > ks2.length )
+		return 1;
+	return 0;
+}
+
+struct MergeSortKeyString
+	: public MergeSort<KeyString, CmpKeyString>
+{
+	MergeSortKeyString( FsmCtx *ctx )
+	{
+		CmpKeyString::ctx = ctx;
+	}
+};
+
+/* Construct a machine that matches any of the strings. The machine is a trie:
+ * strings share the states of their common prefixes, so no merging of states
+ * is needed. The strings are sorted in place. */
+void FsmAp::trieFsm( KeyString *strings, long numStrings )
+{
+	/* Sort the strings so that the strings with a common prefix are together
+	 * and the transitions out of each state are made in key order. */
+	MergeSortKeyString mergeSort( ctx );
+	mergeSort.sort( strings, numStrings );
+
+	StateAp *start = addState();
+	setStartState( start );
+
+	/* States along the path of the previous string. */
+	Vector<StateAp*> path;
+	path.append( start );
+
+	for ( long s = 0; s < numStrings; s++ ) {
+		/* Find the length of the prefix shared with the previous string. */
+		long common = 0;
+		if ( s > 0 ) {
+			KeyString &prev = strings[s-1];
+			while ( common < prev.length && common < strings[s].length &&
+					ctx->keyOps->eq( prev.data[common], strings[s].data[common] ) )
+				common += 1;
+		}
+
+		/* Branch off the path where the strings differ. */
+		path.remove( common + 1, path.length() - common - 1 );
+		StateAp *last = path[common];
+		for ( long k = common; k < strings[s].length; k++ ) {
+			StateAp *newState = addState();
+			attachNewTrans( last, newState, strings[s].data[k], strings[s].data[k] );
+			path.append( newState );
+			last = newState;
+		}
+
+		setFinState( last );
+	}
+}
+
 /* Construct a machine that matches one character.  A new machine will be made
  * that has two states with a single transition between the states. IsSigned
  * determines if the integers are to be considered as signed or unsigned ints. */
@@ -255,6 +322,12 @@ void FsmAp::repeatOp( int times )
 	if ( times == 1 )
 		return;
 
+	/* Concatenation only splices when the final states have no way out. */
+	if ( !finStateHasOutTrans() ) {
+		doublingRepeat( times, false );
+		return;
+	}
+
 	/* Make a machine to make copies from. */
 	FsmAp *copyFrom = new FsmAp( *this );
 
@@ -279,6 +352,11 @@ void FsmAp::optionalRepeatOp( int times )
 		return;
 	}
 
+	if ( !finStateHasOutTrans() ) {
+		doublingRepeat( times, true );
+		return;
+	}
+
 	/* Make a machine to make copies from. */
 	FsmAp *copyFrom = new FsmAp( *this );
 
@@ -316,6 +394,77 @@ void FsmAp::optionalRepeatOp( int times )
 	doConcat( copyFrom, &lastFinSet, true );
 }
 
+/* Returns true if any final state has out transitions. */
+bool FsmAp::finStateHasOutTrans()
+{
+	for ( StateSet::Iter state = finStateSet; state.lte(); state++ ) {
+		if ( (*state)->outList.length() > 0 )
+			return true;
+	}
+	return false;
+}
+
+/* Repetition by doubling. Working down from the highest bit of times, the
+ * machine is concatenated with a copy of itself, then with one more copy of
+ * the original when the bit is set. This takes a number of concatenations
+ * that is logarithmic in times. Concatenating a machine with a copy of itself
+ * can create many more states than concatenating one copy at a time does, so
+ * this is only used when the final states have no out transitions. Then each
+ * concatenation just splices the start state of the copy onto the final
+ * states. The concatenations go from the final states of the last copy,
+ * which are picked out of copies with STB_GRAPH2. */
+void FsmAp::doublingRepeat( int times, bool optional )
+{
+	/* Make a machine to make copies from. All of its final states belong to
+	 * the last copy. */
+	FsmAp *copyFrom = new FsmAp( *this );
+	copyFrom->setFinBits( STB_GRAPH2 );
+
+	StateSet lastFinSet( finStateSet );
+
+	int bit = 1;
+	while ( bit <= times / 2 )
+		bit *= 2;
+
+	for ( bit /= 2; bit > 0; bit /= 2 ) {
+		int numCopies = ( times & bit ) ? 2 : 1;
+		for ( int c = 0; c < numCopies; c++ ) {
+			FsmAp *dup;
+			if ( c == 0 ) {
+				/* Double what we have so far. */
+				for ( StateSet::Iter state = lastFinSet; state.lte(); state++ )
+					(*state)->stateBits |= STB_GRAPH2;
+				dup = new FsmAp( *this );
+				for ( StateSet::Iter state = lastFinSet; state.lte(); state++ )
+					(*state)->stateBits &= ~STB_GRAPH2;
+			}
+			else {
+				/* One more copy for a set bit. */
+				dup = new FsmAp( *copyFrom );
+			}
+
+			doConcat( dup, &lastFinSet, optional );
+
+			/* The final states that came from the copy are now the final
+			 * states of the last copy. */
+			lastFinSet.empty();
+			for ( int i = 0; i < finStateSet.length(); i++ ) {
+				StateAp *fs = finStateSet[i];
+				if ( fs->stateBits & STB_GRAPH2 ) {
+					lastFinSet.insert( fs );
+					fs->stateBits &= ~STB_GRAPH2;
+				}
+			}
+		}
+	}
+
+	delete copyFrom;
+
+	/* Set the initial state final to allow zero copies. */
+	if ( optional )
+		setFinState( startState );
+}
+
 
 /* Fsm concatentation worker. Supports treating the concatentation as optional,
  * which essentially leaves the final states of machine one as final. */
@@ -899,7 +1048,7 @@ void FsmAp::isolateStartState( )
 
 	/* Stfil and stateDict will be empty because the merging of the old start
 	 * state into the new one will not have any conflicting transitions. */
-	assert( md.stateDict.treeSize == 0 );
+	assert( md.stateDict.length() == 0 );
 	assert( md.stfillHead == 0 );
 
 	/* The old start state may be unreachable. Remove the misfits and turn off
@@ -982,24 +1131,25 @@ void FsmAp::fillInStates( MergeData &md )
 	 * other states to be added to the stfil list. */
 	StateAp *state = md.stfillHead;
 	while ( state != 0 ) {
-		StateSet *stateSet = &state->stateDictEl->stateSet;
-		mergeStates( md, state, stateSet->data, stateSet->length() );
+		/* Stop growing the machine once it is over the limits. States still
+		 * on the fill list are left without their out transitions. */
+		if ( ctx->overLimits( stateList.length() ) )
+			break;
+
+		StateDictEl *el = state->stateDictEl;
+		mergeStates( md, state, el->stateSet, el->length );
 		state = state->alg.next;
 	}
 
-	/* Delete the state sets of all states that are on the fill list. */
+	/* Reset the state sets of all states that are on the fill list. The
+	 * elements are freed with the state dict. */
 	state = md.stfillHead;
 	while ( state != 0 ) {
-		/* Delete and reset the state set. */
-		delete state->stateDictEl;
 		state->stateDictEl = 0;
 
 		/* Next state in the stfill list. */
 		state = state->alg.next;
 	}
-
-	/* StateDict will still have its ptrs/size set but all of it's element
-	 * will be deleted so we don't need to clean it up. */
 }
 
 
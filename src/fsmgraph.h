@@ -39,6 +39,7 @@
 #include "avlset.h"
 #include "avlmap.h"
 #include "ragel.h"
+#include "timings.h"
 
 /* Flags that control merging. */
 #define STB_GRAPH1     0x01
@@ -65,19 +66,79 @@ struct FsmListEl
 	StateAp *prev, *next;
 };
 
-/* This is the marked index for a state pair. Used in minimization. It keeps
- * track of whether or not the state pair is marked. */
+/* Slab allocator for graph nodes of one type. Nodes are carved out of large
+ * slabs and deleted nodes go on a freelist for reuse. Each node is preceded
+ * by a pointer to its pool, so a node can be deleted without knowing where it
+ * came from. The slabs are released when the pool goes away. */
+struct NodePool
+{
+	NodePool( size_t size );
+	~NodePool();
+
+	void *allocate();
+	static void release( void *node );
+
+	/* The pool a node was allocated from. */
+	static NodePool &poolOf( const void *node );
+
+	/* Size of a node, including the header. */
+	size_t nodeSize;
+
+	/* List of slabs, linked through their first word. */
+	char *slabs;
+	char *slabNext, *slabEnd;
+
+	/* Deleted nodes, linked through the space after the header. */
+	void *freeList;
+
+	/* Statistics. */
+	long numAllocs;
+	long numLive;
+	long maxLive;
+	long slabBytes;
+};
+
+/* This is the marked index for state pairs. Used in stable minimization. It
+ * keeps track of whether or not a state pair is marked. Rather than storing a
+ * flag for every pair, the states are kept in classes of unmarked pairs: a
+ * pair is marked exactly when its states are in different classes. Marking
+ * only ever splits classes, so space is linear in the number of states. The
+ * states of a class sit together in the members array, with states that need
+ * to be reconsidered moved to the front. */
 struct MarkIndex
 {
 	MarkIndex(int states);
 	~MarkIndex();
 
-	void markPair(int state1, int state2);
-	bool isPairMarked(int state1, int state2);
+	bool isPairMarked(int state1, int state2)
+		{ return classOf[state1] != classOf[state2]; }
+
+	/* Move a state to the front of its class for reconsideration. */
+	void touch( StateAp *state );
 
-private:
 	int numStates;
-	bool *array;
+	int numClasses;
+
+	StateAp **members;
+	int *loc;
+	int *classOf;
+	int *first;
+	int *past;
+	int *numTouched;
+
+	/* Classes that have touched states. */
+	int *touchedClasses;
+	int numTouchedClasses;
+
+	/* States that went to a new class in the last round. */
+	StateAp **moved;
+	int numMoved;
+
+	/* States with an EOF target. There is no in list for these. */
+	StateAp **eofStates;
+	int numEofStates;
+
+	StateAp **scratch;
 };
 
 /* Transistion Action Element. */
@@ -432,6 +493,13 @@ struct CondAp
 	{
 	}
 
+	static void *operator new( size_t, NodePool &pool )
+		{ return pool.allocate(); }
+	static void operator delete( void *ptr, NodePool & )
+		{ NodePool::release( ptr ); }
+	static void operator delete( void *ptr )
+		{ NodePool::release( ptr ); }
+
 	/* Owning transition. */
 	TransAp *transAp;
 
@@ -476,6 +544,13 @@ struct TransAp
 		//	condList.abandon();
 	}
 
+	static void *operator new( size_t, NodePool &pool )
+		{ return pool.allocate(); }
+	static void operator delete( void *ptr, NodePool & )
+		{ NodePool::release( ptr ); }
+	static void operator delete( void *ptr )
+		{ NodePool::release( ptr ); }
+
 	long condFullSize();
 
 	Key lowKey, highKey;
@@ -496,21 +571,47 @@ typedef DList<TransAp> TransList;
 typedef BstSet<StateAp*> StateSet;
 typedef DList<StateAp> StateList;
 
-/* A element in a state dict. */
+/* A element in a state dict. The states are sorted and are stored right after
+ * the element, in memory owned by the dict. They never change once the
+ * element is made. */
 struct StateDictEl 
-:
-	public AvlTreeEl<StateDictEl>
 {
-	StateDictEl(const StateSet &stateSet) 
-		: stateSet(stateSet) { }
-
-	const StateSet &getKey() { return stateSet; }
-	StateSet stateSet;
+	StateAp **stateSet;
+	long length;
+	unsigned long hash;
 	StateAp *targState;
+
+	/* Next in the hash bucket. */
+	StateDictEl *next;
 };
 
-/* Dictionary mapping a set of states to a target state. */
-typedef AvlTree< StateDictEl, StateSet, CmpTable<StateAp*> > StateDict;
+/* Dictionary mapping a set of states to a target state. Sets are found by
+ * their hash, so a probe compares states only when the hashes agree. Elements
+ * live until the dict is destroyed. */
+struct StateDict
+{
+	StateDict();
+	~StateDict();
+
+	/* Find the element for a sorted set of states. If it is not there then it
+	 * is made and true is returned. */
+	bool insert( StateAp **stateSet, long length, StateDictEl **lastFound );
+
+	long length() const
+		{ return numEls; }
+
+	StateDictEl **buckets;
+	long numBuckets;
+	long numEls;
+
+	/* Blocks that hold the elements, linked through their first word. */
+	char *blocks;
+	char *blockNext, *blockEnd;
+
+private:
+	StateDictEl *newEl( long length );
+	void rehash();
+};
 
 /* Data needed for a merge operation. */
 struct MergeData
@@ -523,9 +624,27 @@ struct MergeData
 	StateAp *stfillHead;
 	StateAp *stfillTail;
 
+	/* Scratch space for building state sets. */
+	Vector<StateAp*> setBuild;
+
 	void fillListAppend( StateAp *state );
 };
 
+/* A string of keys. Used for building a trie of literals. */
+struct KeyString
+{
+	Key *data;
+	long length;
+};
+
+/* Orders key strings, for bringing common prefixes together. */
+struct CmpKeyString
+{
+	CmpKeyString( FsmCtx *ctx = 0 ) : ctx(ctx) {}
+	int compare( const KeyString &ks1, const KeyString &ks2 );
+	FsmCtx *ctx;
+};
+
 struct TransEl
 {
 	/* Constructors. */
@@ -546,7 +665,7 @@ struct CmpKey
 
 	KeyOps *keyOps;
 
-	int compare( const Key key1, const Key key2 )
+	int compare( const Key key1, const Key key2 ) const
 	{
 		if ( keyOps->lt( key1, key2 ) )
 			return -1;
@@ -663,13 +782,34 @@ struct CondData
  * structure. */
 struct FsmCtx
 {
-	FsmCtx() {
-		keyOps = new KeyOps;
-		condData = new CondData;
-	}
+	FsmCtx();
+	~FsmCtx();
 
 	KeyOps *keyOps;
 	CondData *condData;
+
+	/* Graph nodes of all machines in the context. */
+	NodePool statePool;
+	NodePool transPool;
+	NodePool condPool;
+
+	/* Bytes held by the node pools. */
+	long nodeBytes();
+
+	/* Check the state count of a machine under construction and the node
+	 * memory against the limits. Once a limit is exceeded it stays exceeded
+	 * and operations stop adding states. */
+	bool overLimits( long numStates );
+
+	/* Limits on the states in one machine and on node memory, zero for no
+	 * limit. */
+	long stateLimit;
+	long memoryLimit;
+	bool limitExceeded;
+
+	/* Time spent minimizing after operations, collected for --timings. */
+	TimeStamp minimizeTime;
+	long numMinimizes;
 };
 
 
@@ -680,6 +820,13 @@ struct StateAp
 	StateAp(const StateAp &other);
 	~StateAp();
 
+	static void *operator new( size_t, NodePool &pool )
+		{ return pool.allocate(); }
+	static void operator delete( void *ptr, NodePool & )
+		{ NodePool::release( ptr ); }
+	static void operator delete( void *ptr )
+		{ NodePool::release( ptr ); }
+
 	/* Is the state final? */
 	bool isFinState() { return stateBits & STB_ISFINAL; }
 
@@ -1226,15 +1373,17 @@ public:
 	FsmCtx *ctx;
 };
 
-/* Compare class for a minimization that marks pairs. Provides the shouldMark
- * routine. */
+/* Compare class for a minimization that marks pairs. Orders states by the
+ * classes of their targets, so that states that compare differently should
+ * have their pair marked. */
 class MarkCompare
 {
 public:
-	MarkCompare( FsmCtx *ctx ) : ctx(ctx) { }
-	bool shouldMark( MarkIndex &markIndex, const StateAp *pState1, 
-			const StateAp *pState2 );
+	MarkCompare( FsmCtx *ctx = 0, MarkIndex *markIndex = 0 )
+		: ctx(ctx), markIndex(markIndex) { }
+	int compare( const StateAp *pState1, const StateAp *pState2 );
 	FsmCtx *ctx;
+	MarkIndex *markIndex;
 };
 
 /* List of partitions. */
@@ -1364,6 +1513,9 @@ struct FsmAp
 	/* Zero out all the function keys. */
 	void nullActionKeys();
 
+	/* Remove all actions, leaving only the language that is matched. */
+	void stripActions();
+
 	/* Walk the list of states and verify state properties. */
 	void verifyStates();
 
@@ -1482,9 +1634,11 @@ struct FsmAp
 
 	static int comparePart( TransAp *trans1, TransAp *trans2 );
 
-	/* Check marked status of target states. Either pointer may be null. */
-	static bool shouldMarkPtr( MarkIndex &markIndex, 
+	/* Compare marked classes of target states. Either pointer may be null. */
+	static int compareTransMarkPtr( MarkIndex &markIndex, 
 			TransAp *trans1, TransAp *trans2 );
+	static int compareCondMarkPtr( MarkIndex &markIndex, 
+			CondAp *trans1, CondAp *trans2 );
 
 	/*
 	 * Callbacks.
@@ -1517,6 +1671,7 @@ struct FsmAp
 	void concatFsm( Key *str, int len );
 	void concatFsmCI( Key *str, int len );
 	void orFsm( Key *set, int len );
+	void trieFsm( KeyString *strings, long numStrings );
 	void rangeFsm( Key low, Key high );
 	void rangeStarFsm( Key low, Key high );
 	void emptyFsm( );
@@ -1559,6 +1714,10 @@ struct FsmAp
 	void doConcat( FsmAp *other, StateSet *fromStates, bool optional );
 	void doOr( FsmAp *other );
 
+	/* Workers for repetition. */
+	bool finStateHasOutTrans();
+	void doublingRepeat( int times, bool optional );
+
 	/*
 	 * Final states
 	 */
@@ -1632,9 +1791,15 @@ struct FsmAp
 	void minimizePartition1();
 	void minimizePartition2();
 
+	/* Minimization by Hopcroft's algorithm. Produces the same result as
+	 * partitioning, in O(m log n) time on the transitions. */
+	void minimizeHopcroft();
+
 	/* Minimize the final state Machine. The result is the minimal fsm. Slow
-	 * but stable, correct minimization. Uses n^2 space (lookout) and average
-	 * n^2 time. Worst case n^3 time, but a that is a very rare case. */
+	 * but stable, correct minimization. States are fused into the first
+	 * equivalent state on the list. Uses linear space. Each marking round
+	 * only reconsiders states with a transition into a state that changed
+	 * class in the previous round. */
 	void minimizeStable();
 
 	/* Minimize the final state machine. Does not find the minimal fsm, but a
@@ -1662,8 +1827,9 @@ struct FsmAp
 	 * alot of pairs. */
 	void initialMarkRound( MarkIndex &markIndex );
 
-	/* One marking round on all state pairs. Considers if trans pairs go
-	 * to a marked state only. Returns whether or not a pair was marked. */
+	/* One marking round on the state pairs that may have changed. Considers
+	 * if trans pairs go to a marked state only. Returns whether or not a pair
+	 * was marked. */
 	bool markRound( MarkIndex &markIndex );
 
 	/* Move the in trans into src into dest. */
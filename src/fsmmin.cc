@@ -19,6 +19,7 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
  */
 
+#include <string.h>
 #include "fsmgraph.h"
 #include "mergesort.h"
 
@@ -53,7 +54,7 @@ int FsmAp::partitionRound( StateAp **statePtrs, MinPartition *parts, int numPart
 {
 	/* Need a mergesort object and a single partition compare. */
 	MergeSortPartition mergeSort( ctx );
-	PartitionCompare partCompare;
+	PartitionCompare partCompare( ctx );
 
 	/* For each partition. */
 	for ( int p = 0; p < numParts; p++ ) {
@@ -367,57 +368,539 @@ void FsmAp::minimizePartition2()
 	delete[] parts;
 }
 
-void FsmAp::initialMarkRound( MarkIndex &markIndex )
+/* A labelled transition, used by the Hopcroft minimization. The label is
+ * made up of the initial partition of the source state, the segment of the
+ * key space and the condition key. States in the same initial partition agree
+ * on all transition data for every key, so their transitions can be split up
+ * on the common set of key boundaries and compared by segment. The keys are
+ * kept as their values so that the struct can be sorted with memcpy. */
+struct MinTrans
+{
+	int initPart;
+	bool eof;
+	long lowKey;
+	long condKey;
+
+	int fromState;
+	int toState;
+};
+
+/* Compares the labels of transitions for the initial grouping. */
+struct MinTransCompare
+{
+	MinTransCompare( FsmCtx *ctx = 0 ) : ctx(ctx) { }
+
+	int compare( const MinTrans &t1, const MinTrans &t2 )
+	{
+		if ( t1.initPart < t2.initPart )
+			return -1;
+		else if ( t1.initPart > t2.initPart )
+			return 1;
+		else if ( t1.eof < t2.eof )
+			return -1;
+		else if ( t1.eof > t2.eof )
+			return 1;
+		else if ( ctx->keyOps->lt( t1.lowKey, t2.lowKey ) )
+			return -1;
+		else if ( ctx->keyOps->gt( t1.lowKey, t2.lowKey ) )
+			return 1;
+		else if ( t1.condKey < t2.condKey )
+			return -1;
+		else if ( t1.condKey > t2.condKey )
+			return 1;
+		return 0;
+	}
+
+	FsmCtx *ctx;
+};
+
+/* Compares key values by the signedness of the alphabet. */
+struct CmpMinKey
+{
+	CmpMinKey()
+		: keyOps(0) {}
+
+	KeyOps *keyOps;
+
+	int compare( const long key1, const long key2 ) const
+	{
+		if ( keyOps->lt( key1, key2 ) )
+			return -1;
+		else if ( keyOps->gt( key1, key2 ) )
+			return 1;
+		else
+			return 0;
+	}
+};
+
+/* Set of key values, for the segment starts of a partition. */
+struct MinKeySet
+:
+	public BstSet<long, CmpMinKey>
+{
+	MinKeySet( KeyOps *keyOps )
+	{
+		CmpMinKey::keyOps = keyOps;
+	}
+};
+
+struct MergeSortMinTrans
+	: public MergeSort<MinTrans, MinTransCompare>
+{
+	MergeSortMinTrans( FsmCtx *ctx )
+	{
+		MinTransCompare::ctx = ctx;
+	}
+};
+
+/* Partition of the integers 0 .. n-1 that supports splitting off the marked
+ * elements of a set. The elements of a set occupy the range first .. past-1 of
+ * elems and marked elements are kept at the front of the range. The marked
+ * counts and the list of sets with marks are shared by the two partitions of
+ * the Hopcroft minimization, only one of which is being split at any time. */
+struct RefinablePartition
+{
+	RefinablePartition( int n, int *marked, int *touched );
+	~RefinablePartition();
+
+	void mark( int el );
+	void split();
+
+	int numSets;
+	int *elems;
+	int *loc;
+	int *set;
+	int *first;
+	int *past;
+
+	int *marked;
+	int *touched;
+	int numTouched;
+};
+
+RefinablePartition::RefinablePartition( int n, int *marked, int *touched )
+:
+	numSets(0),
+	elems(new int[n]),
+	loc(new int[n]),
+	set(new int[n]),
+	first(new int[n]),
+	past(new int[n]),
+	marked(marked),
+	touched(touched),
+	numTouched(0)
+{
+}
+
+RefinablePartition::~RefinablePartition()
+{
+	delete[] elems;
+	delete[] loc;
+	delete[] set;
+	delete[] first;
+	delete[] past;
+}
+
+/* Move an element to the marked front of its set. */
+void RefinablePartition::mark( int el )
+{
+	int s = set[el];
+	int i = loc[el];
+	int j = first[s] + marked[s];
+
+	elems[i] = elems[j];
+	loc[elems[i]] = i;
+	elems[j] = el;
+	loc[el] = j;
+
+	if ( marked[s]++ == 0 )
+		touched[numTouched++] = s;
+}
+
+/* Split every set that has some, but not all, of its elements marked. The
+ * smaller of the two parts always becomes the new set. */
+void RefinablePartition::split()
 {
-	/* P and q for walking pairs. */
-	StateAp *p = stateList.head, *q;
+	while ( numTouched > 0 ) {
+		int s = touched[--numTouched];
+		int j = first[s] + marked[s];
+
+		if ( j == past[s] ) {
+			/* Everything marked, no split. */
+			marked[s] = 0;
+			continue;
+		}
+
+		if ( marked[s] <= past[s] - j ) {
+			/* Marked part is smaller. */
+			first[numSets] = first[s];
+			past[numSets] = first[s] = j;
+		}
+		else {
+			/* Unmarked part is smaller. */
+			past[numSets] = past[s];
+			first[numSets] = past[s] = j;
+		}
+
+		for ( int i = first[numSets]; i < past[numSets]; i++ )
+			set[elems[i]] = numSets;
+
+		marked[s] = marked[numSets] = 0;
+		numSets += 1;
+	}
+}
 
-	/* Need an initial partition compare. */
+/**
+ * \brief Minimize by Hopcroft's partition refinement.
+ *
+ * Computes the same partitioning as the other partition minimizations, but
+ * instead of repeatedly sorting whole partitions it refines using only the
+ * transitions into the smaller half of each split, giving O(m log n) time for
+ * m transitions and n states. This is the transition-labelled formulation of
+ * Valmari and Lehtinen. Produces the most minimal fsm possible.
+ */
+void FsmAp::minimizeHopcroft()
+{
+	/* Need a mergesort and an initial partition compare. */
+	MergeSortInitPartition mergeSort( ctx );
 	InitPartitionCompare initPartCompare( ctx );
 
-	/* Walk all unordered pairs of (p, q) where p != q.
-	 * The second depth of the walk stops before reaching p. This
-	 * gives us all unordered pairs of states (p, q) where p != q. */
-	while ( p != 0 ) {
-		q = stateList.head;
-		while ( q != p ) {
-			/* If the states differ on final state status, out transitions or
-			 * any transition data then they should be separated on the initial
-			 * round. */
-			if ( initPartCompare.compare( p, q ) != 0 )
-				markIndex.markPair( p->alg.stateNum, q->alg.stateNum );
-
-			q = q->next;
+	/* Nothing to do if there are no states. */
+	if ( stateList.length() == 0 )
+		return;
+
+	/* Make a array of pointers to states. */
+	int numStates = stateList.length();
+	StateAp** statePtrs = new StateAp*[numStates];
+
+	/* Fill up an array of pointers to the states for easy sorting. */
+	StateList::Iter state = stateList;
+	for ( int s = 0; state.lte(); state++, s++ )
+		statePtrs[s] = state;
+		
+	/* Sort the states using the initial partition compare. States in the
+	 * same initial partition end up next to each other. From here on states
+	 * are identified by their position in the sorted array. */
+	mergeSort.sort( statePtrs, numStates );
+
+	int *initPart = new int[numStates];
+	int numInitParts = 0;
+	for ( int s = 0; s < numStates; s++ ) {
+		if ( s > 0 && initPartCompare.compare( statePtrs[s-1], statePtrs[s] ) < 0 )
+			numInitParts += 1;
+		initPart[s] = numInitParts;
+		statePtrs[s]->alg.stateNum = s;
+	}
+	numInitParts += 1;
+
+	/* Make the labelled transitions. Transitions to the error state are left
+	 * out. A state having such a transition then differs from a state that
+	 * goes to a real state on the same label, just as it does in the
+	 * partition compare. */
+	Vector<MinTrans> transVect;
+	for ( int s = 0, partEnd = 0; s < numStates; s = partEnd ) {
+		/* Find the range of states in the initial partition. */
+		partEnd = s + 1;
+		while ( partEnd < numStates && initPart[partEnd] == initPart[s] )
+			partEnd += 1;
+
+		/* Collect the start of every key segment used by the partition. */
+		MinKeySet segStarts( ctx->keyOps );
+		for ( int p = s; p < partEnd; p++ ) {
+			for ( TransList::Iter trans = statePtrs[p]->outList; trans.lte(); trans++ ) {
+				segStarts.insert( trans->lowKey.getVal() );
+				if ( ctx->keyOps->lt( trans->highKey, ctx->keyOps->maxKey ) ) {
+					Key nextKey = trans->highKey;
+					ctx->keyOps->increment( nextKey );
+					segStarts.insert( nextKey.getVal() );
+				}
+			}
+		}
+
+		for ( int p = s; p < partEnd; p++ ) {
+			StateAp *st = statePtrs[p];
+			for ( TransList::Iter trans = st->outList; trans.lte(); trans++ ) {
+				/* Walk the segments covered by the transition. */
+				long *seg = segStarts.find( trans->lowKey.getVal() );
+				long *segEnd = segStarts.data + segStarts.length();
+				for ( ; seg < segEnd && ctx->keyOps->le( *seg, trans->highKey ); seg++ ) {
+					for ( CondList::Iter cond = trans->condList; cond.lte(); cond++ ) {
+						if ( cond->toState != 0 ) {
+							MinTrans mt;
+							mt.initPart = initPart[p];
+							mt.eof = false;
+							mt.lowKey = *seg;
+							mt.condKey = cond->key.getVal();
+							mt.fromState = p;
+							mt.toState = cond->toState->alg.stateNum;
+							transVect.append( mt );
+						}
+					}
+				}
+			}
+
+			if ( st->eofTarget != 0 ) {
+				MinTrans mt;
+				mt.initPart = initPart[p];
+				mt.eof = true;
+				mt.lowKey = 0;
+				mt.condKey = 0;
+				mt.fromState = p;
+				mt.toState = st->eofTarget->alg.stateNum;
+				transVect.append( mt );
+			}
+		}
+	}
+
+	int numTrans = transVect.length();
+	MinTrans *trans = transVect.data;
+
+	/* Group the transitions by label. */
+	MergeSortMinTrans transSort( ctx );
+	transSort.sort( trans, numTrans );
+
+	/* Marked counts and touched sets are shared by both partitions. */
+	int maxEls = numStates > numTrans ? numStates : numTrans;
+	int *marked = new int[maxEls+1];
+	int *touched = new int[maxEls+1];
+	memset( marked, 0, sizeof(int) * (maxEls+1) );
+
+	/* The blocks of states start out as the initial partitioning. */
+	RefinablePartition blocks( numStates, marked, touched );
+	for ( int s = 0; s < numStates; s++ ) {
+		blocks.elems[s] = blocks.loc[s] = s;
+		blocks.set[s] = initPart[s];
+		if ( s == 0 || initPart[s-1] != initPart[s] )
+			blocks.first[initPart[s]] = s;
+		blocks.past[initPart[s]] = s + 1;
+	}
+	blocks.numSets = numInitParts;
+
+	/* The cords of transitions start out as the groups of equal labels. */
+	MinTransCompare transCompare( ctx );
+	RefinablePartition cords( numTrans > 0 ? numTrans : 1, marked, touched );
+	for ( int t = 0; t < numTrans; t++ ) {
+		if ( t == 0 || transCompare.compare( trans[t-1], trans[t] ) < 0 ) {
+			cords.first[cords.numSets] = t;
+			cords.numSets += 1;
+		}
+		cords.elems[t] = cords.loc[t] = t;
+		cords.set[t] = cords.numSets - 1;
+		cords.past[cords.numSets - 1] = t + 1;
+	}
+
+	/* Index the transitions by target state. */
+	int *inFirst = new int[numStates+1];
+	int *inTrans = new int[numTrans > 0 ? numTrans : 1];
+	memset( inFirst, 0, sizeof(int) * (numStates+1) );
+	for ( int t = 0; t < numTrans; t++ )
+		inFirst[trans[t].toState] += 1;
+	for ( int s = 0; s < numStates; s++ )
+		inFirst[s+1] += inFirst[s];
+	for ( int t = numTrans - 1; t >= 0; t-- )
+		inTrans[--inFirst[trans[t].toState]] = t;
+
+	/* Split blocks by each cord, then split cords by each new block. All
+	 * blocks but the first are used as splitters. New blocks are always
+	 * the smaller part of a split. */
+	int block = 1, cord = 0;
+	while ( cord < cords.numSets ) {
+		for ( int i = cords.first[cord]; i < cords.past[cord]; i++ )
+			blocks.mark( trans[cords.elems[i]].fromState );
+		blocks.split();
+		cord += 1;
+
+		while ( block < blocks.numSets ) {
+			for ( int i = blocks.first[block]; i < blocks.past[block]; i++ ) {
+				int s = blocks.elems[i];
+				for ( int j = inFirst[s]; j < inFirst[s+1]; j++ )
+					cords.mark( inTrans[j] );
+			}
+			cords.split();
+			block += 1;
+		}
+	}
+
+	/* We are about to move all the states from the main list into partitions
+	 * without taking them off the main list. So clean up the main list now. */
+	stateList.abandon();
+
+	/* Put the states into partitions. */
+	int numParts = blocks.numSets;
+	MinPartition *parts = new MinPartition[numParts];
+	for ( int s = 0; s < numStates; s++ ) {
+		statePtrs[s]->alg.partition = &parts[blocks.set[s]];
+		parts[blocks.set[s]].list.append( statePtrs[s] );
+	}
+
+	/* Fuse states in the same partition. The states will end up back on the
+	 * main list. */
+	fusePartitions( parts, numParts );
+
+	/* Cleanup. */
+	delete[] statePtrs;
+	delete[] initPart;
+	delete[] marked;
+	delete[] touched;
+	delete[] inFirst;
+	delete[] inTrans;
+	delete[] parts;
+}
+
+void FsmAp::initialMarkRound( MarkIndex &markIndex )
+{
+	/* Need a mergesort and an initial partition compare. */
+	MergeSortInitPartition mergeSort( ctx );
+	InitPartitionCompare initPartCompare( ctx );
+
+	/* Fill the members array with the states. */
+	StateList::Iter state = stateList;
+	for ( int s = 0; state.lte(); state++, s++ ) {
+		markIndex.members[s] = state;
+		if ( state->eofTarget != 0 )
+			markIndex.eofStates[markIndex.numEofStates++] = state;
+	}
+
+	/* If the states differ on final state status, out transitions or any
+	 * transition data then they should be separated on the initial round.
+	 * Sorting brings the states of each class together. */
+	int numStates = markIndex.numStates;
+	mergeSort.sort( markIndex.members, numStates );
+
+	/* Assign the classes. Every state is new to its class. */
+	for ( int s = 0; s < numStates; s++ ) {
+		StateAp *st = markIndex.members[s];
+		if ( s == 0 || initPartCompare.compare( markIndex.members[s-1], st ) < 0 ) {
+			markIndex.first[markIndex.numClasses] = s;
+			markIndex.numClasses += 1;
 		}
-		p = p->next;
+
+		int c = markIndex.numClasses - 1;
+		markIndex.past[c] = s + 1;
+		markIndex.classOf[st->alg.stateNum] = c;
+		markIndex.loc[st->alg.stateNum] = s;
+		markIndex.moved[markIndex.numMoved++] = st;
 	}
 }
 
+struct MergeSortMark
+	: public MergeSort<StateAp*, MarkCompare>
+{
+	MergeSortMark( FsmCtx *ctx, MarkIndex *markIndex )
+	{
+		MarkCompare::ctx = ctx;
+		MarkCompare::markIndex = markIndex;
+	}
+};
+
 bool FsmAp::markRound( MarkIndex &markIndex )
 {
-	/* P an q for walking pairs. Take note if any pair gets marked. */
-	StateAp *p = stateList.head, *q;
+	/* Take note if any pair gets marked. */
 	bool pairWasMarked = false;
 
 	/* Need a mark comparison. */
-	MarkCompare markCompare( ctx );
+	MergeSortMark mergeSort( ctx, &markIndex );
+	MarkCompare markCompare( ctx, &markIndex );
+
+	/* New classes get their state mappings after all the touched classes
+	 * are split, so every comparison in the round sees the same classes. */
+	int firstNewClass = markIndex.numClasses;
+
+	/* A pair can only become marked if one of the states has a transition
+	 * into a state that changed class in the last round. Touch the states
+	 * with transitions into the moved states. We have no in list for EOF
+	 * targets, so the states with them are always touched. */
+	for ( int m = 0; m < markIndex.numMoved; m++ ) {
+		StateAp *state = markIndex.moved[m];
+		for ( TransInList<CondAp>::Iter t = state->inList; t.lte(); t++ )
+			markIndex.touch( t->fromState );
+	}
+	if ( markIndex.numMoved > 0 ) {
+		for ( int e = 0; e < markIndex.numEofStates; e++ )
+			markIndex.touch( markIndex.eofStates[e] );
+	}
+	markIndex.numMoved = 0;
+
+	for ( int tc = 0; tc < markIndex.numTouchedClasses; tc++ ) {
+		int c = markIndex.touchedClasses[tc];
+		int numTouched = markIndex.numTouched[c];
+		markIndex.numTouched[c] = 0;
+
+		/* The touched states are at the front of the class. Untouched states
+		 * all still compare equal to each other, use one to stand in for
+		 * them. */
+		StateAp **touched = markIndex.members + markIndex.first[c];
+		StateAp *untouched = 0;
+		if ( markIndex.first[c] + numTouched < markIndex.past[c] )
+			untouched = touched[numTouched];
+
+		/* Sort the touched states using the mark compare. */
+		mergeSort.sort( touched, numTouched );
+
+		/* Find the run of states that stays in the class. This is the run
+		 * that compares equal to the untouched states, or the largest run if
+		 * every state was touched. Keeping the largest run in place means
+		 * the states moved out are never the bulk of the class, which would
+		 * touch it all over again on the next round. */
+		int stayFirst = -1, stayPast = -1;
+		for ( int s = 0; s < numTouched; ) {
+			int runPast = s + 1;
+			while ( runPast < numTouched && 
+					markCompare.compare( touched[s], touched[runPast] ) == 0 )
+				runPast += 1;
+
+			if ( untouched != 0 ? markCompare.compare( touched[s], untouched ) == 0 :
+					runPast - s > stayPast - stayFirst )
+			{
+				stayFirst = s;
+				stayPast = runPast;
+			}
+			s = runPast;
+		}
 
-	/* Walk all unordered pairs of (p, q) where p != q.
-	 * The second depth of the walk stops before reaching p. This
-	 * gives us all unordered pairs of states (p, q) where p != q. */
-	while ( p != 0 ) {
-		q = stateList.head;
-		while ( q != p ) {
-			/* Should we mark the pair? */
-			if ( !markIndex.isPairMarked( p->alg.stateNum, q->alg.stateNum ) ) {
-				if ( markCompare.shouldMark( markIndex, p, q ) ) {
-					markIndex.markPair( p->alg.stateNum, q->alg.stateNum );
-					pairWasMarked = true;
-				}
+		/* Nothing marked if all the states compare equal. */
+		if ( stayFirst == 0 && stayPast == numTouched )
+			continue;
+
+		/* Put the staying run at the end of the touched states, next to the
+		 * untouched states. */
+		int numScratch = 0;
+		for ( int s = 0; s < numTouched; s++ ) {
+			if ( s < stayFirst || s >= stayPast )
+				markIndex.scratch[numScratch++] = touched[s];
+		}
+		for ( int s = stayFirst; s < stayPast; s++ )
+			markIndex.scratch[numScratch++] = touched[s];
+		memcpy( touched, markIndex.scratch, sizeof(StateAp*) * numTouched );
+
+		/* Move the runs in front of the staying run into new classes. */
+		int numMoving = numTouched - ( stayPast - stayFirst );
+		for ( int s = 0; s < numMoving; s++ ) {
+			StateAp *state = touched[s];
+			if ( s == 0 || markCompare.compare( touched[s-1], state ) != 0 ) {
+				markIndex.first[markIndex.numClasses] = markIndex.first[c] + s;
+				markIndex.numClasses += 1;
 			}
-			q = q->next;
+
+			int nc = markIndex.numClasses - 1;
+			markIndex.past[nc] = markIndex.first[c] + s + 1;
+			markIndex.loc[state->alg.stateNum] = markIndex.first[c] + s;
+			markIndex.moved[markIndex.numMoved++] = state;
 		}
-		p = p->next;
+
+		/* Fix the locations of the staying run. */
+		for ( int s = numMoving; s < numTouched; s++ )
+			markIndex.loc[touched[s]->alg.stateNum] = markIndex.first[c] + s;
+		markIndex.first[c] += numMoving;
+
+		pairWasMarked = true;
+	}
+	markIndex.numTouchedClasses = 0;
+
+	/* Move the states into the new classes. */
+	for ( int nc = firstNewClass; nc < markIndex.numClasses; nc++ ) {
+		for ( int s = markIndex.first[nc]; s < markIndex.past[nc]; s++ )
+			markIndex.classOf[markIndex.members[s]->alg.stateNum] = nc;
 	}
 
 	return pairWasMarked;
@@ -427,9 +910,10 @@ bool FsmAp::markRound( MarkIndex &markIndex )
 /**
  * \brief Minimize by pair marking.
  *
- * Decides if each pair of states is distinct or not. Uses O(n^2) memory and
- * should only be used on small graphs. Produces the most minmimal FSM
- * possible.
+ * Decides if each pair of states is distinct or not. Marked pairs are kept
+ * as classes of states, using O(n) memory. Produces the most minmimal FSM
+ * possible. States are fused into the first equivalent state in the state
+ * list.
  */
 void FsmAp::minimizeStable()
 {
@@ -658,40 +1142,32 @@ void FsmAp::fuseEquivStates( StateAp *dest, StateAp *src )
 
 void FsmAp::fuseUnmarkedPairs( MarkIndex &markIndex )
 {
-	StateAp *p = stateList.head, *nextP, *q;
+	StateAp *p = stateList.head, *nextP;
 
 	/* Definition: The primary state of an equivalence class is the first state
 	 * encounterd that belongs to the equivalence class. All equivalence
 	 * classes have primary state including equivalence classes with one state
 	 * in it. */
+	StateAp **primary = new StateAp*[markIndex.numClasses];
+	memset( primary, 0, sizeof(StateAp*) * markIndex.numClasses );
 
-	/* For each unmarked pair merge p into q and delete p. q is always the
-	 * primary state of it's equivalence class. We wouldn't have landed on it
-	 * here if it were not, because it would have been deleted.
-	 *
-	 * Proof that q is the primaray state of it's equivalence class: Assume q
-	 * is not the primary state of it's equivalence class, then it would be
-	 * merged into some state that came before it and thus p would be
-	 * equivalent to that state. But q is the first state that p is equivalent
-	 * to so we have a contradiction. */
-
-	/* Walk all unordered pairs of (p, q) where p != q.
-	 * The second depth of the walk stops before reaching p. This
-	 * gives us all unordered pairs of states (p, q) where p != q. */
+	/* For each state p that has an unmarked pair with an earlier state, merge
+	 * p into the primary state of its class and delete p. The primary state
+	 * is the first state that p is equivalent to, and it is never deleted
+	 * because no state before it is equivalent to it. */
 	while ( p != 0 ) {
 		nextP = p->next;
 
-		q = stateList.head;
-		while ( q != p ) {
-			/* If one of p or q is a final state then mark. */
-			if ( ! markIndex.isPairMarked( p->alg.stateNum, q->alg.stateNum ) ) {
-				fuseEquivStates( q, p );
-				break;
-			}
-			q = q->next;
-		}
+		int c = markIndex.classOf[p->alg.stateNum];
+		if ( primary[c] == 0 )
+			primary[c] = p;
+		else
+			fuseEquivStates( primary[c], p );
+
 		p = nextP;
 	}
+
+	delete[] primary;
 }
 
 void FsmAp::fusePartitions( MinPartition *parts, int numParts )
@@ -25,46 +25,66 @@
 #include <assert.h>
 #include <iostream>
 
-/* Construct a mark index for a specified number of states. Must new up
- * an array that is states^2 in size. */
-MarkIndex::MarkIndex( int states ) : numStates(states)
+/* Construct a mark index for a specified number of states. All arrays are
+ * linear in the number of states. The classes are set up by the initial
+ * marking round. */
+MarkIndex::MarkIndex( int states )
+:
+	numStates(states),
+	numClasses(0),
+	members(new StateAp*[states]),
+	loc(new int[states]),
+	classOf(new int[states]),
+	first(new int[states]),
+	past(new int[states]),
+	numTouched(new int[states]),
+	touchedClasses(new int[states]),
+	numTouchedClasses(0),
+	moved(new StateAp*[states]),
+	numMoved(0),
+	eofStates(new StateAp*[states]),
+	numEofStates(0),
+	scratch(new StateAp*[states])
 {
-	/* Total pairs is states^2. Actually only use half of these, but we allocate
-	 * them all to make indexing into the array easier. */
-	int total = states * states;
-
-	/* New up chars so that individual DListEl constructors are
-	 * not called. Zero out the mem manually. */
-	array = new bool[total];
-	memset( array, 0, sizeof(bool) * total );
+	memset( numTouched, 0, sizeof(int) * states );
 }
 
-/* Free the array used to store state pairs. */
+/* Free the arrays used to store the classes. */
 MarkIndex::~MarkIndex()
 {
-	delete[] array;
-}
-
-/* Mark a pair of states. States are specified by their number. The
- * marked states are moved from the unmarked list to the marked list. */
-void MarkIndex::markPair(int state1, int state2)
-{
-	int pos = ( state1 >= state2 ) ?
-		( state1 * numStates ) + state2 :
-		( state2 * numStates ) + state1;
-
-	array[pos] = true;
+	delete[] members;
+	delete[] loc;
+	delete[] classOf;
+	delete[] first;
+	delete[] past;
+	delete[] numTouched;
+	delete[] touchedClasses;
+	delete[] moved;
+	delete[] eofStates;
+	delete[] scratch;
 }
 
-/* Returns true if the pair of states are marked. Returns false otherwise.
- * Ordering of states given does not matter. */
-bool MarkIndex::isPairMarked(int state1, int state2)
+/* Move a state into the touched front of its class. Touching a state twice
+ * has no effect. */
+void MarkIndex::touch( StateAp *state )
 {
-	int pos = ( state1 >= state2 ) ?
-		( state1 * numStates ) + state2 :
-		( state2 * numStates ) + state1;
-
-	return array[pos];
+	int s = state->alg.stateNum;
+	int c = classOf[s];
+	int i = loc[s];
+	int j = first[c] + numTouched[c];
+
+	/* Already touched. */
+	if ( i < j )
+		return;
+
+	StateAp *other = members[j];
+	members[i] = other;
+	loc[other->alg.stateNum] = i;
+	members[j] = state;
+	loc[s] = j;
+
+	if ( numTouched[c]++ == 0 )
+		touchedClasses[numTouchedClasses++] = c;
 }
 
 /* Create a new fsm state. State has not out transitions or in transitions, not
@@ -147,11 +167,12 @@ StateAp::StateAp(const StateAp &other)
 	/* Duplicate all the transitions. */
 	for ( TransList::Iter trans = other.outList; trans.lte(); trans++ ) {
 		/* Duplicate and store the orginal target in the transition. This will
-		 * be corrected once all the states have been created. */
-		TransAp *newTrans = new TransAp( *trans );
+		 * be corrected once all the states have been created. The copies come
+		 * from the pools of the originals. */
+		TransAp *newTrans = new( NodePool::poolOf( trans ) ) TransAp( *trans );
 
 		for ( CondList::Iter cti = trans->condList; cti.lte(); cti++ ) {
-			CondAp *newCondTrans = new CondAp( *cti, newTrans );
+			CondAp *newCondTrans = new( NodePool::poolOf( cti ) ) CondAp( *cti, newTrans );
 			newCondTrans->key = cti->key;
 
 			newTrans->condList.append( newCondTrans );
@@ -165,12 +186,10 @@ StateAp::StateAp(const StateAp &other)
 	}
 }
 
-/* If there is a state dict element, then delete it. Everything else is left
- * up to the FsmGraph destructor. */
+/* Everything is left up to the FsmGraph destructor. A state dict element
+ * belongs to the state dict. */
 StateAp::~StateAp()
 {
-	if ( stateDictEl != 0 )
-		delete stateDictEl;
 }
 
 /* Compare two states using pointers to the states. With the approximate
@@ -343,29 +362,33 @@ int PartitionCompare::compare( const StateAp *state1, const StateAp *state2 )
 	return 0;
 }
 
-/* Compare class for the sort that does the partitioning. */
-bool MarkCompare::shouldMark( MarkIndex &markIndex, const StateAp *state1, 
-			const StateAp *state2 )
+/* Compare class for the sort that does the marking. */
+int MarkCompare::compare( const StateAp *state1, const StateAp *state2 )
 {
+	int compareRes;
+
 	/* Use a pair iterator to get the transition pairs. */
 	RangePairIter<TransAp> outPair( ctx, state1->outList.head, state2->outList.head );
 	for ( ; !outPair.end(); outPair++ ) {
 		switch ( outPair.userState ) {
 
 		case RangePairIter<TransAp>::RangeInS1:
-			if ( FsmAp::shouldMarkPtr( markIndex, outPair.s1Tel.trans, 0 ) )
-				return true;
+			compareRes = FsmAp::compareTransMarkPtr( *markIndex, outPair.s1Tel.trans, 0 );
+			if ( compareRes != 0 )
+				return compareRes;
 			break;
 
 		case RangePairIter<TransAp>::RangeInS2:
-			if ( FsmAp::shouldMarkPtr( markIndex, 0, outPair.s2Tel.trans ) )
-				return true;
+			compareRes = FsmAp::compareTransMarkPtr( *markIndex, 0, outPair.s2Tel.trans );
+			if ( compareRes != 0 )
+				return compareRes;
 			break;
 
 		case RangePairIter<TransAp>::RangeOverlap:
-			if ( FsmAp::shouldMarkPtr( markIndex,
-					outPair.s1Tel.trans, outPair.s2Tel.trans ) )
-				return true;
+			compareRes = FsmAp::compareTransMarkPtr( *markIndex,
+					outPair.s1Tel.trans, outPair.s2Tel.trans );
+			if ( compareRes != 0 )
+				return compareRes;
 			break;
 
 		case RangePairIter<TransAp>::BreakS1:
@@ -374,7 +397,21 @@ bool MarkCompare::shouldMark( MarkIndex &markIndex, const StateAp *state1,
 		}
 	}
 
-	return false;
+	/* Test eof targets. */
+	if ( state1->eofTarget == 0 && state2->eofTarget != 0 )
+		return -1;
+	else if ( state1->eofTarget != 0 && state2->eofTarget == 0 )
+		return 1;
+	else if ( state1->eofTarget != 0 ) {
+		/* Both eof targets are set. */
+		compareRes = CmpOrd< int >::compare( 
+			markIndex->classOf[state1->eofTarget->alg.stateNum],
+			markIndex->classOf[state2->eofTarget->alg.stateNum] );
+		if ( compareRes != 0 )
+			return compareRes;
+	}
+
+	return 0;
 }
 
 /*
@@ -515,25 +552,69 @@ int FsmAp::compareFullPtr( TransAp *trans1, TransAp *trans2 )
 }
 
 
-bool FsmAp::shouldMarkPtr( MarkIndex &markIndex, TransAp *trans1, 
+/* Compare the marked classes of the targets of two transitions. The
+ * pointers may be null, but only together. */
+int FsmAp::compareTransMarkPtr( MarkIndex &markIndex, TransAp *trans1, 
 				TransAp *trans2 )
 {
-	std::cerr << "FIXME: " << __PRETTY_FUNCTION__ << std::endl;
+	/* The initial mark round guarantees that if one transition is unset then
+	 * so is the other. */
+	assert( (trans1 == 0) == (trans2 == 0) );
+	if ( trans1 == 0 )
+		return 0;
 
-	if ( (trans1 != 0) ^ (trans2 != 0) ) {
-		/* Exactly one of the transitions is set. The initial mark round
-		 * should rule out this case. */
-		assert( false );
-	}
-	else if ( trans1 != 0 ) {
-		/* Both of the transitions are set. If the target pair is marked, then
-		 * the pair we are considering gets marked. */
-		return markIndex.isPairMarked( trans1->condList.head->toState->alg.stateNum, 
-				trans2->condList.head->toState->alg.stateNum );
+	/* Use a pair iterator to get the condition pairs. */
+	ValPairIter<CondAp> outPair( trans1->condList.head, trans2->condList.head );
+	for ( ; !outPair.end(); outPair++ ) {
+		switch ( outPair.userState ) {
+
+		case ValPairIter<CondAp>::RangeInS1: {
+			int compareRes = compareCondMarkPtr( markIndex, outPair.s1Tel.trans, 0 );
+			if ( compareRes != 0 )
+				return compareRes;
+			break;
+		}
+
+		case ValPairIter<CondAp>::RangeInS2: {
+			int compareRes = compareCondMarkPtr( markIndex, 0, outPair.s2Tel.trans );
+			if ( compareRes != 0 )
+				return compareRes;
+			break;
+		}
+
+		case ValPairIter<CondAp>::RangeOverlap: {
+			int compareRes = compareCondMarkPtr( markIndex,
+					outPair.s1Tel.trans, outPair.s2Tel.trans );
+			if ( compareRes != 0 )
+				return compareRes;
+			break;
+		}
+
+		case ValPairIter<CondAp>::BreakS1:
+		case ValPairIter<CondAp>::BreakS2:
+			break;
+		}
 	}
 
-	/* Neither of the transitiosn are set. */
-	return false;
+	return 0;
 }
 
-
+int FsmAp::compareCondMarkPtr( MarkIndex &markIndex, CondAp *trans1, 
+				CondAp *trans2 )
+{
+	if ( trans1 != 0 ) {
+		/* If trans1 is set then so should trans2. The initial mark round
+		 * guarantees this for us. */
+		if ( trans1->toState == 0 && trans2->toState != 0 )
+			return -1;
+		else if ( trans1->toState != 0 && trans2->toState == 0 )
+			return 1;
+		else if ( trans1->toState != 0 ) {
+			/* Both of targets are set. */
+			return CmpOrd< int >::compare( 
+				markIndex.classOf[trans1->toState->alg.stateNum],
+				markIndex.classOf[trans2->toState->alg.stateNum] );
+		}
+	}
+	return 0;
+}
@@ -26,8 +26,10 @@
 #include "inputdata.h"
 #include "rlparse.h"
 #include "version.h"
+#include "profile.h"
 
 #include <string.h>
+#include <stdlib.h>
 #include <iostream>
 
 string itoa( int i )
@@ -133,6 +135,7 @@ CodeGenData::CodeGenData( const CodeGenArgs &args )
 :
 	GenBase(args.fsmName, args.pd, args.fsm),
 
+	inputData(args.inputData),
 	sourceFileName(args.sourceFileName),
 	fsmName(args.fsmName), 
 	out(args.out),
@@ -164,7 +167,8 @@ CodeGenData::CodeGenData( const CodeGenArgs &args )
 	noPrefix(false),
 	noFinal(false),
 	noError(false),
-	noCS(false)
+	noCS(false),
+	stubActions(false)
 {
 }
 
@@ -792,10 +796,53 @@ void CodeGenData::make()
 	/* Find the first final state (The final state with the lowest id). */
 	redFsm->findFirstFinState();
 
+	if ( gblProfile != 0 )
+		applyProfile();
+
+	/* The out ranges still cover the alphabet here. */
+	if ( simdSkip )
+		redFsm->findSkipStates();
+
+	/* Runs compare the input directly, so not with a getkey expression. */
+	if ( literalRuns && getKeyExpr == 0 )
+		redFsm->findLiteralRuns();
+
 	/* Code generation anlysis step. */
 	genAnalysis();
 }
 
+/* Attach the counts of this machine from --profile-use to the states. Counts
+ * for states the machine does not have are from an older version of it and
+ * are dropped. The state of a count is the id the instrumented code was
+ * generated with, which is the state's index in allStates as long as no
+ * style renumbers states (see RedFsmAp::profileOrdering). */
+void CodeGenData::applyProfile()
+{
+	ProfileMachine *machine = gblProfile->find( fsmName );
+	if ( machine == 0 )
+		return;
+
+	long numStates = redFsm->stateList.length();
+	bool byteKeys = keyOps->alphType->size == 1;
+	for ( int c = 0; c < machine->counts.length(); c++ ) {
+		ProfileCount &count = machine->counts[c];
+		if ( count.state < 0 || count.state >= numStates )
+			continue;
+
+		RedStateAp *state = allStates + count.state;
+		state->profCount += count.count;
+		if ( byteKeys && count.key >= 0 ) {
+			if ( state->profKeys == 0 ) {
+				state->profKeys = new unsigned long long[256];
+				memset( state->profKeys, 0, sizeof(unsigned long long) * 256 );
+			}
+			state->profKeys[count.key & 0xff] += count.count;
+		}
+	}
+
+	redFsm->profiled = true;
+}
+
 void CodeGenData::createMachine()
 {
 	redFsm = new RedFsmAp( pd->fsmCtx->keyOps );
@@ -1384,11 +1431,137 @@ void CodeGenData::analyzeMachine()
 	setValueLimits();
 }
 
+/* A chunk is run from every state before it is known where it starts, so the
+ * machine can't have effects on the way. EOF actions are not run. */
+bool CodeGenData::chunkable()
+{
+	if ( keyOps->alphType->size != 1 || getKeyExpr != 0 )
+		return false;
+
+	if ( redFsm->anyToStateActions() || redFsm->anyFromStateActions() )
+		return false;
+
+	for ( TransApSet::Iter trans = redFsm->transSet; trans.lte(); trans++ ) {
+		if ( trans->condSpace != 0 )
+			return false;
+		for ( RedCondList::Iter c = trans->outConds; c.lte(); c++ ) {
+			if ( c->value->action != 0 )
+				return false;
+		}
+	}
+	return true;
+}
+
+CodeGenData *makeCodeGen( const CodeGenArgs &args );
+
+/* Statements that move p or change the target state decide what is matched,
+ * so they can't be taken out along with the rest of the action. */
+static bool anyControlFlow( GenInlineList *inlineList )
+{
+	for ( GenInlineList::Iter item = *inlineList; item.lte(); item++ ) {
+		switch ( item->type ) {
+		case GenInlineItem::Hold: case GenInlineItem::Exec:
+		case GenInlineItem::Goto: case GenInlineItem::GotoExpr:
+		case GenInlineItem::Call: case GenInlineItem::CallExpr:
+		case GenInlineItem::Next: case GenInlineItem::NextExpr:
+		case GenInlineItem::Ret: case GenInlineItem::Break:
+			return true;
+		default:
+			break;
+		}
+
+		if ( item->children != 0 && anyControlFlow( item->children ) )
+			return true;
+	}
+	return false;
+}
+
+/* Without its actions the machine can only say whether the input matched.
+ * Conditions are tested by actions, and scanners and the variable overrides
+ * need the actions to make sense. */
+bool CodeGenData::matchable()
+{
+	if ( pd->getKeyExpr != 0 || pd->accessExpr != 0 )
+		return false;
+
+	if ( pd->pExpr != 0 || pd->peExpr != 0 || pd->eofExpr != 0 || pd->csExpr != 0 )
+		return false;
+
+	if ( pd->lmList.length() > 0 )
+		return false;
+
+	if ( pd->fsmCtx->condData->condSpaceMap.length() > 0 )
+		return false;
+
+	for ( GenActionList::Iter act = actionList; act.lte(); act++ ) {
+		if ( act->numRefs() > 0 && anyControlFlow( act->inlineList ) )
+			return false;
+	}
+
+	return true;
+}
+
+/* The machine with the actions taken out and minimized again, written by a
+ * second code generator under the name of the machine with _match added. It
+ * has tables of its own, usually much smaller. */
+void CodeGenData::writeMatch()
+{
+	FsmAp *graph = pd->makeMatchGraph();
+
+	string name = string(fsmName) + "_match";
+	char *matchName = strdup( name.c_str() );
+
+	CodeGenArgs args( inputData, sourceFileName, matchName, pd, graph, out );
+	CodeGenData *match = makeCodeGen( args );
+	match->make();
+
+	if ( printStatistics ) {
+		std::cerr << "match states: " << graph->stateList.length() << " of " <<
+				redFsm->stateList.length() << std::endl;
+	}
+
+	match->writeMatchExec();
+
+	delete match;
+	delete graph;
+	free( matchName );
+}
+
 void CodeGenData::write_option_error( InputLoc &loc, char *arg )
 {
 	source_warning(loc) << "unrecognized write option \"" << arg << "\"" << std::endl;
 }
 
+void CodeGenData::checkWriteStatement( InputLoc &loc, int nargs, char **args )
+{
+	if ( strcmp( args[0], "exec_chunked" ) == 0 ) {
+		if ( !chunkable() ) {
+			source_error(loc) << "write exec_chunked needs an alphabet type of "
+					"one byte, no getkey and no transition, to-state or from-state "
+					"actions or conditions" << std::endl;
+		}
+	}
+	else if ( strcmp( args[0], "exec_streams" ) == 0 ) {
+		if ( !chunkable() ) {
+			source_error(loc) << "write exec_streams needs an alphabet type of "
+					"one byte, no getkey and no transition, to-state or from-state "
+					"actions or conditions" << std::endl;
+		}
+		else if ( !streamable() ) {
+			source_error(loc) << "write exec_streams needs a table style "
+					"(-T0, -T1, -T2, -F0 or -F1)" << std::endl;
+		}
+	}
+	else if ( strcmp( args[0], "match" ) == 0 ) {
+		if ( !matchable() ) {
+			source_error(loc) << "write match needs a machine with no conditions, "
+					"scanners, getkey, access or variable statements, and no "
+					"actions that hold, exec, goto, call, next, ret or break" <<
+					std::endl;
+		}
+	}
+}
+
 void CodeGenData::writeStatement( InputLoc &loc, int nargs, char **args )
 {
 	/* FIXME: This should be moved to the virtual functions in the code
@@ -1429,6 +1602,21 @@ void CodeGenData::writeStatement( InputLoc &loc, int nargs, char **args )
 		}
 		writeExec();
 	}
+	else if ( strcmp( args[0], "exec_chunked" ) == 0 ) {
+		for ( int i = 1; i < nargs; i++ )
+			write_option_error( loc, args[i] );
+		writeExecChunked();
+	}
+	else if ( strcmp( args[0], "exec_streams" ) == 0 ) {
+		for ( int i = 1; i < nargs; i++ )
+			write_option_error( loc, args[i] );
+		writeExecStreams();
+	}
+	else if ( strcmp( args[0], "match" ) == 0 ) {
+		for ( int i = 1; i < nargs; i++ )
+			write_option_error( loc, args[i] );
+		writeMatch();
+	}
 	else if ( strcmp( args[0], "exports" ) == 0 ) {
 		for ( int i = 1; i < nargs; i++ )
 			write_option_error( loc, args[i] );
@@ -182,6 +182,7 @@ private:
 	void makeActionTableList();
 	void makeConditions();
 	void makeEntryPoints();
+	void applyProfile();
 	bool makeNameInst( std::string &out, NameInst *nameInst );
 	void makeStateList();
 
@@ -209,6 +210,23 @@ public:
 	virtual void writeInit() {};
 	virtual void writeExec() {};
 	virtual void writeExports() {};
+
+	/* A function running the machine over a buffer for the benchmark
+	 * driver. Appends the entry of the machine to the driver's table. */
+	virtual void writeBench( std::ostream &entries ) {};
+
+	/* Functions mapping each state to the state reached over a chunk of the
+	 * input, for running chunks of a large input in parallel. */
+	virtual void writeExecChunked() {};
+
+	/* A function running many records through the machine, a few streams
+	 * at a time in lockstep. Only the table styles can, see streamable. */
+	virtual void writeExecStreams() {};
+	virtual bool streamable() { return false; }
+
+	/* The data and exec function of the action-stripped machine, generated
+	 * by a second code generator. See writeMatch. */
+	virtual void writeMatchExec() {};
 	virtual void writeStart() {};
 	virtual void writeFirstFinal() {};
 	virtual void writeError() {};
@@ -217,6 +235,10 @@ public:
 	 * statements. */
 	virtual void writeStatement( InputLoc &loc, int nargs, char **args );
 
+	/* Reports write statements this machine can't take, before any output
+	 * is written. */
+	void checkWriteStatement( InputLoc &loc, int nargs, char **args );
+
 	/********************/
 
 	virtual ~CodeGenData() {}
@@ -225,6 +247,7 @@ public:
 	 * Collecting the machine.
 	 */
 
+	InputData &inputData;
 	const char *sourceFileName;
 	const char *fsmName;
 	ostream &out;
@@ -270,6 +293,16 @@ public:
 	bool noError;
 	bool noCS;
 
+	/* Leave the host code out of actions and conditions (--bench). */
+	bool stubActions;
+
+	/* The machine can be run by write exec_chunked. */
+	bool chunkable();
+
+	/* The machine can be written without its actions by write match. */
+	bool matchable();
+	void writeMatch();
+
 	void createMachine();
 	void initActionList( unsigned long length );
 	void newAction( int anum, const char *name, const InputLoc &loc, GenInlineList *inlineList );
@@ -25,10 +25,18 @@
 #include "parsedata.h"
 #include "rlparse.h"
 #include "rlscan.h"
+#include "profile.h"
 #include <iostream>
+#include <fstream>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 using std::istream;
 using std::ifstream;
+using std::ofstream;
 using std::ostream;
 using std::cout;
 using std::cerr;
@@ -215,13 +223,95 @@ void InputData::prepareSingleMachine()
 	dotGenParser->pd->prepareMachineGen( gdEl );
 }
 
+/* The section graph of one specification, built on a worker thread. */
+struct MachineJob
+{
+	ParseData *pd;
+	ErrorBuffer errorBuffer;
+};
+
+/* Jobs are handed out to the worker threads in order. */
+struct MachineJobList
+{
+	MachineJob *jobs;
+	int numJobs;
+	int nextJob;
+	pthread_mutex_t mutex;
+};
+
+static void *buildMachines( void *arg )
+{
+	MachineJobList *jobList = (MachineJobList*)arg;
+	ErrorBuffer *prevBuffer = getErrorBuffer();
+	while ( true ) {
+		pthread_mutex_lock( &jobList->mutex );
+		int j = jobList->nextJob++;
+		pthread_mutex_unlock( &jobList->mutex );
+
+		if ( j >= jobList->numJobs )
+			break;
+
+		MachineJob *job = jobList->jobs + j;
+		setErrorBuffer( &job->errorBuffer );
+		job->pd->makeSectionGraph( 0 );
+		setErrorBuffer( prevBuffer );
+	}
+	return 0;
+}
+
 void InputData::prepareAllMachines()
 {
 	/* No machine spec or machine name given. Generate everything. */
+	Vector<ParseData*> pds;
 	for ( ParserDict::Iter parser = parserDict; parser.lte(); parser++ ) {
 		ParseData *pd = parser->value->pd;
 		if ( pd->instanceList.length() > 0 )
-			pd->prepareMachineGen( 0 );
+			pds.append( pd );
+	}
+
+	if ( numJobs > 1 && pds.length() > 1 ) {
+		/* Each specification has its own names, actions, ordering counters
+		 * and fsm context. Build the section graphs on a pool of threads. */
+		MachineJobList jobList;
+		jobList.jobs = new MachineJob[pds.length()];
+		jobList.numJobs = pds.length();
+		jobList.nextJob = 0;
+		pthread_mutex_init( &jobList.mutex, 0 );
+
+		for ( int j = 0; j < pds.length(); j++ )
+			jobList.jobs[j].pd = pds[j];
+
+		int numThreads = numJobs < pds.length() ? numJobs : pds.length();
+		pthread_t *threads = new pthread_t[numThreads];
+		int started = 0;
+		for ( int t = 0; t < numThreads; t++ ) {
+			if ( pthread_create( &threads[started], 0, buildMachines, &jobList ) == 0 )
+				started += 1;
+		}
+
+		/* The threads take jobs until there are none left, so the ones that
+		 * started do all of them. If none could be started, build here. */
+		if ( started == 0 )
+			buildMachines( &jobList );
+		for ( int t = 0; t < started; t++ )
+			pthread_join( threads[t], 0 );
+
+		/* The rest goes in order, after the diagnostics of the graph build,
+		 * so the result is the same as the serial build. */
+		for ( int j = 0; j < pds.length(); j++ ) {
+			MachineJob *job = jobList.jobs + j;
+			cerr << job->errorBuffer.out.str();
+			gblErrorCount += job->errorBuffer.errorCount;
+			job->pd->analyzeSectionGraph();
+		}
+
+		pthread_mutex_destroy( &jobList.mutex );
+		delete[] threads;
+		delete[] jobList.jobs;
+	}
+	else {
+		for ( int j = 0; j < pds.length(); j++ )
+			pds[j]->prepareMachineGen( 0 );
 	}
 }
 
@@ -254,6 +344,10 @@ void InputData::verifyWritesHaveData()
 		if ( ii->type == InputItem::Write ) {
 			if ( ii->pd->cgd == 0 )
 				error( ii->loc ) << "no machine instantiations to write" << endl;
+			else {
+				ii->pd->cgd->checkWriteStatement( ii->loc,
+						ii->writeArgs.length()-1, ii->writeArgs.data );
+			}
 		}
 	}
 }
@@ -273,6 +367,73 @@ void InputData::writeOutput()
 	}
 }
 
+CodeGenData *makeCodeGen( const CodeGenArgs &args );
+void writeBenchHeader( std::ostream &out );
+void writeBenchDriver( std::ostream &out, const std::string &entries );
+
+/* The machines that use only the default variables can be run on their
+ * own by the benchmark driver, which hands them the corpus as bytes. */
+static bool benchable( ParseData *pd )
+{
+	return pd->fsmCtx->keyOps->alphType->size == 1 &&
+			pd->getKeyExpr == 0 && pd->accessExpr == 0 &&
+			pd->prePushExpr == 0 && pd->postPopExpr == 0 &&
+			pd->pExpr == 0 && pd->peExpr == 0 && pd->eofExpr == 0 &&
+			pd->csExpr == 0 && pd->topExpr == 0 && pd->stackExpr == 0 &&
+			pd->actExpr == 0 && pd->tokstartExpr == 0 && pd->tokendExpr == 0 &&
+			pd->dataExpr == 0;
+}
+
+/* Write a standalone program that times each machine of the input over a
+ * corpus. The machines are built again with the host code left out of the
+ * actions, unless --bench-actions is given. */
+void InputData::writeBench()
+{
+	std::string fileName;
+	if ( benchFileName != 0 )
+		fileName = benchFileName;
+	else if ( outputFileName != 0 )
+		fileName = std::string( outputFileName ) + ".bench.c";
+	else {
+		error() << "--bench needs an output file or '=file'" << endl;
+		exit(1);
+	}
+
+	output_filter benchFilter( fileName.c_str() );
+	benchFilter.open( fileName.c_str(), ios::out|ios::trunc );
+	if ( !benchFilter.is_open() ) {
+		error() << "error opening " << fileName << " for writing" << endl;
+		exit(1);
+	}
+
+	ostream out( &benchFilter );
+	writeBenchHeader( out );
+
+	std::ostringstream entries;
+	for ( ParserDict::Iter parser = parserDict; parser.lte(); parser++ ) {
+		ParseData *pd = parser->value->pd;
+		if ( pd->cgd == 0 )
+			continue;
+
+		if ( !benchable( pd ) ) {
+			warning( pd->sectionLoc ) << "machine " << pd->sectionName << 
+					" uses variable, access or getkey statements or a"
+					" multi-byte alphtype and is left out of the benchmark" << endl;
+			continue;
+		}
+
+		CodeGenArgs args( *this, inputFileName, pd->sectionName,
+				pd, pd->sectionGraph, out );
+		CodeGenData *cgd = makeCodeGen( args );
+		cgd->stubActions = !benchActions;
+		cgd->make();
+		cgd->writeBench( entries );
+		delete cgd;
+	}
+
+	writeBenchDriver( out, entries.str() );
+}
+
 void InputData::processXML()
 {
 	/* Compiles machines. */
@@ -290,8 +451,15 @@ void InputData::processXML()
 	 * From this point on we should not be reporting any errors.
 	 */
 
+	TimeStamp start;
+	if ( printTimings )
+		start = TimeStamp::now();
+
 	openOutput();
 	writeXML( *outStream );
+
+	if ( printTimings )
+		timings.addPhase( "emit", 0, start );
 }
 
 void InputData::processDot()
@@ -311,12 +479,148 @@ void InputData::processDot()
 	 * From this point on we should not be reporting any errors.
 	 */
 
+	TimeStamp start;
+	if ( printTimings )
+		start = TimeStamp::now();
+
 	openOutput();
 	writeDot( *outStream );
+
+	if ( printTimings )
+		timings.addPhase( "emit", 0, start );
+}
+
+int TeeBuf::overflow( int c )
+{
+	if ( c != EOF )
+		copy += (char)c;
+	return dest->sputc( c );
+}
+
+std::streamsize TeeBuf::xsputn( const char *s, std::streamsize n )
+{
+	copy.append( s, n );
+	return dest->sputn( s, n );
+}
+
+int TeeBuf::sync()
+{
+	return dest->pubsync();
+}
+
+/* Fold data into the cache key. */
+void InputData::hashCacheInput( const char *data, long len )
+{
+	cacheHash.update( data, len );
+}
+
+/* A rebuilt ragel can write different output for the same input and
+ * options. The size and modification time of the executable stand in for a
+ * build id. Returns false if the executable can't be found. */
+bool InputData::hashCacheBuild( const char *argv0 )
+{
+	struct stat st;
+	if ( stat( "/proc/self/exe", &st ) != 0 && stat( argv0, &st ) != 0 )
+		return false;
+
+	std::ostringstream build;
+	build << "build " << (long long)st.st_size << " " << (long long)st.st_mtime;
+	hashCacheInput( build.str().c_str(), build.str().size() + 1 );
+	return true;
+}
+
+std::string InputData::cacheFileName()
+{
+	std::string fileName = cacheDir;
+	fileName += "/";
+	fileName += cacheHash.hexDigest();
+	return fileName;
+}
+
+/* Copy the output stored by an earlier run to the output file and write out
+ * the diagnostics that run gave. An entry starts with the length of the
+ * diagnostics, on a line of its own, followed by the diagnostics and the
+ * output. */
+bool InputData::readCache()
+{
+	ifstream cached( cacheFileName().c_str(), ios::in|ios::binary );
+	if ( !cached.is_open() )
+		return false;
+
+	long diagLen;
+	std::string header;
+	if ( !getline( cached, header ) || sscanf( header.c_str(), "%ld", &diagLen ) != 1 )
+		return false;
+
+	/* A truncated or corrupt entry is a miss. */
+	std::streampos start = cached.tellg();
+	cached.seekg( 0, ios::end );
+	std::streamoff left = cached.tellg() - start;
+	cached.seekg( start );
+	if ( !cached || diagLen < 0 || diagLen > left )
+		return false;
+
+	std::string diag( diagLen, 0 );
+	if ( diagLen > 0 && !cached.read( &diag[0], diagLen ) )
+		return false;
+
+	ofstream out( outputFileName, ios::out|ios::trunc|ios::binary );
+	if ( !out.is_open() ) {
+		error() << "error opening " << outputFileName << " for writing" << endl;
+		exit(1);
+	}
+
+	if ( cached.peek() != EOF )
+		out << cached.rdbuf();
+	cerr << diag;
+	return true;
+}
+
+/* Store the output file and the diagnostics in the cache. It is written under
+ * a temporary name and renamed so concurrent runs never see a partial entry.
+ * Failures leave the cache without the entry. */
+void InputData::writeCache()
+{
+	ifstream output( outputFileName, ios::in|ios::binary );
+	if ( !output.is_open() )
+		return;
+
+	std::string fileName = cacheFileName();
+	std::ostringstream tmpName;
+	tmpName << fileName << ".tmp" << getpid();
+
+	ofstream cached( tmpName.str().c_str(), ios::out|ios::trunc|ios::binary );
+	if ( !cached.is_open() )
+		return;
+
+	const std::string &diag = diagTee->copy;
+	cached << diag.size() << '\n' << diag;
+	if ( output.peek() != EOF )
+		cached << output.rdbuf();
+	cached.close();
+
+	if ( cached.fail() || rename( tmpName.str().c_str(), fileName.c_str() ) != 0 )
+		remove( tmpName.str().c_str() );
 }
 
 void InputData::processCode()
 {
+	/* An earlier run with the same input files and options stored the
+	 * output. Machine construction and code generation can be skipped. */
+	if ( cacheDir != 0 && !bench ) {
+		makeDefaultFileName();
+		if ( outputFileName != 0 && readCache() ) {
+			cacheHit = true;
+			return;
+		}
+
+		/* Keep the diagnostics from here on, to store with the output. */
+		if ( outputFileName != 0 ) {
+			diagTee = new TeeBuf( cerr.rdbuf() );
+			cerr.rdbuf( diagTee );
+		}
+	}
+
 	/* Compiles machines. */
 	prepareAllMachines();
 
@@ -341,8 +645,18 @@ void InputData::processCode()
 	 * From this point on we should not be reporting any errors.
 	 */
 
+	TimeStamp start;
+	if ( printTimings )
+		start = TimeStamp::now();
+
 	openOutput();
 	writeOutput();
+
+	if ( bench )
+		writeBench();
+
+	if ( printTimings )
+		timings.addPhase( "emit", 0, start );
 }
 
 void InputData::process()
@@ -353,6 +667,9 @@ void InputData::process()
 	if ( ! inFile->is_open() )
 		error() << "could not open " << inputFileName << " for reading" << endp;
 
+	if ( profileFileName != 0 )
+		loadProfile();
+
 	/* Used for just a few things. */
 	std::ostringstream hostData;
 
@@ -364,6 +681,9 @@ void InputData::process()
 	firstInputItem->loc.col = 1;
 	inputItems.append( firstInputItem );
 
+	if ( printTimings )
+		startTime = TimeStamp::now();
+
 	Scanner scanner( *this, inputFileName, *inFile, 0, 0, 0, false );
 	scanner.do_scan();
 
@@ -372,8 +692,23 @@ void InputData::process()
 		exit(1);
 
 	/* Now send EOF to all parsers. */
+	TimeStamp start;
+	if ( printTimings )
+		start = TimeStamp::now();
+
 	terminateAllParsers();
 
+	if ( printTimings ) {
+		/* Scanning is what is left of the time after parsing. */
+		TimeStamp scanTime;
+		scanTime.wall = start.wall - startTime.wall - parseTime.wall;
+		scanTime.cpu = start.cpu - startTime.cpu - parseTime.cpu;
+		timings.addPhaseTime( "scan", 0, scanTime );
+
+		parseTime.addSince( start );
+		timings.addPhaseTime( "parse", 0, parseTime );
+	}
+
 	/* Bail on above error. */
 	if ( gblErrorCount > 0 )
 		exit(1);
@@ -393,8 +728,91 @@ void InputData::process()
 	if ( outputFileName != 0 ) {
 		delete outStream;
 		delete outFilter;
+
+		if ( diagTee != 0 )
+			writeCache();
+	}
+
+	if ( diagTee != 0 ) {
+		cerr.rdbuf( diagTee->dest );
+		delete diagTee;
+		diagTee = 0;
 	}
 
 	assert( gblErrorCount == 0 );
+
+	if ( printTimings )
+		writeTimings();
+
+	/* Free the specifications, along with the graph nodes of their machines. */
+	parserList.empty();
+}
+
+/* Read the counts written by code generated with --instrument. Each machine
+ * starts with a "machine <name>" line, followed by "<state> <key> <count>"
+ * lines, where the key is a byte or '*' for a count of the state only. The
+ * counts change the output, so the file goes into the cache key. */
+void InputData::loadProfile()
+{
+	ifstream in( profileFileName );
+	if ( !in.is_open() )
+		error() << "could not open " << profileFileName << " for reading" << endp;
+
+	gblProfile = new Profile;
+	ProfileMachine *machine = 0;
+
+	std::string line;
+	for ( int lineNum = 1; getline( in, line ); lineNum++ ) {
+		hashCacheInput( line.c_str(), line.size() + 1 );
+
+		char name[256], key[32];
+		ProfileCount count;
+		if ( line.size() == 0 )
+			continue;
+		else if ( sscanf( line.c_str(), "machine %255s", name ) == 1 ) {
+			machine = gblProfile->find( name );
+			if ( machine == 0 ) {
+				machine = new ProfileMachine;
+				machine->name = strdup( name );
+				gblProfile->machines.append( machine );
+			}
+		}
+		else if ( machine != 0 && sscanf( line.c_str(), "%ld %31s %llu",
+				&count.state, key, &count.count ) == 3 && count.state >= 0 )
+		{
+			count.key = strcmp( key, "*" ) == 0 ? -1 : atol( key );
+			machine->counts.append( count );
+		}
+		else {
+			error() << profileFileName << ":" << lineNum <<
+					": invalid profile line" << endp;
+		}
+	}
+}
+
+/* Write the timings of this input file, followed by those of each
+ * specification, in the order of the specification names. */
+void InputData::writeTimings()
+{
+	/* The machines may have been built on other threads. */
+	TimeStamp total;
+	total.wall = TimeStamp::now().wall - startTime.wall;
+	total.cpu = processCpu();
+
+	Vector<Timings*> timingsList;
+	timingsList.append( &timings );
+	for ( ParserDict::Iter parser = parserDict; parser.lte(); parser++ )
+		timingsList.append( &parser->value->pd->timings );
+
+	if ( timingsFileName == 0 ) {
+		writeTimingsJSON( cerr, inputFileName, cacheHit, total, timingsList );
+	}
+	else {
+		ofstream out( timingsFileName );
+		if ( !out.is_open() ) {
+			error() << "error opening " << timingsFileName << " for writing" << endp;
+		}
+		writeTimingsJSON( out, inputFileName, cacheHit, total, timingsList );
+	}
 }
 
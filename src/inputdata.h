@@ -23,6 +23,8 @@
 #define _INPUT_DATA
 
 #include "gendata.h"
+#include "timings.h"
+#include "sha256.h"
 #include <iostream>
 #include <sstream>
 
@@ -58,6 +60,21 @@ typedef DList<Parser> ParserList;
 typedef DList<InputItem> InputItemList;
 typedef Vector<const char *> ArgsVector;
 
+/* Passes output through to another stream buffer and keeps a copy. Used to
+ * store the diagnostics of a run with the cached output. */
+struct TeeBuf : public std::streambuf
+{
+	TeeBuf( std::streambuf *dest ) : dest(dest) {}
+
+	std::streambuf *dest;
+	std::string copy;
+
+protected:
+	virtual int overflow( int c );
+	virtual std::streamsize xsputn( const char *s, std::streamsize n );
+	virtual int sync();
+};
+
 struct InputData
 {
 	InputData() : 
@@ -66,7 +83,9 @@ struct InputData
 		inStream(0),
 		outStream(0),
 		outFilter(0),
-		dotGenParser(0)
+		dotGenParser(0),
+		cacheHit(false),
+		diagTee(0)
 	{}
 
 	/* The name of the root section, this does not change during an include. */
@@ -86,9 +105,35 @@ struct InputData
 
 	ArgsVector includePaths;
 
+	/* Hash of everything the output depends on: the version and build of
+	 * ragel, the options and the contents of every file scanned. Names the
+	 * entry in cacheDir. */
+	Sha256 cacheHash;
+	bool cacheHit;
+
+	/* Copies the diagnostics of a run that will store its output in the
+	 * cache. A hit writes them out again. */
+	TeeBuf *diagTee;
+
+	/* Timings of the phases that are not specific to one specification. The
+	 * parse time is collected token by token while scanning. */
+	Timings timings;
+	TimeStamp startTime;
+	TimeStamp parseTime;
+	void writeTimings();
+
+	void loadProfile();
+
+	void hashCacheInput( const char *data, long len );
+	bool hashCacheBuild( const char *argv0 );
+	std::string cacheFileName();
+	bool readCache();
+	void writeCache();
+
 	void verifyWritesHaveData();
 
 	void writeOutput();
+	void writeBench();
 	void makeDefaultFileName();
 	void makeOutputStream();
 	void openOutput();
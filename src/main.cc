@@ -31,6 +31,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <pthread.h>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -55,6 +56,7 @@
 #include "version.h"
 #include "common.h"
 #include "inputdata.h"
+#include "profile.h"
 
 using std::istream;
 using std::ostream;
@@ -79,6 +81,13 @@ bool wantDupsRemoved = true;
 bool generateXML = false;
 bool generateDot = false;
 bool printStatistics = false;
+int numJobs = 1;
+const char *cacheDir = 0;
+long maxStates = 0;
+long maxMemory = 0;
+bool printTimings = false;
+const char *timingsFileName = 0;
+double opTimingThreshold = 0.01;
 
 /* Target language and output style. */
 CodeStyle codeStyle = GenTables;
@@ -87,6 +96,22 @@ long maxTransitions = LONG_MAX;
 
 int numSplitPartitions = 0;
 bool noLineDirectives = false;
+bool simdSkip = false;
+bool byteClasses = false;
+bool combTables = false;
+bool pagedTables = false;
+long denseBudget = 65536;
+long styleBudget = 0;
+int numStreams = 4;
+bool instrument = false;
+bool splitCold = false;
+bool literalRuns = false;
+bool computedGoto = false;
+const char *profileFileName = 0;
+bool bench = false;
+const char *benchFileName = 0;
+bool benchActions = false;
+Profile *gblProfile = 0;
 
 bool displayPrintables = false;
 
@@ -106,6 +131,20 @@ void usage()
 "   -d                   Do not remove duplicates from action lists\n"
 "   -I <dir>             Add <dir> to the list of directories to search\n"
 "                        for included an imported files\n"
+"   --jobs=<N>           Build the machines of up to <N> specifications at once\n"
+"   --cache-dir=<dir>    Reuse output stored in <dir> by an earlier run with\n"
+"                        the same input files and options\n"
+"   --max-states=<N>     Fail when an operation makes a machine of more than\n"
+"                        <N> states\n"
+"   --max-memory=<N>     Fail when the states and transitions of a\n"
+"                        specification take more than <N> bytes, N may end\n"
+"                        in k, m or g\n"
+"   --timings=json[:<file>]\n"
+"                        Write the time, memory and machine sizes of each\n"
+"                        phase as JSON to stderr or <file>\n"
+"   --timings-threshold=<ms>\n"
+"                        Report fsm operations that take at least <ms>\n"
+"                        milliseconds in the timings (default 10)\n"
 "error reporting format:\n"
 "   --error-format=gnu   file:line:column: message (default)\n"
 "   --error-format=msvc  file(line,column): message\n"
@@ -143,6 +182,35 @@ void usage()
 "code style: (C/D)\n"
 "   -G2                  Really fast goto-driven FSM\n"
 "   -P<N>                N-Way Split really fast goto-driven FSM\n"
+"code style: (C)\n"
+"   -T2                  Dense table driven FSM indexed by state and byte class\n"
+"   --style=auto         Use the fastest of -T0 -T1 -F0 -F1 -T2 -G0 -G1 -G2\n"
+"                        whose tables and code fit in the --style-budget\n"
+"   --style-budget=<N>   Byte budget for --style=auto, N may end in k or m\n"
+"   --dense-budget=<N>   Use -F0 tables when the -T2 tables would take more\n"
+"                        than <N> bytes, N may end in k or m (default 64k)\n"
+"   --simd               Scan over input in states that loop on themselves on\n"
+"                        most bytes, using SSE2 or AVX2 when available\n"
+"   --byte-classes       Build flat tables (-F0, -F1) over classes of bytes that\n"
+"                        no state tells apart\n"
+"   --comb               Overlay the rows of flat tables (-F0, -F1) in one\n"
+"                        array, found by offset and checked by owner\n"
+"   --paged              Build flat tables (-F0, -F1, -T2) of alphabets wider\n"
+"                        than a byte from pages shared among states\n"
+"   --instrument         Count the transitions taken in each state; the\n"
+"                        counts are written by <name>_write_profile(file)\n"
+"   --profile-use=<file> Order states and searches by the counts in <file>\n"
+"   --split-cold         Move the rarely entered states of -G2 machines out of\n"
+"                        the way of the hot code\n"
+"   --literal-runs       Compare chains of states that match a literal string\n"
+"                        in one test\n"
+"   --computed-goto      Dispatch the transition actions of -T0, -T2 and -F0\n"
+"                        through a table of label addresses with GCC\n"
+"   --bench[=<file>]     Also write a program timing the machines over a\n"
+"                        corpus, to <file> or <output>.bench.c\n"
+"   --bench-actions      Keep the host code of actions in the --bench program\n"
+"   --streams=<N>        Records run in lockstep by write exec_streams, N from\n"
+"                        2 to 8 (default 4)\n"
 	;	
 
 	exit(0);
@@ -188,26 +256,64 @@ ostream &operator<<( ostream &out, const InputLoc &loc )
 /* Total error count. */
 int gblErrorCount = 0;
 
+/* Threads that build machines send their diagnostics to a buffer. */
+static pthread_key_t errorBufferKey;
+static pthread_once_t errorBufferOnce = PTHREAD_ONCE_INIT;
+
+static void makeErrorBufferKey()
+{
+	pthread_key_create( &errorBufferKey, 0 );
+}
+
+void setErrorBuffer( ErrorBuffer *errorBuffer )
+{
+	pthread_once( &errorBufferOnce, makeErrorBufferKey );
+	pthread_setspecific( errorBufferKey, errorBuffer );
+}
+
+ErrorBuffer *getErrorBuffer()
+{
+	pthread_once( &errorBufferOnce, makeErrorBufferKey );
+	return (ErrorBuffer*)pthread_getspecific( errorBufferKey );
+}
+
+/* Get the stream for a diagnostic, counting it if it is an error. */
+static ostream &diagStream( bool isError )
+{
+	pthread_once( &errorBufferOnce, makeErrorBufferKey );
+	ErrorBuffer *errorBuffer = (ErrorBuffer*)pthread_getspecific( errorBufferKey );
+	if ( errorBuffer != 0 ) {
+		if ( isError )
+			errorBuffer->errorCount += 1;
+		return errorBuffer->out;
+	}
+
+	if ( isError )
+		gblErrorCount += 1;
+	return cerr;
+}
+
 /* Print the opening to a warning in the input, then return the error ostream. */
 ostream &warning( const InputLoc &loc )
 {
-	cerr << loc << ": warning: ";
-	return cerr;
+	ostream &out = diagStream( false );
+	out << loc << ": warning: ";
+	return out;
 }
 
 /* Print the opening to a program error, then return the error stream. */
 ostream &error()
 {
-	gblErrorCount += 1;
-	cerr << PROGNAME ": ";
-	return cerr;
+	ostream &out = diagStream( true );
+	out << PROGNAME ": ";
+	return out;
 }
 
 ostream &error( const InputLoc &loc )
 {
-	gblErrorCount += 1;
-	cerr << loc << ": ";
-	return cerr;
+	ostream &out = diagStream( true );
+	out << loc << ": ";
+	return out;
 }
 
 void escapeLineDirectivePath( std::ostream &out, char *path )
@@ -220,9 +326,39 @@ void escapeLineDirectivePath( std::ostream &out, char *path )
 	}
 }
 
+/* Parse a positive count with an optional k, m or g suffix. Returns zero if
+ * the value is not valid. */
+static long parseSize( const char *str )
+{
+	char *end;
+	long value = strtol( str, &end, 10 );
+	switch ( *end ) {
+		case 'k': case 'K':
+			value *= 1024L; end++;
+			break;
+		case 'm': case 'M':
+			value *= 1024L * 1024L; end++;
+			break;
+		case 'g': case 'G':
+			value *= 1024L * 1024L * 1024L; end++;
+			break;
+	}
+	return end == str || *end != 0 || value <= 0 ? 0 : value;
+}
+
 void InputData::parseArgs( int argc, const char **argv )
 {
-	ParamCheck pc("xo:dnmleabjkS:M:I:CDEJZRAOKvHh?-:sT:F:G:P:LpV", argc, argv);
+	ParamCheck pc("xo:dnmleabjkcS:M:I:CDEJZRAOKvHh?-:sT:F:G:P:LpV", argc, argv);
+
+	/* The output depends on the version, the build and the options. The
+	 * cache directory, the number of jobs and the timings do not change it. */
+	hashCacheInput( VERSION, strlen(VERSION) + 1 );
+	for ( int a = 1; a < argc; a++ ) {
+		if ( strncmp( argv[a], "--cache-dir", 11 ) != 0 &&
+				strncmp( argv[a], "--jobs", 6 ) != 0 &&
+				strncmp( argv[a], "--timings", 9 ) != 0 )
+			hashCacheInput( argv[a], strlen(argv[a]) + 1 );
+	}
 
 	/* FIXME: Need to check code styles VS langauge. */
 
@@ -280,6 +416,9 @@ void InputData::parseArgs( int argc, const char **argv )
 			case 'k':
 				minimizeLevel = MinimizePartition2;
 				break;
+			case 'c':
+				minimizeLevel = MinimizeHopcroft;
+				break;
 
 			/* Machine spec. */
 			case 'S':
@@ -373,6 +512,99 @@ void InputData::parseArgs( int argc, const char **argv )
 					else
 						error() << "invalid value for error-format" << endl;
 				}
+				else if ( strcmp( arg, "jobs" ) == 0 ) {
+					if ( eq == 0 || atoi( eq ) <= 0 )
+						error() << "expecting '=N' with N > 0 for jobs" << endl;
+					else
+						numJobs = atoi( eq );
+				}
+				else if ( strcmp( arg, "cache-dir" ) == 0 ) {
+					if ( eq == 0 || *eq == 0 )
+						error() << "expecting '=dir' for cache-dir" << endl;
+					else
+						cacheDir = strdup( eq );
+				}
+				else if ( strcmp( arg, "max-states" ) == 0 ) {
+					if ( eq == 0 || parseSize( eq ) == 0 )
+						error() << "expecting '=N' with N > 0 for max-states" << endl;
+					else
+						maxStates = parseSize( eq );
+				}
+				else if ( strcmp( arg, "max-memory" ) == 0 ) {
+					if ( eq == 0 || parseSize( eq ) == 0 )
+						error() << "expecting '=N' with N > 0 for max-memory" << endl;
+					else
+						maxMemory = parseSize( eq );
+				}
+				else if ( strcmp( arg, "timings" ) == 0 ) {
+					if ( eq != 0 && strcmp( eq, "json" ) == 0 )
+						printTimings = true;
+					else if ( eq != 0 && strncmp( eq, "json:", 5 ) == 0 && eq[5] != 0 ) {
+						printTimings = true;
+						timingsFileName = strdup( eq + 5 );
+					}
+					else
+						error() << "expecting '=json' or '=json:file' for timings" << endl;
+				}
+				else if ( strcmp( arg, "timings-threshold" ) == 0 ) {
+					if ( eq == 0 || atof( eq ) < 0 )
+						error() << "expecting '=ms' for timings-threshold" << endl;
+					else
+						opTimingThreshold = atof( eq ) / 1000.0;
+				}
+				else if ( strcmp( arg, "simd" ) == 0 )
+					simdSkip = true;
+				else if ( strcmp( arg, "byte-classes" ) == 0 )
+					byteClasses = true;
+				else if ( strcmp( arg, "comb" ) == 0 )
+					combTables = true;
+				else if ( strcmp( arg, "paged" ) == 0 )
+					pagedTables = true;
+				else if ( strcmp( arg, "instrument" ) == 0 )
+					instrument = true;
+				else if ( strcmp( arg, "split-cold" ) == 0 )
+					splitCold = true;
+				else if ( strcmp( arg, "literal-runs" ) == 0 )
+					literalRuns = true;
+				else if ( strcmp( arg, "computed-goto" ) == 0 )
+					computedGoto = true;
+				else if ( strcmp( arg, "bench" ) == 0 ) {
+					bench = true;
+					if ( eq != 0 )
+						benchFileName = strdup( eq );
+				}
+				else if ( strcmp( arg, "bench-actions" ) == 0 )
+					benchActions = true;
+				else if ( strcmp( arg, "profile-use" ) == 0 ) {
+					if ( eq == 0 )
+						error() << "expecting '=file' for profile-use" << endl;
+					else
+						profileFileName = strdup( eq );
+				}
+				else if ( strcmp( arg, "style" ) == 0 ) {
+					if ( eq == 0 || strcmp( eq, "auto" ) != 0 )
+						error() << "expecting '=auto' for style" << endl;
+					else
+						codeStyle = GenAuto;
+				}
+				else if ( strcmp( arg, "style-budget" ) == 0 ) {
+					if ( eq == 0 || parseSize( eq ) == 0 )
+						error() << "expecting '=N' with N > 0 for style-budget" << endl;
+					else
+						styleBudget = parseSize( eq );
+				}
+				else if ( strcmp( arg, "streams" ) == 0 ) {
+					if ( eq == 0 || atoi( eq ) < 2 || atoi( eq ) > 8 )
+						error() << "expecting '=N' with N from 2 to 8 for streams" << endl;
+					else
+						numStreams = atoi( eq );
+				}
+				else if ( strcmp( arg, "dense-budget" ) == 0 ) {
+					if ( eq == 0 || parseSize( eq ) == 0 )
+						error() << "expecting '=N' with N > 0 for dense-budget" << endl;
+					else
+						denseBudget = parseSize( eq );
+				}
 				else if ( strcmp( arg, "rbx" ) == 0 )
 					rubyImpl = Rubinius;
 				else {
@@ -389,6 +621,8 @@ void InputData::parseArgs( int argc, const char **argv )
 					codeStyle = GenTables;
 				else if ( pc.paramArg[0] == '1' )
 					codeStyle = GenFTables;
+				else if ( pc.paramArg[0] == '2' )
+					codeStyle = GenDense;
 				else {
 					error() << "-T" << pc.paramArg[0] << 
 							" is an invalid argument" << endl;
@@ -454,6 +688,12 @@ void InputData::parseArgs( int argc, const char **argv )
 			break;
 		}
 	}
+
+	if ( cacheDir != 0 && !hashCacheBuild( argv[0] ) ) {
+		cerr << PROGNAME ": warning: could not find the ragel executable, "
+				"not using the cache" << endl;
+		cacheDir = 0;
+	}
 }
 
 void InputData::checkArgs()
@@ -61,8 +61,17 @@ void Token::append( const Token &other )
  * to the command line args. */
 void afterOpMinimize( FsmAp *fsm, bool lastInSeq )
 {
+	/* An operation went over the limits and left the graph incomplete. The
+	 * error is reported already, don't spend time on it. */
+	if ( fsm->ctx->limitExceeded )
+		return;
+
 	/* Switch on the prefered minimization algorithm. */
 	if ( minimizeOpt == MinimizeEveryOp || ( minimizeOpt == MinimizeMostOps && lastInSeq ) ) {
+		TimeStamp start;
+		if ( printTimings )
+			start = TimeStamp::now();
+
 		/* First clean up the graph. FsmAp operations may leave these
 		 * lying around. There should be no dead end states. The subtract
 		 * intersection operators are the only places where they may be
@@ -79,10 +88,18 @@ void afterOpMinimize( FsmAp *fsm, bool lastInSeq )
 			case MinimizePartition2:
 				fsm->minimizePartition2();
 				break;
+			case MinimizeHopcroft:
+				fsm->minimizeHopcroft();
+				break;
 			case MinimizeStable:
 				fsm->minimizeStable();
 				break;
 		}
+
+		if ( printTimings ) {
+			fsm->ctx->minimizeTime.addSince( start );
+			fsm->ctx->numMinimizes += 1;
+		}
 	}
 }
 
@@ -454,6 +471,10 @@ ParseData::ParseData( const char *fileName, char *sectionName,
 	nextEpsilonResolvedLink(0),
 	nextLongestMatchId(1),
 	lmRequiresErrorState(false),
+	varDefCacheHits(0),
+	opLhsStates(-1),
+	opRhsStates(-1),
+	limitReported(false),
 	cgd(0)
 {
 	/* Initialize the dictionary of graphs. This is our symbol table. The
@@ -463,6 +484,8 @@ ParseData::ParseData( const char *fileName, char *sectionName,
 	initGraphDict();
 
 	fsmCtx = new FsmCtx;
+	fsmCtx->stateLimit = maxStates;
+	fsmCtx->memoryLimit = maxMemory;
 }
 
 /* Clean up the data collected during a parse. */
@@ -471,6 +494,11 @@ ParseData::~ParseData()
 	/* Delete all the nodes in the action list. Will cause all the
 	 * string data that represents the actions to be deallocated. */
 	actionList.empty();
+
+	/* The graph nodes live in the pools of the context, which go with it. */
+	delete cgd;
+	delete sectionGraph;
+	delete fsmCtx;
 }
 
 /* Make a name id in the current name instantiation scope if it is not
@@ -1057,17 +1085,102 @@ void ParseData::setLongestMatchData( FsmAp *graph )
 	}
 }
 
+void ParseData::beginOp( FsmAp *lhs, FsmAp *rhs )
+{
+	opLhsStates = lhs != 0 ? lhs->stateList.length() : -1;
+	opRhsStates = rhs != 0 ? rhs->stateList.length() : -1;
+	if ( printTimings )
+		opStart = TimeStamp::now();
+}
+
+/* Check the result of an operation against the --max-states and --max-memory
+ * limits. Only the first operation to go over is reported, operations after
+ * it see an incomplete graph. */
+void ParseData::checkLimits( FsmAp *graph, const InputLoc &loc, const char *op )
+{
+	/* The operand sizes belong to this check only. */
+	long lhsStates = opLhsStates, rhsStates = opRhsStates;
+	opLhsStates = opRhsStates = -1;
+
+	/* Slow operations go in the timings. */
+	if ( printTimings && lhsStates >= 0 ) {
+		OpTiming opTiming;
+		opTiming.time.addSince( opStart );
+		if ( opTiming.time.wall >= opTimingThreshold ) {
+			opTiming.op = op;
+			opTiming.machine = sectionName;
+			opTiming.loc = loc;
+			opTiming.lhsStates = lhsStates;
+			opTiming.rhsStates = rhsStates;
+			opTiming.states = graph->stateList.length();
+			timings.ops.append( opTiming );
+		}
+	}
+
+	if ( !fsmCtx->overLimits( graph->stateList.length() ) || limitReported )
+		return;
+
+	limitReported = true;
+
+	bool overStates = fsmCtx->stateLimit > 0 && 
+			graph->stateList.length() > fsmCtx->stateLimit;
+
+	ostream &out = error(loc);
+	out << op << " exceeded the " << 
+			( overStates ? "state" : "memory" ) << " limit";
+	if ( lhsStates >= 0 ) {
+		out << ", operand" << ( rhsStates >= 0 ? "s have " : " has " ) <<
+				lhsStates;
+		if ( rhsStates >= 0 )
+			out << " and " << rhsStates;
+		out << " states";
+	}
+	out << ", result has at least " << graph->stateList.length() << 
+			" states in " << fsmCtx->nodeBytes() << " bytes" << endl;
+}
+
 /* Make the graph from a graph dict node. Does minimization and state sorting. */
 FsmAp *ParseData::makeInstance( GraphDictEl *gdNode )
 {
+	TimeStamp start, minimizeStart = fsmCtx->minimizeTime;
+	long numMinimizes = fsmCtx->numMinimizes;
+	if ( printTimings )
+		start = TimeStamp::now();
+
 	/* Build the graph from a walk of the parse tree. */
 	FsmAp *graph = gdNode->value->walk( this );
 
+	if ( printTimings ) {
+		/* The minimizations done after operations during the walk. They get
+		 * their own record and are taken out of the walk, so that no time is
+		 * in two phases. */
+		TimeStamp minimizeTime;
+		minimizeTime.wall = fsmCtx->minimizeTime.wall - minimizeStart.wall;
+		minimizeTime.cpu = fsmCtx->minimizeTime.cpu - minimizeStart.cpu;
+
+		PhaseTiming &walk = timings.addPhase( "walk", sectionName, start );
+		walk.instance = gdNode->key;
+		walk.time.subtract( minimizeTime );
+		timings.setCounts( walk, graph );
+
+		PhaseTiming &minimize = timings.addPhaseTime( "minimize", 
+				sectionName, minimizeTime );
+		minimize.kind = "after-op";
+		minimize.instance = gdNode->key;
+		minimize.count = fsmCtx->numMinimizes - numMinimizes;
+	}
+
 	/* Resolve any labels that point to multiple states. Any labels that are
 	 * still around are referenced only by gotos and calls and they need to be
 	 * made into deterministic entry points. */
 	graph->deterministicEntry();
 
+	/* Operations that don't go through the subset construction are caught
+	 * here. Past the limits there is no use finishing the graph. */
+	checkLimits( graph, gdNode->loc, "machine instantiation" );
+	if ( fsmCtx->limitExceeded )
+		return graph;
+
 	/*
 	 * All state construction is now complete.
 	 */
@@ -1097,6 +1210,9 @@ FsmAp *ParseData::makeInstance( GraphDictEl *gdNode )
 	graph->clearAllPriorities();
 
 	if ( minimizeOpt != MinimizeNone ) {
+		if ( printTimings )
+			start = TimeStamp::now();
+
 		/* Minimize here even if we minimized at every op. Now that function
 		 * keys have been cleared we may get a more minimal fsm. */
 		switch ( minimizeLevel ) {
@@ -1112,6 +1228,16 @@ FsmAp *ParseData::makeInstance( GraphDictEl *gdNode )
 			case MinimizePartition2:
 				graph->minimizePartition2();
 				break;
+			case MinimizeHopcroft:
+				graph->minimizeHopcroft();
+				break;
+		}
+
+		if ( printTimings ) {
+			PhaseTiming &minimize = timings.addPhase( "minimize", sectionName, start );
+			minimize.kind = "final";
+			minimize.instance = gdNode->key;
+			timings.setCounts( minimize, graph );
 		}
 	}
 
@@ -1365,6 +1491,14 @@ void ParseData::makeExports()
 }
 
 void ParseData::prepareMachineGen( GraphDictEl *graphDictEl )
+{
+	makeSectionGraph( graphDictEl );
+	analyzeSectionGraph();
+}
+
+/* Build the section graph. This touches only data owned by the parse data, so
+ * the graphs of different specifications can be made at the same time. */
+void ParseData::makeSectionGraph( GraphDictEl *graphDictEl )
 {
 	initKeyOps();
 	makeRootNames();
@@ -1379,10 +1513,23 @@ void ParseData::prepareMachineGen( GraphDictEl *graphDictEl )
 	/* Compute exports from the export definitions. */
 	makeExports();
 
+	/* The cached machines are not needed past this point. */
+	for ( GraphDict::Iter gdel = graphDict; gdel.lte(); gdel++ ) {
+		delete gdel->value->cachedFsm;
+		gdel->value->cachedFsm = 0;
+	}
+}
+
+void ParseData::analyzeSectionGraph()
+{
 	/* If any errors have occured in the input file then don't write anything. */
 	if ( gblErrorCount > 0 )
 		return;
 
+	TimeStamp start;
+	if ( printTimings )
+		start = TimeStamp::now();
+
 	analyzeGraph( sectionGraph );
 
 	/* Depends on the graph analysis. */
@@ -1405,6 +1552,62 @@ void ParseData::prepareMachineGen( GraphDictEl *graphDictEl )
 	sectionGraph->depthFirstOrdering();
 	sectionGraph->sortStatesByFinal();
 	sectionGraph->setStateNumbers( 0 );
+
+	if ( printTimings ) {
+		PhaseTiming &analyze = timings.addPhase( "analyze", sectionName, start );
+		timings.setCounts( analyze, sectionGraph );
+	}
+}
+
+/* The section graph with the actions taken out, for write match. Usually many
+ * states that only the actions kept apart merge. Must be called after the
+ * section graph is analyzed. */
+FsmAp *ParseData::makeMatchGraph()
+{
+	FsmAp *graph = new FsmAp( *sectionGraph );
+
+	/* The copy mapped the states through the state numbers. */
+	sectionGraph->setStateNumbers( 0 );
+
+	graph->stripActions();
+
+	/* Entry points are kept for fgoto and fcall, which are gone. The error
+	 * state, copied as an ordinary state, is a dead end. */
+	graph->unsetAllEntryPoints();
+	graph->removeUnreachableStates();
+	graph->removeDeadEndStates();
+
+	if ( minimizeOpt != MinimizeNone ) {
+		switch ( minimizeLevel ) {
+			case MinimizeApprox:
+				graph->minimizeApproximate();
+				break;
+			case MinimizeStable:
+				graph->minimizeStable();
+				break;
+			case MinimizePartition1:
+				graph->minimizePartition1();
+				break;
+			case MinimizePartition2:
+				graph->minimizePartition2();
+				break;
+			case MinimizeHopcroft:
+				graph->minimizeHopcroft();
+				break;
+		}
+	}
+
+	graph->compressTransitions();
+
+	/* As for the section graph. */
+	if ( graph->hasErrorTrans() )
+		graph->errState = graph->addState();
+
+	graph->depthFirstOrdering();
+	graph->sortStatesByFinal();
+	graph->setStateNumbers( 0 );
+
+	return graph;
 }
 
 CodeGenData *makeCodeGen( const CodeGenArgs &args );
@@ -1414,18 +1617,41 @@ void ParseData::generateReduced( InputData &inputData )
 	CodeGenArgs args( inputData, inputData.inputFileName,
 			sectionName, this, sectionGraph, *inputData.outStream );
 
+	TimeStamp start;
+	if ( printTimings )
+		start = TimeStamp::now();
+
 	/* Write out with it. */
 	cgd = makeCodeGen( args );
 
 	cgd->make();
 
+	if ( printTimings )
+		timings.addPhase( "codegen", sectionName, start );
+
 	if ( printStatistics ) {
 		cerr << "fsm name  : " << sectionName << endl;
 		cerr << "num states: " << sectionGraph->stateList.length() << endl;
+		printNodeStatistics();
 		cerr << endl;
 	}
 }
 
+/* Report on the graph node pools. */
+void ParseData::printNodeStatistics()
+{
+	NodePool *pools[3] = { &fsmCtx->statePool, &fsmCtx->transPool, &fsmCtx->condPool };
+	const char *names[3] = { "states", "trans", "conds" };
+
+	for ( int p = 0; p < 3; p++ ) {
+		cerr << "node allocs: " << names[p] << " " << pools[p]->numAllocs <<
+				", peak " << pools[p]->maxLive << ", slab bytes " <<
+				pools[p]->slabBytes << endl;
+	}
+
+	cerr << "machine cache hits: " << varDefCacheHits << endl;
+}
+
 void ParseData::generateXML( ostream &out )
 {
 	/* Make the generator. */
@@ -1437,6 +1663,7 @@ void ParseData::generateXML( ostream &out )
 	if ( printStatistics ) {
 		cerr << "fsm name  : " << sectionName << endl;
 		cerr << "num states: " << sectionGraph->stateList.length() << endl;
+		printNodeStatistics();
 		cerr << endl;
 	}
 }
@@ -228,8 +228,12 @@ struct ParseData
 	void makeExports();
 
 	void prepareMachineGen( GraphDictEl *graphDictEl );
+	void makeSectionGraph( GraphDictEl *graphDictEl );
+	void analyzeSectionGraph();
+	FsmAp *makeMatchGraph();
 	void generateXML( ostream &out );
 	void generateReduced( InputData &inputData );
+	void printNodeStatistics();
 	FsmAp *sectionGraph;
 	bool generatingSectionSubset;
 
@@ -340,6 +344,21 @@ struct ParseData
 	int nextLongestMatchId;
 	bool lmRequiresErrorState;
 
+	/* Number of machine references satisfied by copying a cached walk. */
+	long varDefCacheHits;
+
+	/* Checking the state and memory limits. The operand sizes are recorded
+	 * before an operation so the error can report them. */
+	void beginOp( FsmAp *lhs, FsmAp *rhs = 0 );
+	void checkLimits( FsmAp *graph, const InputLoc &loc, const char *op );
+	long opLhsStates, opRhsStates;
+	bool limitReported;
+
+	/* Timings of the phases run on this specification, for --timings. The
+	 * start of the operation being checked is kept by beginOp. */
+	Timings timings;
+	TimeStamp opStart;
+
 	/* List of all longest match parse tree items. */
 	LmList lmList;
 
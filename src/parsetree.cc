@@ -85,11 +85,37 @@ char *prepareLitString( const InputLoc &loc, const char *data, long length,
 	return resData;
 }
 
+/* Is any name at or below nameInst the target of a reference. */
+static bool nameTreeReferenced( NameInst *nameInst )
+{
+	if ( nameInst->numRefs > 0 )
+		return true;
+	for ( NameVect::Iter child = nameInst->childVect; child.lte(); child++ ) {
+		if ( nameTreeReferenced( *child ) )
+			return true;
+	}
+	return false;
+}
+
 FsmAp *VarDef::walk( ParseData *pd )
 {
 	/* We enter into a new name scope. */
 	NameFrame nameFrame = pd->enterNameScope( true, 1 );
 
+	/* If an earlier reference built a machine that does not depend on action
+	 * or priority ordering then copy it, provided nothing in this instance of
+	 * the name tree needs an entry point. */
+	if ( cachedFsm != 0 && !nameTreeReferenced( pd->curNameInst ) ) {
+		pd->varDefCacheHits += 1;
+		pd->popNameScope( nameFrame );
+		return new FsmAp( *cachedFsm );
+	}
+
+	/* Snapshot the orderings so we can tell if the walk used them. */
+	int actionOrd = pd->curActionOrd;
+	int priorOrd = pd->curPriorOrd;
+	int epsilonLink = pd->nextEpsilonResolvedLink;
+
 	/* Recurse on the expression. */
 	FsmAp *rtnVal = machineDef->walk( pd );
 	
@@ -114,6 +140,14 @@ FsmAp *VarDef::walk( ParseData *pd )
 	if ( pd->curNameInst->numRefs > 0 )
 		rtnVal->setEntry( pd->curNameInst->id, rtnVal->startState );
 
+	/* A machine that is free of orderings and entry points is the same no
+	 * matter where it is referenced from. */
+	if ( cachedFsm == 0 && actionOrd == pd->curActionOrd &&
+			priorOrd == pd->curPriorOrd &&
+			epsilonLink == pd->nextEpsilonResolvedLink &&
+			rtnVal->entryPoints.length() == 0 )
+		cachedFsm = new FsmAp( *rtnVal );
+
 	/* Pop the name scope. */
 	pd->popNameScope( nameFrame );
 	return rtnVal;
@@ -514,7 +548,9 @@ FsmAp *LongestMatch::walk( ParseData *pd )
 	 * there will always be at least one part. */
 	FsmAp *rtnVal = parts[0];
 	for ( int i = 1; i < longestMatchList->length(); i++ ) {
+		pd->beginOp( rtnVal, parts[i] );
 		rtnVal->unionOp( parts[i] );
+		pd->checkLimits( rtnVal, loc, "scanner" );
 		afterOpMinimize( rtnVal );
 	}
 
@@ -583,10 +619,10 @@ Join::Join( const InputLoc &loc, Expression *expr )
 	exprList.append( expr );
 }
 
-/* Construct with a location and the first expression. */
+/* Construct with the first expression, at its location. */
 Join::Join( Expression *expr )
 :
-	loc(loc)
+	loc(expr->loc)
 {
 	exprList.append( expr );
 }
@@ -632,7 +668,9 @@ FsmAp *Join::walkJoin( ParseData *pd )
 
 	/* Join machines 1 and up onto machine 0. */
 	FsmAp *retFsm = fsms[0];
+	pd->beginOp( retFsm, 0 );
 	retFsm->joinOp( startId, finalId, fsms+1, exprList.length()-1 );
+	pd->checkLimits( retFsm, loc, "join" );
 
 	/* We can now unset entry points that are not longer used. */
 	pd->unsetObsoleteEntries( retFsm );
@@ -711,6 +749,18 @@ void Join::resolveNameRefs( ParseData *pd )
 	}
 }
 
+Expression::Expression( Term *term )
+:
+	loc(term->loc),
+	expression(0),
+	term(term),
+	builtin(BT_Any),
+	type(TermType),
+	prev(this),
+	next(this)
+{
+}
+
 /* Clean up after an expression node. */
 Expression::~Expression()
 {
@@ -734,12 +784,8 @@ FsmAp *Expression::walk( ParseData *pd, bool lastInSeq )
 	FsmAp *rtnVal = 0;
 	switch ( type ) {
 		case OrType: {
-			/* Evaluate the expression. */
-			rtnVal = expression->walk( pd, false );
-			/* Evaluate the term. */
-			FsmAp *rhs = term->walk( pd );
-			/* Perform union. */
-			rtnVal->unionOp( rhs );
+			/* Evaluate the whole run of alternatives. */
+			rtnVal = walkAlternatives( pd );
 			afterOpMinimize( rtnVal, lastInSeq );
 			break;
 		}
@@ -749,7 +795,9 @@ FsmAp *Expression::walk( ParseData *pd, bool lastInSeq )
 			/* Evaluate the term. */
 			FsmAp *rhs = term->walk( pd );
 			/* Perform intersection. */
+			pd->beginOp( rtnVal, rhs );
 			rtnVal->intersectOp( rhs );
+			pd->checkLimits( rtnVal, loc, "intersection" );
 			afterOpMinimize( rtnVal, lastInSeq );
 			break;
 		}
@@ -759,7 +807,9 @@ FsmAp *Expression::walk( ParseData *pd, bool lastInSeq )
 			/* Evaluate the term. */
 			FsmAp *rhs = term->walk( pd );
 			/* Perform subtraction. */
+			pd->beginOp( rtnVal, rhs );
 			rtnVal->subtractOp( rhs );
+			pd->checkLimits( rtnVal, loc, "subtraction" );
 			afterOpMinimize( rtnVal, lastInSeq );
 			break;
 		}
@@ -775,7 +825,9 @@ FsmAp *Expression::walk( ParseData *pd, bool lastInSeq )
 			rhs->concatOp( trailAnyStar );
 
 			/* Perform subtraction. */
+			pd->beginOp( rtnVal, rhs );
 			rtnVal->subtractOp( rhs );
+			pd->checkLimits( rtnVal, loc, "strong subtraction" );
 			afterOpMinimize( rtnVal, lastInSeq );
 			break;
 		}
@@ -794,6 +846,76 @@ FsmAp *Expression::walk( ParseData *pd, bool lastInSeq )
 	return rtnVal;
 }
 
+/* Evaluate a run of alternatives. Plain literal strings are made into one trie
+ * machine. The rest are walked in order and the machines are unioned as a
+ * balanced tree, rather than folding a long run one term at a time. */
+FsmAp *Expression::walkAlternatives( ParseData *pd )
+{
+	/* Collect the terms of the run. They come last first. */
+	Vector<Term*> terms;
+	Expression *expr = this;
+	while ( expr->type == OrType ) {
+		terms.prepend( expr->term );
+		expr = expr->expression;
+	}
+
+	Vector<FsmAp*> fsms;
+	Vector<KeyString> strings;
+
+	/* The first alternative. */
+	if ( expr->type == TermType )
+		terms.prepend( expr->term );
+	else
+		fsms.append( expr->walk( pd, false ) );
+
+	for ( int t = 0; t < terms.length(); t++ ) {
+		Literal *literal = terms[t]->plainLiteral();
+		if ( literal == 0 )
+			fsms.append( terms[t]->walk( pd ) );
+		else {
+			long length;
+			bool caseInsensitive;
+			Key *keys = literal->makeKeys( pd, length, caseInsensitive );
+			if ( caseInsensitive ) {
+				FsmAp *fsm = new FsmAp( pd->fsmCtx );
+				fsm->concatFsmCI( keys, length );
+				fsms.append( fsm );
+				delete[] keys;
+			}
+			else {
+				KeyString keyString = { keys, length };
+				strings.append( keyString );
+			}
+		}
+	}
+
+	if ( strings.length() > 0 ) {
+		FsmAp *trie = new FsmAp( pd->fsmCtx );
+		trie->trieFsm( strings.data, strings.length() );
+		fsms.append( trie );
+
+		for ( int s = 0; s < strings.length(); s++ )
+			delete[] strings[s].data;
+	}
+
+	/* Union pairs of machines until one is left. */
+	while ( fsms.length() > 1 ) {
+		int numFsms = 0;
+		for ( int f = 0; f < fsms.length(); f += 2 ) {
+			if ( f + 1 < fsms.length() ) {
+				pd->beginOp( fsms[f], fsms[f+1] );
+				fsms[f]->unionOp( fsms[f+1] );
+				pd->checkLimits( fsms[f], loc, "union" );
+				afterOpMinimize( fsms[f], false );
+			}
+			fsms[numFsms++] = fsms[f];
+		}
+		fsms.remove( numFsms, fsms.length() - numFsms );
+	}
+
+	return fsms[0];
+}
+
 void Expression::makeNameTree( ParseData *pd )
 {
 	switch ( type ) {
@@ -830,6 +952,15 @@ void Expression::resolveNameRefs( ParseData *pd )
 	}
 }
 
+Term::Term( FactorWithAug *factorWithAug )
+:
+	loc(factorWithAug->getLoc()),
+	term(0),
+	factorWithAug(factorWithAug),
+	type(FactorWithAugType)
+{
+}
+
 /* Clean up after a term node. */
 Term::~Term()
 {
@@ -858,7 +989,9 @@ FsmAp *Term::walk( ParseData *pd, bool lastInSeq )
 			/* Evaluate the FactorWithRep. */
 			FsmAp *rhs = factorWithAug->walk( pd );
 			/* Perform concatenation. */
+			pd->beginOp( rtnVal, rhs );
 			rtnVal->concatOp( rhs );
+			pd->checkLimits( rtnVal, loc, "concatenation" );
 			afterOpMinimize( rtnVal, lastInSeq );
 			break;
 		}
@@ -882,7 +1015,9 @@ FsmAp *Term::walk( ParseData *pd, bool lastInSeq )
 			rhs->startFsmPrior( pd->curPriorOrd++, &priorDescs[1] );
 
 			/* Perform concatenation. */
+			pd->beginOp( rtnVal, rhs );
 			rtnVal->concatOp( rhs );
+			pd->checkLimits( rtnVal, loc, "entry-guarded concatenation" );
 			afterOpMinimize( rtnVal, lastInSeq );
 			break;
 		}
@@ -915,7 +1050,9 @@ FsmAp *Term::walk( ParseData *pd, bool lastInSeq )
 			}
 
 			/* Perform concatenation. */
+			pd->beginOp( rtnVal, rhs );
 			rtnVal->concatOp( rhs );
+			pd->checkLimits( rtnVal, loc, "finish-guarded concatenation" );
 			afterOpMinimize( rtnVal, lastInSeq );
 			break;
 		}
@@ -942,7 +1079,9 @@ FsmAp *Term::walk( ParseData *pd, bool lastInSeq )
 			rhs->startFsmPrior( pd->curPriorOrd++, &priorDescs[1] );
 
 			/* Perform concatenation. */
+			pd->beginOp( rtnVal, rhs );
 			rtnVal->concatOp( rhs );
+			pd->checkLimits( rtnVal, loc, "left-guarded concatenation" );
 			afterOpMinimize( rtnVal, lastInSeq );
 			break;
 		}
@@ -986,6 +1125,32 @@ void Term::resolveNameRefs( ParseData *pd )
 	}
 }
 
+/* If the term is a literal with nothing else attached then return it. */
+Literal *Term::plainLiteral()
+{
+	if ( type != FactorWithAugType )
+		return 0;
+
+	FactorWithAug *fwa = factorWithAug;
+	if ( fwa->actions.length() > 0 || fwa->priorityAugs.length() > 0 ||
+			fwa->labels.length() > 0 || fwa->epsilonLinks.length() > 0 ||
+			fwa->conditions.length() > 0 )
+		return 0;
+
+	FactorWithRep *fwr = fwa->factorWithRep;
+	if ( fwr->type != FactorWithRep::FactorWithNegType )
+		return 0;
+
+	FactorWithNeg *fwn = fwr->factorWithNeg;
+	if ( fwn->type != FactorWithNeg::FactorType )
+		return 0;
+
+	if ( fwn->factor->type != Factor::LiteralType )
+		return 0;
+
+	return fwn->factor->literal;
+}
+
 /* Clean up after a factor with augmentation node. */
 FactorWithAug::~FactorWithAug()
 {
@@ -998,6 +1163,11 @@ FactorWithAug::~FactorWithAug()
 		delete[] priorDescs;
 }
 
+InputLoc FactorWithAug::getLoc()
+{
+	return factorWithRep->getLoc();
+}
+
 void FactorWithAug::assignActions( ParseData *pd, FsmAp *graph, int *actionOrd )
 {
 	/* Assign actions. */
@@ -1386,6 +1556,12 @@ FactorWithRep::~FactorWithRep()
 	}
 }
 
+InputLoc FactorWithRep::getLoc()
+{
+	return type == FactorWithNegType ? 
+			factorWithNeg->getLoc() : factorWithRep->getLoc();
+}
+
 /* Evaluate a factor with repetition node. */
 FsmAp *FactorWithRep::walk( ParseData *pd )
 {
@@ -1403,7 +1579,9 @@ FsmAp *FactorWithRep::walk( ParseData *pd )
 
 		/* Shift over the start action orders then do the kleene star. */
 		pd->curActionOrd += retFsm->shiftStartActionOrder( pd->curActionOrd );
+		pd->beginOp( retFsm, 0 );
 		retFsm->starOp( );
+		pd->checkLimits( retFsm, loc, "kleene star" );
 		afterOpMinimize( retFsm );
 		break;
 	}
@@ -1429,7 +1607,9 @@ FsmAp *FactorWithRep::walk( ParseData *pd )
 
 		/* Shift over the start action orders then do the kleene star. */
 		pd->curActionOrd += retFsm->shiftStartActionOrder( pd->curActionOrd );
+		pd->beginOp( retFsm, 0 );
 		retFsm->starOp( );
+		pd->checkLimits( retFsm, loc, "longest-match kleene star" );
 		afterOpMinimize( retFsm );
 		break;
 	}
@@ -1442,7 +1622,9 @@ FsmAp *FactorWithRep::walk( ParseData *pd )
 		retFsm = factorWithRep->walk( pd );
 
 		/* Perform the question operator. */
+		pd->beginOp( retFsm, 0 );
 		retFsm->unionOp( nu );
+		pd->checkLimits( retFsm, loc, "optional" );
 		afterOpMinimize( retFsm );
 		break;
 	}
@@ -1461,10 +1643,14 @@ FsmAp *FactorWithRep::walk( ParseData *pd )
 		pd->curActionOrd += dup->shiftStartActionOrder( pd->curActionOrd );
 
 		/* Star the duplicate. */
+		pd->beginOp( dup, 0 );
 		dup->starOp( );
+		pd->checkLimits( dup, loc, "plus" );
 		afterOpMinimize( dup );
 
+		pd->beginOp( retFsm, dup );
 		retFsm->concatOp( dup );
+		pd->checkLimits( retFsm, loc, "plus" );
 		afterOpMinimize( retFsm );
 		break;
 	}
@@ -1492,7 +1678,9 @@ FsmAp *FactorWithRep::walk( ParseData *pd )
 			pd->curActionOrd += retFsm->shiftStartActionOrder( pd->curActionOrd );
 
 			/* Do the repetition on the machine. Already guarded against n == 0 */
+			pd->beginOp( retFsm, 0 );
 			retFsm->repeatOp( lowerRep );
+			pd->checkLimits( retFsm, loc, "repetition" );
 			afterOpMinimize( retFsm );
 		}
 		break;
@@ -1521,7 +1709,9 @@ FsmAp *FactorWithRep::walk( ParseData *pd )
 			pd->curActionOrd += retFsm->shiftStartActionOrder( pd->curActionOrd );
 
 			/* Do the repetition on the machine. Already guarded against n == 0 */
+			pd->beginOp( retFsm, 0 );
 			retFsm->optionalRepeatOp( upperRep );
+			pd->checkLimits( retFsm, loc, "repetition" );
 			afterOpMinimize( retFsm );
 		}
 		break;
@@ -1540,7 +1730,9 @@ FsmAp *FactorWithRep::walk( ParseData *pd )
 	
 		if ( lowerRep == 0 ) {
 			/* Acts just like a star op on the machine to return. */
+			pd->beginOp( retFsm, 0 );
 			retFsm->starOp( );
+			pd->checkLimits( retFsm, loc, "repetition" );
 			afterOpMinimize( retFsm );
 		}
 		else {
@@ -1548,15 +1740,21 @@ FsmAp *FactorWithRep::walk( ParseData *pd )
 			FsmAp *dup = new FsmAp( *retFsm );
 
 			/* Do repetition on the first half. */
+			pd->beginOp( retFsm, 0 );
 			retFsm->repeatOp( lowerRep );
+			pd->checkLimits( retFsm, loc, "repetition" );
 			afterOpMinimize( retFsm );
 
 			/* Star the duplicate. */
+			pd->beginOp( dup, 0 );
 			dup->starOp( );
+			pd->checkLimits( dup, loc, "repetition" );
 			afterOpMinimize( dup );
 
 			/* Tak on the kleene star. */
+			pd->beginOp( retFsm, dup );
 			retFsm->concatOp( dup );
+			pd->checkLimits( retFsm, loc, "repetition" );
 			afterOpMinimize( retFsm );
 		}
 		break;
@@ -1593,12 +1791,16 @@ FsmAp *FactorWithRep::walk( ParseData *pd )
 
 			if ( lowerRep == 0 ) {
 				/* Just doing max repetition. Already guarded against n == 0. */
+				pd->beginOp( retFsm, 0 );
 				retFsm->optionalRepeatOp( upperRep );
+				pd->checkLimits( retFsm, loc, "repetition" );
 				afterOpMinimize( retFsm );
 			}
 			else if ( lowerRep == upperRep ) {
 				/* Just doing exact repetition. Already guarded against n == 0. */
+				pd->beginOp( retFsm, 0 );
 				retFsm->repeatOp( lowerRep );
+				pd->checkLimits( retFsm, loc, "repetition" );
 				afterOpMinimize( retFsm );
 			}
 			else {
@@ -1607,15 +1809,21 @@ FsmAp *FactorWithRep::walk( ParseData *pd )
 				FsmAp *dup = new FsmAp( *retFsm );
 
 				/* Do repetition on the first half. */
+				pd->beginOp( retFsm, 0 );
 				retFsm->repeatOp( lowerRep );
+				pd->checkLimits( retFsm, loc, "repetition" );
 				afterOpMinimize( retFsm );
 
 				/* Do optional repetition on the second half. */
+				pd->beginOp( dup, 0 );
 				dup->optionalRepeatOp( upperRep - lowerRep );
+				pd->checkLimits( dup, loc, "repetition" );
 				afterOpMinimize( dup );
 
 				/* Tak on the duplicate machine. */
+				pd->beginOp( retFsm, dup );
 				retFsm->concatOp( dup );
+				pd->checkLimits( retFsm, loc, "repetition" );
 				afterOpMinimize( retFsm );
 			}
 		}
@@ -1681,6 +1889,11 @@ FactorWithNeg::~FactorWithNeg()
 	}
 }
 
+InputLoc FactorWithNeg::getLoc()
+{
+	return type == FactorType && factor != 0 ? factor->loc : loc;
+}
+
 /* Evaluate a factor with negation node. */
 FsmAp *FactorWithNeg::walk( ParseData *pd )
 {
@@ -1693,7 +1906,9 @@ FsmAp *FactorWithNeg::walk( ParseData *pd )
 
 		/* Negation is subtract from dot-star. */
 		retFsm = dotStarFsm( pd );
+		pd->beginOp( toNegate, 0 );
 		retFsm->subtractOp( toNegate );
+		pd->checkLimits( retFsm, loc, "negation" );
 		afterOpMinimize( retFsm );
 		break;
 	}
@@ -1703,7 +1918,9 @@ FsmAp *FactorWithNeg::walk( ParseData *pd )
 
 		/* CharNegation is subtract from dot. */
 		retFsm = dotFsm( pd );
+		pd->beginOp( toNegate, 0 );
 		retFsm->subtractOp( toNegate );
+		pd->checkLimits( retFsm, loc, "character negation" );
 		afterOpMinimize( retFsm );
 		break;
 	}
@@ -1901,10 +2118,7 @@ FsmAp *Literal::walk( ParseData *pd )
 		/* Make the array of keys in int format. */
 		long length;
 		bool caseInsensitive;
-		char *data = prepareLitString( token.loc, token.data, token.length, 
-				length, caseInsensitive );
-		Key *arr = new Key[length];
-		makeFsmKeyArray( arr, data, length, pd );
+		Key *arr = makeKeys( pd, length, caseInsensitive );
 
 		/* Make the new machine. */
 		rtnVal = new FsmAp( pd->fsmCtx );
@@ -1912,13 +2126,35 @@ FsmAp *Literal::walk( ParseData *pd )
 			rtnVal->concatFsmCI( arr, length );
 		else
 			rtnVal->concatFsm( arr, length );
-		delete[] data;
 		delete[] arr;
 		break;
 	}}
 	return rtnVal;
 }
 
+/* Make the array of keys for the literal. The caller frees it. */
+Key *Literal::makeKeys( ParseData *pd, long &length, bool &caseInsensitive )
+{
+	Key *arr = 0;
+	switch ( type ) {
+	case Number: {
+		length = 1;
+		caseInsensitive = false;
+		arr = new Key[1];
+		arr[0] = makeFsmKeyNum( token.data, token.loc, pd );
+		break;
+	}
+	case LitString: {
+		char *data = prepareLitString( token.loc, token.data, token.length, 
+				length, caseInsensitive );
+		arr = new Key[length];
+		makeFsmKeyArray( arr, data, length, pd );
+		delete[] data;
+		break;
+	}}
+	return arr;
+}
+
 /* Clean up after a regular expression object. */
 RegExpr::~RegExpr()
 {
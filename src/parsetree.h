@@ -223,7 +223,8 @@ struct PriorityAug
 struct VarDef
 {
 	VarDef( const char *name, MachineDef *machineDef )
-		: name(name), machineDef(machineDef), isExport(false) { }
+		: name(name), machineDef(machineDef), isExport(false),
+		cachedFsm(0) { }
 	
 	/* Parse tree traversal. */
 	FsmAp *walk( ParseData *pd );
@@ -233,6 +234,10 @@ struct VarDef
 	const char *name;
 	MachineDef *machineDef;
 	bool isExport;
+
+	/* The result of a walk that embedded no actions, priorities or entry
+	 * points. Further references take copies of it. */
+	FsmAp *cachedFsm;
 };
 
 
@@ -383,28 +388,28 @@ struct Expression
 	};
 
 	/* Construct with an expression on the left and a term on the right. */
-	Expression( Expression *expression, Term *term, Type type ) : 
-		expression(expression), term(term), 
+	Expression( const InputLoc &loc, Expression *expression, Term *term, Type type ) : 
+		loc(loc), expression(expression), term(term), 
 		builtin(builtin), type(type), prev(this), next(this) { }
 
-	/* Construct with only a term. */
-	Expression( Term *term ) : 
-		expression(0), term(term), builtin(builtin), 
-		type(TermType) , prev(this), next(this) { }
+	/* Construct with only a term, at the location of the term. */
+	Expression( Term *term );
 	
 	/* Construct with a builtin type. */
 	Expression( BuiltinMachine builtin ) : 
-		expression(0), term(0), builtin(builtin), 
+		loc(), expression(0), term(0), builtin(builtin), 
 		type(BuiltinType), prev(this), next(this) { }
 
 	~Expression();
 
 	/* Tree traversal. */
 	FsmAp *walk( ParseData *pd, bool lastInSeq = true );
+	FsmAp *walkAlternatives( ParseData *pd );
 	void makeNameTree( ParseData *pd );
 	void resolveNameRefs( ParseData *pd );
 
 	/* Node data. */
+	InputLoc loc;
 	Expression *expression;
 	Term *term;
 	BuiltinMachine builtin;
@@ -426,14 +431,11 @@ struct Term
 		FactorWithAugType
 	};
 
-	Term( Term *term, FactorWithAug *factorWithAug ) :
-		term(term), factorWithAug(factorWithAug), type(ConcatType) { }
-
-	Term( Term *term, FactorWithAug *factorWithAug, Type type ) :
-		term(term), factorWithAug(factorWithAug), type(type) { }
+	Term( const InputLoc &loc, Term *term, FactorWithAug *factorWithAug, Type type ) :
+		loc(loc), term(term), factorWithAug(factorWithAug), type(type) { }
 
-	Term( FactorWithAug *factorWithAug ) :
-		term(0), factorWithAug(factorWithAug), type(FactorWithAugType) { }
+	/* Construct with only a factor, at the location of the factor. */
+	Term( FactorWithAug *factorWithAug );
 	
 	~Term();
 
@@ -441,6 +443,9 @@ struct Term
 	void makeNameTree( ParseData *pd );
 	void resolveNameRefs( ParseData *pd );
 
+	Literal *plainLiteral();
+
+	InputLoc loc;
 	Term *term;
 	FactorWithAug *factorWithAug;
 	Type type;
@@ -467,6 +472,9 @@ struct FactorWithAug
 
 	void assignConditions( FsmAp *graph );
 
+	/* Location of the first token. */
+	InputLoc getLoc();
+
 	/* Actions and priorities assigned to the factor node. */
 	Vector<ParserAction> actions;
 	Vector<PriorityAug> priorityAugs;
@@ -510,6 +518,9 @@ struct FactorWithRep
 	void makeNameTree( ParseData *pd );
 	void resolveNameRefs( ParseData *pd );
 
+	/* Location of the first token. */
+	InputLoc getLoc();
+
 	InputLoc loc;
 	FactorWithRep *factorWithRep;
 	FactorWithNeg *factorWithNeg;
@@ -542,6 +553,9 @@ struct FactorWithNeg
 	void makeNameTree( ParseData *pd );
 	void resolveNameRefs( ParseData *pd );
 
+	/* Location of the first token. */
+	InputLoc getLoc();
+
 	InputLoc loc;
 	FactorWithNeg *factorWithNeg;
 	Factor *factor;
@@ -634,6 +648,7 @@ struct Literal
 		: token(token), type(type) { }
 
 	FsmAp *walk( ParseData *pd );
+	Key *makeKeys( ParseData *pd, long &length, bool &caseInsensitive );
 	
 	Token token;
 	LiteralType type;
@@ -0,0 +1,63 @@
+/*
+ *  Copyright 2026 agent <agent@local>
+ */
+
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+#include <string.h>
+#include "vector.h"
+
+/* A count from a profile. The key is the byte as an unsigned char, or -1 for
+ * a count of the state only. */
+struct ProfileCount
+{
+	long state;
+	long key;
+	unsigned long long count;
+};
+
+/* The counts of one machine. */
+struct ProfileMachine
+{
+	char *name;
+	Vector<ProfileCount> counts;
+};
+
+/* Counts read with --profile-use from the files written by code generated
+ * with --instrument. */
+struct Profile
+{
+	ProfileMachine *find( const char *name )
+	{
+		for ( int m = 0; m < machines.length(); m++ ) {
+			if ( strcmp( machines[m]->name, name ) == 0 )
+				return machines[m];
+		}
+		return 0;
+	}
+
+	Vector<ProfileMachine*> machines;
+};
+
+extern Profile *gblProfile;
+
+#endif
@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include "vector.h"
 #include "config.h"
@@ -37,12 +38,14 @@ enum CodeStyle
 {
 	GenTables,
 	GenFTables,
+	GenDense,
 	GenFlat,
 	GenFFlat,
 	GenGoto,
 	GenFGoto,
 	GenIpGoto,
-	GenSplit
+	GenSplit,
+	GenAuto
 };
 
 /* To what degree are machine minimized. */
@@ -50,7 +53,8 @@ enum MinimizeLevel {
 	MinimizeApprox,
 	MinimizeStable,
 	MinimizePartition1,
-	MinimizePartition2
+	MinimizePartition2,
+	MinimizeHopcroft
 };
 
 enum MinimizeOpt {
@@ -72,6 +76,12 @@ extern MinimizeLevel minimizeLevel;
 extern MinimizeOpt minimizeOpt;
 extern const char *machineSpec, *machineName;
 extern bool printStatistics;
+extern int numJobs;
+extern const char *cacheDir;
+extern long maxStates, maxMemory;
+extern bool printTimings;
+extern const char *timingsFileName;
+extern double opTimingThreshold;
 extern bool wantDupsRemoved;
 extern RubyImplEnum rubyImpl;
 
@@ -96,6 +106,21 @@ std::ostream &error();
 std::ostream &error( const InputLoc &loc ); 
 std::ostream &warning( const InputLoc &loc ); 
 
+/* Diagnostics of a machine built on a worker thread. They are written out
+ * once all the machines are built, in the order the machines are given. */
+struct ErrorBuffer
+{
+	ErrorBuffer() : errorCount(0) {}
+
+	std::ostringstream out;
+	int errorCount;
+};
+
+/* Send the diagnostics of the calling thread to a buffer. Zero restores
+ * cerr and the global error count. */
+void setErrorBuffer( ErrorBuffer *errorBuffer );
+ErrorBuffer *getErrorBuffer();
+
 struct XmlParser;
 
 void xmlEscapeHost( std::ostream &out, char *data, long len );
@@ -109,6 +134,21 @@ extern int gblErrorCount;
 /* Options. */
 extern int numSplitPartitions;
 extern bool noLineDirectives;
+extern bool simdSkip;
+extern bool byteClasses;
+extern bool combTables;
+extern bool pagedTables;
+extern long denseBudget;
+extern long styleBudget;
+extern int numStreams;
+extern bool instrument;
+extern bool splitCold;
+extern bool literalRuns;
+extern bool computedGoto;
+extern const char *profileFileName;
+extern bool bench;
+extern const char *benchFileName;
+extern bool benchActions;
 
 extern long maxTransitions;
 
@@ -64,7 +64,18 @@ RedFsmAp::RedFsmAp( KeyOps *keyOps )
 	bAnyRegNextStmt(false),
 	bAnyRegCurStateRef(false),
 	bAnyRegBreak(false),
-	bUsingAct(false)
+	bUsingAct(false),
+	byteClass(0),
+	numByteClasses(0),
+	combNext(0),
+	combCheck(0),
+	combLength(0),
+	pages(0),
+	numPages(0),
+	pageStarts(0),
+	pageIndex(0),
+	pageIndexLength(0),
+	profiled(false)
 {
 }
 
@@ -121,6 +132,167 @@ void RedFsmAp::depthFirstOrdering()
 	assert( stateListLen == stateList.length() );
 }
 
+struct CmpStateByProfile
+{
+	static int compare( const RedStateAp *st1, const RedStateAp *st2 )
+	{
+		if ( st1->profCount > st2->profCount )
+			return -1;
+		else if ( st1->profCount < st2->profCount )
+			return 1;
+		else
+			return 0;
+	}
+};
+
+/* Put the states taken most often in the profile first so the hot code is
+ * kept together. The sort is stable, states with equal counts, and all the
+ * states of an unprofiled machine, stay in depth first order. Only the order
+ * of the list changes. A profile names states by their ids, which the
+ * instrumented code writes and CodeGenData::applyProfile reads back as
+ * indicies into allStates. No style may renumber the states after make(),
+ * with sequentialStateIds for instance, or a profile written by one build
+ * would count the wrong states in the next. */
+void RedFsmAp::profileOrdering()
+{
+	depthFirstOrdering();
+
+	int pos = 0;
+	RedStateAp **ptrList = new RedStateAp*[stateList.length()];
+	for ( RedStateList::Iter st = stateList; st.lte(); st++, pos++ )
+		ptrList[pos] = st;
+
+	MergeSort<RedStateAp*, CmpStateByProfile> mergeSort;
+	mergeSort.sort( ptrList, stateList.length() );
+
+	stateList.abandon();
+	for ( int st = 0; st < pos; st++ )
+		stateList.append( ptrList[st] );
+
+	delete[] ptrList;
+}
+
+void RedFsmAp::markHot( GenInlineList *inlineList, bool &anyExprTarg )
+{
+	for ( GenInlineList::Iter item = *inlineList; item.lte(); item++ ) {
+		switch ( item->type ) {
+		case GenInlineItem::Goto: case GenInlineItem::Call:
+		case GenInlineItem::Next:
+			markHot( item->targState, anyExprTarg );
+			break;
+		case GenInlineItem::GotoExpr: case GenInlineItem::CallExpr:
+		case GenInlineItem::NextExpr:
+			anyExprTarg = true;
+			break;
+		default:
+			break;
+		}
+
+		if ( item->children != 0 )
+			markHot( item->children, anyExprTarg );
+	}
+}
+
+void RedFsmAp::markHot( RedAction *action, bool &anyExprTarg )
+{
+	if ( action != 0 ) {
+		for ( GenActionTable::Iter item = action->key; item.lte(); item++ )
+			markHot( item->value->inlineList, anyExprTarg );
+	}
+}
+
+void RedFsmAp::markHot( RedTransAp *trans, bool &anyExprTarg )
+{
+	for ( RedCondList::Iter c = trans->outConds; c.lte(); c++ ) {
+		if ( c->value->targ != 0 && c->value->targ != errState ) {
+			markHot( c->value->action, anyExprTarg );
+			markHot( c->value->targ, anyExprTarg );
+		}
+	}
+}
+
+/* Clear the cold flag of the states reachable from state by transitions and
+ * by the jumps in their actions. The default and eof transitions count as
+ * well, since the defaults have been taken out of the ranges by now.
+ * Transitions to the error state don't count, so states reached only from
+ * error actions stay cold. */
+void RedFsmAp::markHot( RedStateAp *state, bool &anyExprTarg )
+{
+	if ( !state->cold || state == errState )
+		return;
+
+	state->cold = false;
+
+	markHot( state->toStateAction, anyExprTarg );
+	markHot( state->fromStateAction, anyExprTarg );
+
+	for ( RedTransList::Iter stel = state->outSingle; stel.lte(); stel++ )
+		markHot( stel->value, anyExprTarg );
+
+	for ( RedTransList::Iter rtel = state->outRange; rtel.lte(); rtel++ )
+		markHot( rtel->value, anyExprTarg );
+
+	if ( state->defTrans != 0 )
+		markHot( state->defTrans, anyExprTarg );
+
+	if ( state->eofTrans != 0 )
+		markHot( state->eofTrans, anyExprTarg );
+}
+
+/* With a profile the cold states are those never left. Otherwise they are
+ * the states that can't be reached from the start state without going
+ * through an error, such as error recovery machines entered with fgoto from
+ * error actions. The error state is always cold. */
+void RedFsmAp::findColdStates()
+{
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ )
+		st->cold = profiled ? st->profCount == 0 : true;
+
+	if ( profiled || startState == 0 )
+		return;
+
+	bool anyExprTarg = false;
+	markHot( startState, anyExprTarg );
+
+	/* A computed jump could enter at any entry point. */
+	if ( anyExprTarg ) {
+		for ( RedStateSet::Iter en = entryPoints; en.lte(); en++ )
+			markHot( *en, anyExprTarg );
+	}
+
+	if ( errState != 0 )
+		errState->cold = true;
+}
+
+/* Move the cold states to the end of the list, keeping the order within the
+ * hot and within the cold states. */
+void RedFsmAp::coldOrdering()
+{
+	RedStateList coldList;
+	RedStateAp *st = stateList.head;
+	while ( st != 0 ) {
+		RedStateAp *next = st->next;
+		if ( st->cold ) {
+			stateList.detach( st );
+			coldList.append( st );
+		}
+		st = next;
+	}
+
+	stateList.append( coldList );
+}
+
+unsigned long long RedFsmAp::profWeight( RedStateAp *state, Key low, Key high )
+{
+	if ( state->profKeys == 0 )
+		return 0;
+
+	unsigned long long weight = 0;
+	for ( long key = low.getVal(); key <= high.getVal(); key++ )
+		weight += state->profKeys[key & 0xff];
+	return weight;
+}
+
 /* Assign state ids by appearance in the state list. */
 void RedFsmAp::sequentialStateIds()
 {
@@ -289,8 +461,29 @@ void RedFsmAp::chooseSingle()
 	}
 }
 
+/* Fill in the transition taken on each byte of the alphabet. The alphabet
+ * must be one byte wide and the out ranges must cover it, with the default
+ * transition taking what they don't. */
+static void byteTrans( KeyOps *keyOps, RedStateAp *state, RedTransAp **row )
+{
+	long minKey = keyOps->minKey.getVal();
+	for ( int b = 0; b < 256; b++ )
+		row[b] = state->defTrans;
+
+	for ( RedTransList::Iter rtel = state->outRange; rtel.lte(); rtel++ ) {
+		long high = rtel->highKey.getVal();
+		for ( long key = rtel->lowKey.getVal(); key <= high; key++ )
+			row[key - minKey] = rtel->value;
+	}
+}
+
 void RedFsmAp::makeFlat()
 {
+	if ( byteClass != 0 ) {
+		makeFlatClasses();
+		return;
+	}
+
 	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
 		if ( st->outRange.length() == 0 ) {
 			st->lowKey = st->highKey = 0;
@@ -320,6 +513,390 @@ void RedFsmAp::makeFlat()
 	}
 }
 
+/* Flat expand over byte classes. The keys of the states become class ids. */
+void RedFsmAp::makeFlatClasses()
+{
+	long minKey = keyOps->minKey.getVal();
+
+	/* The first byte of each class, in the order of the keys. */
+	int first[256];
+	for ( int c = 0; c < numByteClasses; c++ )
+		first[c] = -1;
+	for ( int b = 0; b < 256; b++ ) {
+		int c = byteClass[(b + minKey) & 0xff];
+		if ( first[c] < 0 )
+			first[c] = b;
+	}
+
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		RedTransAp *row[256];
+		byteTrans( keyOps, st, row );
+
+		/* Classes not taking the default make up the span. */
+		int low = -1, high = -1;
+		for ( int c = 0; c < numByteClasses; c++ ) {
+			if ( row[first[c]] != st->defTrans ) {
+				if ( low < 0 )
+					low = c;
+				high = c;
+			}
+		}
+
+		if ( low < 0 ) {
+			st->lowKey = st->highKey = 0;
+			st->transList = 0;
+		}
+		else {
+			st->lowKey = low;
+			st->highKey = high;
+			st->transList = new RedTransAp*[ high - low + 1 ];
+			for ( int c = low; c <= high; c++ )
+				st->transList[c-low] = row[first[c]];
+		}
+	}
+}
+
+/* Overlay the rows of the flat tables in one pair of next and check arrays,
+ * placing each row at the lowest offset where its entries land on free
+ * slots. Rows are placed largest first. An entry is indexed by byte class, or
+ * by the byte as an unsigned char without classes. Entries taking the default
+ * transition are left out. Must be called after makeFlat. */
+void RedFsmAp::makeComb()
+{
+	if ( keyOps->alphType->size != 1 || keyOps->alphSize() != 256 )
+		return;
+
+	int rowLength = byteClass != 0 ? numByteClasses : 256;
+
+	/* Count the entries of each state. */
+	int numStates = stateList.length();
+	RedStateAp **order = new RedStateAp*[numStates];
+	int *numEntries = new int[nextStateId];
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		numEntries[st->id] = 0;
+		if ( st->transList != 0 ) {
+			unsigned long long span = keyOps->span( st->lowKey, st->highKey );
+			for ( unsigned long long pos = 0; pos < span; pos++ ) {
+				if ( st->transList[pos] != st->defTrans )
+					numEntries[st->id] += 1;
+			}
+		}
+	}
+
+	/* Largest rows first, they are the hardest to fit. A counting sort keeps
+	 * the state order among rows of equal size. */
+	int *start = new int[rowLength+2];
+	memset( start, 0, sizeof(int) * (rowLength+2) );
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ )
+		start[rowLength - numEntries[st->id] + 1] += 1;
+	for ( int c = 1; c <= rowLength + 1; c++ )
+		start[c] += start[c-1];
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ )
+		order[start[rowLength - numEntries[st->id]]++] = st;
+	delete[] start;
+
+	Vector<RedTransAp*> next;
+	Vector<int> check;
+
+	int *entries = new int[rowLength];
+	int *positions = new int[rowLength];
+	long firstFree = 0;
+	for ( int i = 0; i < numStates; i++ ) {
+		RedStateAp *st = order[i];
+		if ( numEntries[st->id] == 0 ) {
+			st->combBase = 0;
+			continue;
+		}
+
+		/* The index of each entry and its position in the state's span. */
+		int n = 0;
+		unsigned long long span = keyOps->span( st->lowKey, st->highKey );
+		for ( unsigned long long pos = 0; pos < span; pos++ ) {
+			if ( st->transList[pos] != st->defTrans ) {
+				long key = st->lowKey.getVal() + pos;
+				entries[n] = byteClass != 0 ? key : ( key & 0xff );
+				positions[n] = pos;
+				n += 1;
+			}
+		}
+
+		/* First fit, starting where the first entry lands on the first free
+		 * slot. */
+		while ( firstFree < check.length() && check[firstFree] >= 0 )
+			firstFree += 1;
+		long base = firstFree - entries[0];
+		if ( base < 0 )
+			base = 0;
+		while ( true ) {
+			while ( check.length() < base + rowLength ) {
+				next.append( 0 );
+				check.append( -1 );
+			}
+
+			int e = 0;
+			while ( e < n && check[base + entries[e]] < 0 )
+				e += 1;
+			if ( e == n )
+				break;
+			base += 1;
+		}
+
+		st->combBase = base;
+		for ( int e = 0; e < n; e++ ) {
+			next[base + entries[e]] = st->transList[positions[e]];
+			check[base + entries[e]] = st->id;
+		}
+	}
+
+	/* Any state may index up to a full row past its base. */
+	while ( check.length() < rowLength ) {
+		next.append( 0 );
+		check.append( -1 );
+	}
+
+	combLength = check.length();
+	combNext = new RedTransAp*[combLength];
+	combCheck = new int[combLength];
+	for ( int i = 0; i < combLength; i++ ) {
+		combNext[i] = next[i];
+		combCheck[i] = check[i];
+	}
+
+	delete[] order;
+	delete[] numEntries;
+	delete[] entries;
+	delete[] positions;
+}
+
+/* Orders pages of the paged tables by their entries. */
+struct CmpPage
+{
+	static int compare( RedTransAp **const &p1, RedTransAp **const &p2 )
+	{
+		return memcmp( p1, p2, sizeof(RedTransAp*) << RedFsmAp::pageBits );
+	}
+};
+
+typedef BstMap< RedTransAp**, int, CmpPage > PageMap;
+typedef BstMapEl< RedTransAp**, int > PageMapEl;
+
+/* The id of the page with the given entries, storing it if it is new. */
+static int findPage( PageMap &pageMap, Vector<RedTransAp**> &pageList,
+		RedTransAp **page )
+{
+	PageMapEl *el = pageMap.find( page );
+	if ( el != 0 )
+		return el->value;
+
+	int pageSize = 1 << RedFsmAp::pageBits;
+	RedTransAp **copy = new RedTransAp*[pageSize];
+	memcpy( copy, page, sizeof(RedTransAp*) * pageSize );
+	pageMap.insert( copy, pageList.length() );
+	pageList.append( copy );
+	return pageList.length() - 1;
+}
+
+/* Flat expand for alphabets wider than a byte, where the span of a state can
+ * be too large to give an entry to every key. The position of a key in the
+ * alphabet is split into a page and an offset in the page. Each state gets
+ * the pages from the page of its low key to the page of its high key, keys
+ * outside of them take the default transition. Pages are shared among all
+ * states. A state keeps only the runs of equal pages in its span, and the
+ * pages that a single range or the default transition covers are skipped
+ * over a run at a time, so the work and the size of the runs are in the
+ * number of ranges rather than in the span. Must be called after defaults
+ * are chosen. */
+void RedFsmAp::makePaged()
+{
+	int pageSize = 1 << pageBits;
+	long minKey = keyOps->minKey.getVal();
+
+	PageMap pageMap;
+	Vector<RedTransAp**> pageList;
+	Vector<unsigned long long> starts;
+	Vector<int> index;
+
+	/* Pages taking one transition on every key, by the transition. */
+	typedef BstMap< RedTransAp*, int, CmpOrd<RedTransAp*> > UniformMap;
+	typedef BstMapEl< RedTransAp*, int > UniformMapEl;
+	UniformMap uniform;
+
+	RedTransAp **page = new RedTransAp*[pageSize];
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		st->transList = 0;
+		st->pageOffset = index.length();
+		st->pageRuns = 0;
+		if ( st->outRange.length() == 0 ) {
+			st->lowKey = st->highKey = 0;
+			st->pageLow = 0;
+			st->pageCount = 0;
+			continue;
+		}
+
+		st->lowKey = st->outRange[0].lowKey;
+		st->highKey = st->outRange[st->outRange.length()-1].highKey;
+
+		unsigned long long lowPage = (unsigned long long)
+				(st->lowKey.getVal() - minKey) >> pageBits;
+		unsigned long long highPage = (unsigned long long)
+				(st->highKey.getVal() - minKey) >> pageBits;
+		st->pageLow = lowPage;
+		st->pageCount = highPage - lowPage + 1;
+
+		int r = 0;
+		unsigned long long pg = lowPage;
+		while ( pg <= highPage ) {
+			unsigned long long first = pg << pageBits;
+			unsigned long long last = first + pageSize - 1;
+
+			/* Skip the ranges that end before the page. */
+			while ( (unsigned long long)(st->outRange[r].highKey.getVal() -
+					minKey) < first )
+				r += 1;
+
+			unsigned long long low = st->outRange[r].lowKey.getVal() - minKey;
+			unsigned long long high = st->outRange[r].highKey.getVal() - minKey;
+
+			/* The page, and the last page of the run of pages like it. */
+			int id;
+			unsigned long long runEnd = pg;
+			if ( low > last || ( low <= first && high >= last ) ) {
+				/* Up to the page of the next range, or to the last page the
+				 * range covers whole. */
+				RedTransAp *fill;
+				if ( low > last ) {
+					fill = st->defTrans;
+					runEnd = ( low >> pageBits ) - 1;
+				}
+				else {
+					fill = st->outRange[r].value;
+					runEnd = ( high - ( pageSize - 1 ) ) >> pageBits;
+				}
+
+				UniformMapEl *el = uniform.find( fill );
+				if ( el == 0 ) {
+					for ( int o = 0; o < pageSize; o++ )
+						page[o] = fill;
+					el = uniform.insert( fill,
+							findPage( pageMap, pageList, page ) );
+				}
+				id = el->value;
+			}
+			else {
+				/* Ranges start or end in the page. */
+				for ( int o = 0; o < pageSize; o++ )
+					page[o] = st->defTrans;
+				for ( int i = r; i < st->outRange.length(); i++ ) {
+					low = st->outRange[i].lowKey.getVal() - minKey;
+					high = st->outRange[i].highKey.getVal() - minKey;
+					if ( low > last )
+						break;
+
+					unsigned long long from = low < first ? first : low;
+					unsigned long long to = high > last ? last : high;
+					for ( unsigned long long pos = from; pos <= to; pos++ )
+						page[pos - first] = st->outRange[i].value;
+				}
+
+				id = findPage( pageMap, pageList, page );
+			}
+
+			/* Start a run unless the page is the same as the one before. */
+			if ( st->pageRuns == 0 || index[index.length()-1] != id ) {
+				starts.append( pg - lowPage );
+				index.append( id );
+				st->pageRuns += 1;
+			}
+
+			if ( runEnd >= highPage )
+				break;
+			pg = runEnd + 1;
+		}
+	}
+	delete[] page;
+
+	/* Nothing to page, the flat tables are left with defaults only. */
+	if ( pageList.length() == 0 )
+		return;
+
+	numPages = pageList.length();
+	pages = new RedTransAp*[numPages * pageSize];
+	for ( int p = 0; p < numPages; p++ ) {
+		memcpy( pages + p * pageSize, pageList[p],
+				sizeof(RedTransAp*) * pageSize );
+		delete[] pageList[p];
+	}
+
+	pageIndexLength = index.length();
+	pageStarts = new unsigned long long[pageIndexLength];
+	pageIndex = new int[pageIndexLength];
+	for ( int i = 0; i < pageIndexLength; i++ ) {
+		pageStarts[i] = starts[i];
+		pageIndex[i] = index[i];
+	}
+}
+
+/* Find the coarsest partition of the bytes such that every state takes the
+ * same transition on all bytes of a class. Tables can then be indexed by
+ * class instead of by byte. Starting from a single class, each state splits
+ * the classes by the transitions it takes. Class ids are given in the order
+ * that the classes first appear in the alphabet, so ranges of keys stay
+ * close together. Must be called after defaults are chosen. */
+void RedFsmAp::makeByteClasses()
+{
+	if ( keyOps->alphType->size != 1 || keyOps->alphSize() != 256 )
+		return;
+
+	/* Indexed by the position of the key in the alphabet. */
+	int cls[256], next[256];
+	memset( cls, 0, sizeof(cls) );
+	int numClasses = 1;
+
+	/* For each old class, the list of the new classes it splits into, one per
+	 * transition taken on the bytes of the old class. */
+	int head[256];
+	RedTransAp *splitTrans[256];
+	int splitNext[256];
+
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		RedTransAp *row[256];
+		byteTrans( keyOps, st, row );
+
+		for ( int c = 0; c < numClasses; c++ )
+			head[c] = -1;
+
+		int numSplits = 0;
+		for ( int b = 0; b < 256; b++ ) {
+			int s = head[cls[b]];
+			while ( s >= 0 && splitTrans[s] != row[b] )
+				s = splitNext[s];
+
+			if ( s < 0 ) {
+				/* New classes are numbered in order of appearance. */
+				s = numSplits++;
+				splitTrans[s] = row[b];
+				splitNext[s] = head[cls[b]];
+				head[cls[b]] = s;
+			}
+
+			next[b] = s;
+		}
+
+		memcpy( cls, next, sizeof(cls) );
+		numClasses = numSplits;
+
+		/* Every byte distinguished. */
+		if ( numClasses == 256 )
+			break;
+	}
+
+	long minKey = keyOps->minKey.getVal();
+	byteClass = new int[256];
+	for ( int b = 0; b < 256; b++ )
+		byteClass[(b + minKey) & 0xff] = cls[b];
+	numByteClasses = numClasses;
+}
+
 
 /* A default transition has been picked, move it from the outRange to the
  * default pointer. */
@@ -341,6 +918,174 @@ void RedFsmAp::moveToDefault( RedTransAp *defTrans, RedStateAp *state )
 	state->defTrans = defTrans;
 }
 
+/* Find the states that loop on themselves without actions on most of the
+ * alphabet and are left on only a few ranges of bytes. The generated code can
+ * scan over the input in these states instead of taking the self transition
+ * once for every byte. Must be called while the out ranges still cover the
+ * alphabet. */
+void RedFsmAp::findSkipStates()
+{
+	if ( keyOps->alphType->size != 1 )
+		return;
+
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		/* Actions on entering or leaving the state are executed for every
+		 * byte, so they need the transitions. */
+		if ( st == errState || st->toStateAction != 0 || st->fromStateAction != 0 )
+			continue;
+
+		/* Mark the bytes of the self transitions. */
+		bool self[256];
+		memset( self, 0, sizeof(self) );
+		int numSelf = 0;
+		for ( RedTransList::Iter rtel = st->outRange; rtel.lte(); rtel++ ) {
+			RedTransAp *trans = rtel->value;
+			if ( trans->condSpace == 0 && trans->outConds.length() == 1 &&
+					trans->outConds[0].value->targ == st &&
+					trans->outConds[0].value->action == 0 )
+			{
+				long high = rtel->highKey.getVal();
+				for ( long key = rtel->lowKey.getVal(); key <= high; key++ ) {
+					self[key & 0xff] = true;
+					numSelf += 1;
+				}
+			}
+		}
+
+		if ( numSelf < 128 )
+			continue;
+
+		/* The rest of the bytes leave the state. */
+		SkipRangeList exits;
+		for ( int b = 0; b < 256; b++ ) {
+			if ( !self[b] ) {
+				if ( exits.length() > 0 && exits[exits.length()-1].high == b - 1 )
+					exits[exits.length()-1].high = b;
+				else {
+					SkipRange range = { b, b };
+					exits.append( range );
+				}
+			}
+		}
+
+		if ( exits.length() <= MAX_SKIP_RANGES ) {
+			st->skip = true;
+			st->skipExits = exits;
+		}
+	}
+}
+
+/* If the state has one transition that doesn't go to the error state, on a
+ * single key, without conditions or actions, returns it and sets key. */
+RedCondAp *RedFsmAp::singleKeyCond( RedStateAp *state, Key &key )
+{
+	if ( state == errState )
+		return 0;
+
+	RedCondAp *single = 0;
+	for ( RedTransList::Iter rtel = state->outRange; rtel.lte(); rtel++ ) {
+		RedTransAp *trans = rtel->value;
+		if ( trans->outConds.length() == 1 &&
+				trans->outConds[0].value->targ == errState )
+			continue;
+
+		if ( single != 0 || trans->condSpace != 0 || trans->outConds.length() != 1 ||
+				trans->outConds[0].value->action != 0 ||
+				!keyOps->eq( rtel->lowKey, rtel->highKey ) )
+			return 0;
+
+		single = trans->outConds[0].value;
+		key = rtel->lowKey;
+	}
+	return single;
+}
+
+/* Looks in the singles, the ranges, then the default. Keys that none of them
+ * take go to the error state, which stays there. */
+RedStateAp *RedFsmAp::keyTarg( RedStateAp *state, Key key )
+{
+	RedTransAp *trans = state->defTrans;
+	for ( RedTransList::Iter rtel = state->outSingle; rtel.lte(); rtel++ ) {
+		if ( keyOps->eq( rtel->lowKey, key ) )
+			trans = rtel->value;
+	}
+	for ( RedTransList::Iter rtel = state->outRange; rtel.lte(); rtel++ ) {
+		if ( keyOps->le( rtel->lowKey, key ) && keyOps->le( key, rtel->highKey ) )
+			trans = rtel->value;
+	}
+
+	if ( trans == 0 || trans->outConds[0].value->targ == 0 )
+		return errState != 0 ? errState : state;
+	return trans->outConds[0].value->targ;
+}
+
+/* A run goes through states that have a single way in, from the previous
+ * state of the run, and no actions on entering or leaving, so passing
+ * through them at once skips nothing. The state landed in is entered as
+ * usual, running its to state actions. */
+void RedFsmAp::findLiteralRuns()
+{
+	if ( keyOps->alphType->size != 1 )
+		return;
+
+	/* Count the ways into each state, the jumps from actions included. */
+	int *inDegree = new int[nextStateId];
+	memset( inDegree, 0, sizeof(int) * nextStateId );
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		for ( RedTransList::Iter rtel = st->outRange; rtel.lte(); rtel++ ) {
+			for ( RedCondList::Iter c = rtel->value->outConds; c.lte(); c++ ) {
+				if ( c->value->targ != 0 )
+					inDegree[c->value->targ->id] += 1;
+			}
+		}
+	}
+	if ( startState != 0 )
+		inDegree[startState->id] += 1;
+	for ( RedStateSet::Iter en = entryPoints; en.lte(); en++ )
+		inDegree[(*en)->id] += 1;
+
+	/* A member of a run is passed through from the state before it. */
+	bool *member = new bool[nextStateId];
+	memset( member, 0, sizeof(bool) * nextStateId );
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		Key key;
+		RedCondAp *single = singleKeyCond( st, key );
+		if ( single != 0 && single->targ != st && inDegree[single->targ->id] == 1 &&
+				single->targ->toStateAction == 0 && single->targ->fromStateAction == 0 )
+			member[single->targ->id] = true;
+	}
+
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		if ( member[st->id] || st->skip )
+			continue;
+
+		/* Find the length of the run, then copy out its keys. */
+		int length = 0;
+		RedStateAp *cur = st;
+		Key key;
+		RedCondAp *single = singleKeyCond( cur, key );
+		while ( single != 0 ) {
+			length += 1;
+			cur = single->targ;
+			if ( !member[cur->id] || cur == st )
+				break;
+			single = singleKeyCond( cur, key );
+		}
+
+		if ( length >= 2 ) {
+			st->runLength = length;
+			st->runKeys = new Key[length];
+			RedStateAp *in = st;
+			for ( int k = 0; k < length; k++ )
+				in = singleKeyCond( in, st->runKeys[k] )->targ;
+			st->runTarg = cur;
+		}
+	}
+
+	delete[] inDegree;
+	delete[] member;
+}
+
 bool RedFsmAp::alphabetCovered( RedTransList &outRange )
 {
 	/* Cannot cover without any out ranges. */
@@ -402,6 +1147,58 @@ RedTransAp *RedFsmAp::chooseDefaultSpan( RedStateAp *state )
 	return maxTrans;
 }
 
+/* In the goto and binary search styles the default transition is reached
+ * only after the search for the others fails, so it should be one that is
+ * rarely taken. Picks the transition taken least often in the profile,
+ * preferring the larger span among equals. */
+RedTransAp *RedFsmAp::chooseDefaultProfile( RedStateAp *state )
+{
+	/* Make a set of transitions from the outRange. */
+	RedTransSet stateTransSet;
+	for ( RedTransList::Iter rtel = state->outRange; rtel.lte(); rtel++ )
+		stateTransSet.insert( rtel->value );
+
+	unsigned long long *span = new unsigned long long[stateTransSet.length()];
+	unsigned long long *taken = new unsigned long long[stateTransSet.length()];
+	memset( span, 0, sizeof(unsigned long long) * stateTransSet.length() );
+	memset( taken, 0, sizeof(unsigned long long) * stateTransSet.length() );
+	for ( RedTransList::Iter rtel = state->outRange; rtel.lte(); rtel++ ) {
+		RedTransAp **inSet = stateTransSet.find( rtel->value );
+		int pos = inSet - stateTransSet.data;
+		span[pos] += keyOps->span( rtel->lowKey, rtel->highKey );
+		taken[pos] += profWeight( state, rtel->lowKey, rtel->highKey );
+	}
+
+	RedTransAp *minTrans = 0;
+	int minPos = 0;
+	for ( RedTransSet::Iter rtel = stateTransSet; rtel.lte(); rtel++ ) {
+		int pos = rtel.pos();
+		if ( minTrans == 0 || taken[pos] < taken[minPos] ||
+				( taken[pos] == taken[minPos] && span[pos] > span[minPos] ) )
+		{
+			minTrans = *rtel;
+			minPos = pos;
+		}
+	}
+
+	delete[] span;
+	delete[] taken;
+	return minTrans;
+}
+
+/* Pick default transitions by the profile where the state has key counts
+ * and by span elsewhere. */
+void RedFsmAp::chooseDefaultProfile()
+{
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		if ( alphabetCovered( st->outRange ) ) {
+			RedTransAp *defTrans = st->profKeys != 0 ?
+					chooseDefaultProfile( st ) : chooseDefaultSpan( st );
+			moveToDefault( defTrans, st );
+		}
+	}
+}
+
 /* Pick default transitions from ranges for the states. */
 void RedFsmAp::chooseDefaultSpan()
 {
@@ -393,6 +393,17 @@ struct GenStateCond
 typedef DList<GenStateCond> GenStateCondList;
 typedef Vector<GenStateCond*> StateCondVect;
 
+/* A range of byte values on which a state with a skip loop is left. */
+struct SkipRange
+{
+	int low, high;
+};
+
+typedef Vector<SkipRange> SkipRangeList;
+
+/* Most exit ranges a skip loop tests for. */
+#define MAX_SKIP_RANGES 4
+
 /* Reduced state. */
 struct RedStateAp
 {
@@ -412,7 +423,19 @@ struct RedStateAp
 		bAnyRegCurStateRef(false),
 		partitionBoundary(false),
 		inConds(0),
-		numInConds(0)
+		numInConds(0),
+		skip(false),
+		combBase(0),
+		pageLow(0),
+		pageCount(0),
+		pageOffset(0),
+		pageRuns(0),
+		profCount(0),
+		profKeys(0),
+		cold(false),
+		runLength(0),
+		runKeys(0),
+		runTarg(0)
 	{ }
 
 	/* Transitions out. */
@@ -448,6 +471,37 @@ struct RedStateAp
 
 	RedCondAp **inConds;
 	int numInConds;
+
+	/* The state loops on itself with no actions for all bytes but those in
+	 * skipExits. Input can be scanned over without taking transitions. */
+	bool skip;
+	SkipRangeList skipExits;
+
+	/* Offset of the row of the state in the comb tables. */
+	int combBase;
+
+	/* The pages of the state's span in the paged tables: the page of its low
+	 * key, the number of pages up to the page of its high key, and the offset
+	 * and number of its runs of equal pages in the page runs. */
+	unsigned long long pageLow;
+	unsigned long long pageCount;
+	int pageOffset;
+	int pageRuns;
+
+	/* Times the state was left in the profile, and times each byte was
+	 * taken, indexed by the byte as an unsigned char. */
+	unsigned long long profCount;
+	unsigned long long *profKeys;
+
+	/* Rarely or never entered. Kept out of the way of the hot code. */
+	bool cold;
+
+	/* A chain of states with one transition each, on a single key and
+	 * without actions, starts here. The keys can be compared at once,
+	 * landing in runTarg. */
+	int runLength;
+	Key *runKeys;
+	RedStateAp *runTarg;
 };
 
 /* List of states. */
@@ -501,6 +555,31 @@ struct RedFsmAp
 	bool bAnyRegBreak;
 	bool bUsingAct;
 
+	/* Byte equivalence classes. Maps a byte, as an unsigned char, to its
+	 * class. Zero when the tables are built over the alphabet. */
+	int *byteClass;
+	int numByteClasses;
+
+	/* Comb tables. The rows of the flat tables overlaid in one array, the
+	 * owner of each slot in combCheck, -1 for a free slot. */
+	RedTransAp **combNext;
+	int *combCheck;
+	int combLength;
+
+	/* Paged tables. The flat rows of wide alphabets cut into pages of
+	 * 1 << pageBits keys, each distinct page stored once. The span of each
+	 * state is a list of runs of equal pages, giving the first page of each
+	 * run, relative to the state's low page, and the page the run takes. */
+	static const int pageBits = 8;
+	RedTransAp **pages;
+	int numPages;
+	unsigned long long *pageStarts;
+	int *pageIndex;
+	int pageIndexLength;
+
+	/* Any counts from --profile-use. */
+	bool profiled;
+
 	int maxState;
 	int maxSingleLen;
 	int maxRangeLen;
@@ -542,6 +621,16 @@ struct RedFsmAp
 	void chooseSingle();
 
 	void makeFlat();
+	void makeFlatClasses();
+
+	/* Pack the rows of the flat tables into comb tables. */
+	void makeComb();
+
+	/* Flat expand in shared pages, for alphabets wider than a byte. */
+	void makePaged();
+
+	/* Partition the bytes into classes that no state distinguishes. */
+	void makeByteClasses();
 
 	/* Move a selected transition from ranges to default. */
 	void moveToDefault( RedTransAp *defTrans, RedStateAp *state );
@@ -550,6 +639,10 @@ struct RedFsmAp
 	RedTransAp *chooseDefaultSpan( RedStateAp *state );
 	void chooseDefaultSpan();
 
+	/* Pick a default transition that is rarely taken in the profile. */
+	RedTransAp *chooseDefaultProfile( RedStateAp *state );
+	void chooseDefaultProfile();
+
 	/* Pick a default transition by most number of ranges. */
 	RedTransAp *chooseDefaultNumRanges( RedStateAp *state );
 	void chooseDefaultNumRanges();
@@ -558,6 +651,16 @@ struct RedFsmAp
 	RedTransAp *chooseDefaultGoto( RedStateAp *state );
 	void chooseDefaultGoto();
 
+	/* Find the states that can scan over input with a skip loop. */
+	void findSkipStates();
+
+	/* Find the chains of states that match a literal string. */
+	RedCondAp *singleKeyCond( RedStateAp *state, Key &key );
+	void findLiteralRuns();
+
+	/* The state gone to on a key, for machines without conditions. */
+	RedStateAp *keyTarg( RedStateAp *state, Key key );
+
 	/* Ordering states by transition connections. */
 	void optimizeStateOrdering( RedStateAp *state );
 	void optimizeStateOrdering();
@@ -566,6 +669,20 @@ struct RedFsmAp
 	void depthFirstOrdering( RedStateAp *state );
 	void depthFirstOrdering();
 
+	/* Most taken states first in the profile, then depth first. */
+	void profileOrdering();
+
+	/* Finding the rarely entered states and moving them to the end. */
+	void markHot( RedStateAp *state, bool &anyExprTarg );
+	void markHot( RedTransAp *trans, bool &anyExprTarg );
+	void markHot( GenInlineList *inlineList, bool &anyExprTarg );
+	void markHot( RedAction *action, bool &anyExprTarg );
+	void findColdStates();
+	void coldOrdering();
+
+	/* Times the keys from low to high were taken in the profile. */
+	unsigned long long profWeight( RedStateAp *state, Key low, Key high );
+
 	/* Set state ids. */
 	void sequentialStateIds();
 	void sortStateIdsByFinal();
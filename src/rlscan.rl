@@ -166,7 +166,15 @@ void Scanner::directToParser( Parser *toParser, const char *tokFileName, int tok
 	loc.line = tokLine;
 	loc.col = tokColumn;
 
-	toParser->token( loc, type, tokdata, toklen );
+	if ( printTimings ) {
+		/* Parsing is driven by the scanner. Keep the time apart. */
+		TimeStamp start = TimeStamp::now();
+		toParser->token( loc, type, tokdata, toklen );
+		id.parseTime.addSince( start );
+	}
+	else {
+		toParser->token( loc, type, tokdata, toklen );
+	}
 }
 
 void Scanner::importToken( int token, char *start, char *end )
@@ -528,7 +536,14 @@ void Scanner::endSection( )
 		loc.line = line;
 		loc.col = column;
 
+		TimeStamp start;
+		if ( printTimings )
+			start = TimeStamp::now();
+
 		parser->token( loc, TK_EndSection, 0, 0 );
+
+		if ( printTimings )
+			id.parseTime.addSince( start );
 	}
 
 	if ( includeDepth == 0 ) {
@@ -1193,6 +1208,10 @@ void Scanner::do_scan()
 	init();
 	%% write init;
 
+	/* Included files are named in line directives. */
+	if ( cacheDir != 0 )
+		id.hashCacheInput( fileName, strlen(fileName) + 1 );
+
 	/* Set up the start state. FIXME: After 5.20 is released the nocs write
 	 * init option should be used, the main machine eliminated and this statement moved
 	 * above the write init. */
@@ -1229,6 +1248,9 @@ void Scanner::do_scan()
 		int len = input.gcount();
 		char *pe = p + len;
 
+		if ( cacheDir != 0 )
+			id.hashCacheInput( p, len );
+
 		/* If we see eof then append the eof var. */
 		char *eof = 0;
 	 	if ( len == 0 ) {
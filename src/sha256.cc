@@ -0,0 +1,130 @@
+/*
+ *  Copyright 2026 agent <agent@local>
+ */
+
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "sha256.h"
+#include <string.h>
+
+static const unsigned int roundConsts[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+	0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+	0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+	0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+	0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+	0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline unsigned int rotr( unsigned int x, int n )
+{
+	return ( x >> n ) | ( x << ( 32 - n ) );
+}
+
+Sha256::Sha256()
+:
+	length(0),
+	blockLen(0)
+{
+	state[0] = 0x6a09e667; state[1] = 0xbb67ae85;
+	state[2] = 0x3c6ef372; state[3] = 0xa54ff53a;
+	state[4] = 0x510e527f; state[5] = 0x9b05688c;
+	state[6] = 0x1f83d9ab; state[7] = 0x5be0cd19;
+}
+
+void Sha256::transform( const unsigned char *data )
+{
+	unsigned int w[64];
+	for ( int i = 0; i < 16; i++ ) {
+		w[i] = ( (unsigned int)data[i*4] << 24 ) | ( (unsigned int)data[i*4+1] << 16 ) |
+				( (unsigned int)data[i*4+2] << 8 ) | (unsigned int)data[i*4+3];
+	}
+	for ( int i = 16; i < 64; i++ ) {
+		unsigned int s0 = rotr( w[i-15], 7 ) ^ rotr( w[i-15], 18 ) ^ ( w[i-15] >> 3 );
+		unsigned int s1 = rotr( w[i-2], 17 ) ^ rotr( w[i-2], 19 ) ^ ( w[i-2] >> 10 );
+		w[i] = w[i-16] + s0 + w[i-7] + s1;
+	}
+
+	unsigned int a = state[0], b = state[1], c = state[2], d = state[3];
+	unsigned int e = state[4], f = state[5], g = state[6], h = state[7];
+	for ( int i = 0; i < 64; i++ ) {
+		unsigned int s1 = rotr( e, 6 ) ^ rotr( e, 11 ) ^ rotr( e, 25 );
+		unsigned int ch = ( e & f ) ^ ( ~e & g );
+		unsigned int t1 = h + s1 + ch + roundConsts[i] + w[i];
+		unsigned int s0 = rotr( a, 2 ) ^ rotr( a, 13 ) ^ rotr( a, 22 );
+		unsigned int maj = ( a & b ) ^ ( a & c ) ^ ( b & c );
+		unsigned int t2 = s0 + maj;
+
+		h = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+
+	state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+	state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void Sha256::update( const void *data, long len )
+{
+	const unsigned char *p = (const unsigned char*)data;
+	length += len;
+	while ( len > 0 ) {
+		int take = 64 - blockLen;
+		if ( take > len )
+			take = len;
+		memcpy( block + blockLen, p, take );
+		blockLen += take;
+		p += take;
+		len -= take;
+
+		if ( blockLen == 64 ) {
+			transform( block );
+			blockLen = 0;
+		}
+	}
+}
+
+/* Pad a copy of the state with the length in bits and print the digest. */
+std::string Sha256::hexDigest() const
+{
+	Sha256 final = *this;
+
+	unsigned long long bits = length * 8;
+	unsigned char pad = 0x80;
+	final.update( &pad, 1 );
+	pad = 0;
+	while ( final.blockLen != 56 )
+		final.update( &pad, 1 );
+
+	unsigned char lenBytes[8];
+	for ( int i = 0; i < 8; i++ )
+		lenBytes[i] = (unsigned char)( bits >> ( 56 - i * 8 ) );
+	final.update( lenBytes, 8 );
+
+	static const char hex[] = "0123456789abcdef";
+	std::string digest;
+	for ( int i = 0; i < 8; i++ ) {
+		for ( int shift = 28; shift >= 0; shift -= 4 )
+			digest += hex[( final.state[i] >> shift ) & 0xf];
+	}
+	return digest;
+}
@@ -0,0 +1,46 @@
+/*
+ *  Copyright 2026 agent <agent@local>
+ */
+
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _SHA256_H
+#define _SHA256_H
+
+#include <string>
+
+/* SHA-256 message digest (FIPS 180-4). Data is added with update, the digest
+ * is taken with hexDigest, which leaves the state alone so more data can be
+ * added after. */
+struct Sha256
+{
+	Sha256();
+
+	void update( const void *data, long len );
+	std::string hexDigest() const;
+
+private:
+	void transform( const unsigned char *block );
+
+	unsigned int state[8];
+	unsigned long long length;
+	unsigned char block[64];
+	int blockLen;
+};
+
+#endif
@@ -0,0 +1,257 @@
+/*
+ *  Copyright 2026 agent <agent@local>
+ */
+
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+#include "timings.h"
+#include "fsmgraph.h"
+
+using std::ostream;
+
+TimeStamp TimeStamp::now()
+{
+	TimeStamp stamp;
+
+#ifdef _WIN32
+	stamp.wall = GetTickCount() / 1000.0;
+	stamp.cpu = (double)clock() / CLOCKS_PER_SEC;
+#else
+	timeval tv;
+	gettimeofday( &tv, 0 );
+	stamp.wall = tv.tv_sec + tv.tv_usec / 1000000.0;
+
+	/* Machines are built on several threads with --jobs, so the cpu time of
+	 * a phase needs to be that of the thread it ran on. */
+#ifdef CLOCK_THREAD_CPUTIME_ID
+	timespec ts;
+	clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts );
+	stamp.cpu = ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#else
+	stamp.cpu = (double)clock() / CLOCKS_PER_SEC;
+#endif
+#endif
+
+	return stamp;
+}
+
+void TimeStamp::addSince( const TimeStamp &start )
+{
+	TimeStamp end = now();
+	wall += end.wall - start.wall;
+	cpu += end.cpu - start.cpu;
+}
+
+void TimeStamp::subtract( const TimeStamp &part )
+{
+	wall = wall > part.wall ? wall - part.wall : 0;
+	cpu = cpu > part.cpu ? cpu - part.cpu : 0;
+}
+
+double processCpu()
+{
+#ifdef _WIN32
+	return (double)clock() / CLOCKS_PER_SEC;
+#else
+	rusage usage;
+	if ( getrusage( RUSAGE_SELF, &usage ) != 0 )
+		return 0;
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 +
+			usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+#endif
+}
+
+long peakRss()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if ( !GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof(counters) ) )
+		return -1;
+	return counters.PeakWorkingSetSize;
+#else
+	rusage usage;
+	if ( getrusage( RUSAGE_SELF, &usage ) != 0 )
+		return -1;
+#ifdef __APPLE__
+	return usage.ru_maxrss;
+#else
+	return usage.ru_maxrss * 1024L;
+#endif
+#endif
+}
+
+PhaseTiming &Timings::addPhase( const char *phase, const char *machine,
+		const TimeStamp &start )
+{
+	TimeStamp time;
+	time.addSince( start );
+	return addPhaseTime( phase, machine, time );
+}
+
+PhaseTiming &Timings::addPhaseTime( const char *phase, const char *machine,
+		const TimeStamp &time )
+{
+	PhaseTiming phaseTiming;
+	phaseTiming.phase = phase;
+	phaseTiming.kind = 0;
+	phaseTiming.machine = machine;
+	phaseTiming.instance = 0;
+	phaseTiming.time = time;
+	phaseTiming.peakRss = peakRss();
+	phaseTiming.count = -1;
+	phaseTiming.states = -1;
+	phaseTiming.trans = -1;
+
+	phases.append( phaseTiming );
+	return phases[phases.length()-1];
+}
+
+void Timings::setCounts( PhaseTiming &phaseTiming, FsmAp *graph )
+{
+	phaseTiming.states = graph->stateList.length();
+	phaseTiming.trans = 0;
+	for ( StateList::Iter st = graph->stateList; st.lte(); st++ )
+		phaseTiming.trans += st->outList.length();
+}
+
+/* Write a string as a JSON string literal. */
+static void writeString( ostream &out, const char *str )
+{
+	out << '"';
+	for ( const char *p = str; *p != 0; p++ ) {
+		switch ( *p ) {
+			case '"': out << "\\\""; break;
+			case '\\': out << "\\\\"; break;
+			case '\n': out << "\\n"; break;
+			case '\t': out << "\\t"; break;
+			default:
+				if ( (unsigned char)*p < 0x20 ) {
+					char buf[8];
+					sprintf( buf, "\\u%04x", (unsigned char)*p );
+					out << buf;
+				}
+				else {
+					out << *p;
+				}
+		}
+	}
+	out << '"';
+}
+
+static void writeTime( ostream &out, const TimeStamp &time )
+{
+	char buf[64];
+	sprintf( buf, "\"wall_s\": %.6f, \"cpu_s\": %.6f", time.wall, time.cpu );
+	out << buf;
+}
+
+/* The schema is versioned. Fields are only ever added to it; a change to the
+ * meaning of a field bumps the version. The peak RSS of a phase is the
+ * high-water mark of the process when the phase ended. No time is counted in
+ * two phases: the walk of an instance leaves out the minimizations after
+ * operations, which are its after-op minimize record. The operators listed
+ * are not phases, their time is part of the walk. */
+void writeTimingsJSON( ostream &out, const char *inputFileName,
+		bool cacheHit, const TimeStamp &total,
+		const Vector<Timings*> &timingsList )
+{
+	out << "{\n";
+	out << "  \"schema\": \"ragel-timings\",\n";
+	out << "  \"version\": 1,\n";
+	out << "  \"input\": ";
+	writeString( out, inputFileName );
+	out << ",\n";
+	out << "  \"cache_hit\": " << ( cacheHit ? "true" : "false" ) << ",\n";
+	out << "  \"total\": { ";
+	writeTime( out, total );
+	out << ", \"peak_rss_bytes\": " << peakRss() << " },\n";
+
+	out << "  \"phases\": [";
+	bool first = true;
+	for ( int t = 0; t < timingsList.length(); t++ ) {
+		Vector<PhaseTiming> &phases = timingsList[t]->phases;
+		for ( int p = 0; p < phases.length(); p++ ) {
+			PhaseTiming &pt = phases[p];
+			out << ( first ? "\n" : ",\n" ) << "    { \"phase\": ";
+			writeString( out, pt.phase );
+			if ( pt.kind != 0 ) {
+				out << ", \"kind\": ";
+				writeString( out, pt.kind );
+			}
+			if ( pt.machine != 0 ) {
+				out << ", \"machine\": ";
+				writeString( out, pt.machine );
+			}
+			if ( pt.instance != 0 ) {
+				out << ", \"instance\": ";
+				writeString( out, pt.instance );
+			}
+			out << ", ";
+			writeTime( out, pt.time );
+			out << ", \"peak_rss_bytes\": " << pt.peakRss;
+			if ( pt.count >= 0 )
+				out << ", \"count\": " << pt.count;
+			if ( pt.states >= 0 )
+				out << ", \"states\": " << pt.states;
+			if ( pt.trans >= 0 )
+				out << ", \"transitions\": " << pt.trans;
+			out << " }";
+			first = false;
+		}
+	}
+	out << ( first ? "],\n" : "\n  ],\n" );
+
+	out << "  \"operators\": [";
+	first = true;
+	for ( int t = 0; t < timingsList.length(); t++ ) {
+		Vector<OpTiming> &ops = timingsList[t]->ops;
+		for ( int o = 0; o < ops.length(); o++ ) {
+			OpTiming &ot = ops[o];
+			out << ( first ? "\n" : ",\n" ) << "    { \"op\": ";
+			writeString( out, ot.op );
+			out << ", \"machine\": ";
+			writeString( out, ot.machine );
+			out << ", \"file\": ";
+			writeString( out, ot.loc.fileName != 0 ? ot.loc.fileName : "" );
+			out << ", \"line\": " << ot.loc.line << ", \"column\": " << ot.loc.col;
+			out << ", ";
+			writeTime( out, ot.time );
+			out << ", \"operand_states\": [";
+			if ( ot.lhsStates >= 0 ) {
+				out << ot.lhsStates;
+				if ( ot.rhsStates >= 0 )
+					out << ", " << ot.rhsStates;
+			}
+			out << "], \"states\": " << ot.states << " }";
+			first = false;
+		}
+	}
+	out << ( first ? "]\n" : "\n  ]\n" );
+	out << "}\n";
+}
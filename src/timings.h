@@ -0,0 +1,104 @@
+/*
+ *  Copyright 2026 agent <agent@local>
+ */
+
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _TIMINGS_H
+#define _TIMINGS_H
+
+#include <iostream>
+#include "vector.h"
+#include "common.h"
+
+struct FsmAp;
+
+/* A reading of the wall clock and of the cpu time used by the calling
+ * thread, in seconds. Also used to hold a difference of two readings. */
+struct TimeStamp
+{
+	TimeStamp() : wall(0), cpu(0) {}
+
+	static TimeStamp now();
+
+	/* Add the time elapsed since start. */
+	void addSince( const TimeStamp &start );
+
+	/* Take out a time spent within this one, stopping at zero. */
+	void subtract( const TimeStamp &part );
+
+	double wall;
+	double cpu;
+};
+
+/* Cpu time used by all threads of the process, in seconds. */
+double processCpu();
+
+/* Peak resident set size of the process in bytes. */
+long peakRss();
+
+/* A phase of the compilation. Counts that don't apply to the phase are -1. */
+struct PhaseTiming
+{
+	const char *phase;
+	const char *kind;
+	const char *machine;
+	const char *instance;
+	TimeStamp time;
+	long peakRss;
+	long count;
+	long states;
+	long trans;
+};
+
+/* An fsm operation that took longer than the threshold. */
+struct OpTiming
+{
+	const char *op;
+	const char *machine;
+	InputLoc loc;
+	TimeStamp time;
+	long lhsStates;
+	long rhsStates;
+	long states;
+};
+
+/* The timings collected by one thread of work. */
+struct Timings
+{
+	/* Record a phase that started at start. The returned record can be filled
+	 * in further. */
+	PhaseTiming &addPhase( const char *phase, const char *machine,
+			const TimeStamp &start );
+
+	/* Record a phase from an accumulated time. */
+	PhaseTiming &addPhaseTime( const char *phase, const char *machine,
+			const TimeStamp &time );
+
+	/* Set the state and transition counts of a phase from a graph. */
+	void setCounts( PhaseTiming &phaseTiming, FsmAp *graph );
+
+	Vector<PhaseTiming> phases;
+	Vector<OpTiming> ops;
+};
+
+void writeTimingsJSON( std::ostream &out, const char *inputFileName,
+		bool cacheHit, const TimeStamp &total,
+		const Vector<Timings*> &timingsList );
+
+#endif
@@ -0,0 +1,125 @@
+#!/bin/bash
+
+#
+#   Copyright 2026 agent <agent@local>
+#
+
+#   This file is part of Ragel.
+#
+#   Ragel is free software; you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation; either version 2 of the License, or
+#   (at your option) any later version.
+#
+#   Ragel is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with Ragel; if not, write to the Free Software
+#   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
+
+# Tests of --cache-dir. A miss stores the output and the diagnostics, a hit
+# gives back both, and a change to the input, the options or the ragel
+# executable is a miss.
+
+work=cachetests.tmp
+rm -rf $work
+mkdir -p $work/cache
+
+# Run a copy of ragel, so its modification time can be changed.
+cp ../src/ragel $work/ragel || exit 1
+ragel=$work/ragel
+
+cat > $work/cache.rl <<'END'
+%%{
+	machine cache;
+	main := ( 'a' | 'b' )* 'c';
+}%%
+%% write data nooption;
+%% write init;
+%% write exec;
+END
+
+# Run ragel on the input with the cache. The output file name is part of
+# the key, so it is the same for every run. Leaves the output in $work/$1.c,
+# stderr in $work/$1.err and whether it was a hit in $hit.
+function run_ragel()
+{
+	name=$1; shift
+	if ! $ragel -C -s --cache-dir=$work/cache --timings=json:$work/$name.json \
+			"$@" -o $work/cache.c $work/cache.rl 2> $work/$name.err; then
+		echo "cachetests: ragel failed on run $name"
+		exit 1
+	fi
+	cp $work/cache.c $work/$name.c
+	hit=false
+	grep '"cache_hit": true' $work/$name.json > /dev/null && hit=true
+}
+
+function expect_hit()
+{
+	if [ $hit != $2 ]; then
+		echo "cachetests: run $1: expected cache hit $2, got $hit"
+		exit 1
+	fi
+}
+
+# The first run stores the output and the diagnostics.
+run_ragel miss
+expect_hit miss false
+if ! grep 'unrecognized write option' $work/miss.err > /dev/null ||
+		! grep 'num states' $work/miss.err > /dev/null; then
+	echo "cachetests: missing diagnostics on the first run"
+	exit 1
+fi
+
+# The second gives back the same output and diagnostics.
+run_ragel hit
+expect_hit hit true
+if ! cmp -s $work/miss.c $work/hit.c; then
+	echo "cachetests: output from the cache differs"
+	exit 1
+fi
+if ! cmp -s $work/miss.err $work/hit.err; then
+	echo "cachetests: diagnostics from the cache differ"
+	exit 1
+fi
+
+# A change to the options misses.
+run_ragel options -T1
+expect_hit options false
+
+# A change to the input misses.
+echo "/* changed */" >> $work/cache.rl
+run_ragel input
+expect_hit input false
+run_ragel input2
+expect_hit input2 true
+
+# A rebuilt ragel misses.
+touch -d '2001-01-01' $ragel
+run_ragel build
+expect_hit build false
+run_ragel build2
+expect_hit build2 true
+
+# A corrupt entry misses and is replaced, whether its diagnostics length is
+# past the end of the file or negative.
+for len in 99999999999 -5; do
+	for entry in $work/cache/*; do
+		printf '%s\nx' $len > $entry
+	done
+	run_ragel corrupt$len
+	expect_hit corrupt$len false
+	if ! cmp -s $work/build2.c $work/corrupt$len.c; then
+		echo "cachetests: output after a corrupt entry differs"
+		exit 1
+	fi
+	run_ragel corrupt${len}hit
+	expect_hit corrupt${len}hit true
+done
+
+rm -rf $work
+echo "cachetests: passed"
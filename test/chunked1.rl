@@ -0,0 +1,120 @@
+/*
+ * @LANG: c
+ */
+
+/*
+ * Chunks of the input mapped from every state and combined in order must end
+ * in the state of a serial run. Strings and comments keep the states apart
+ * for longer than a block, so a small max_live makes chunk_map give up and the
+ * chunk is run once the state entering it is known.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+%%{
+	machine chunked;
+
+	string = '"' ( [^"\\] | '\\' any )* '"';
+	comment = '/*' any* :>> '*/';
+
+	main := ( [a-z0-9 \n;=]+ | string | comment )*;
+}%%
+
+%% write data;
+%% write exec_chunked;
+
+#define MAX_STATES 64
+
+static int chunked_state( const char *p, int len, int piece, int max_live )
+{
+	int done, n, cs = chunked_start;
+	int map[MAX_STATES];
+
+	for ( done = 0; done < len; done += n ) {
+		n = piece < len - done ? piece : len - done;
+		if ( chunked_chunk_map( map, p + done, p + done + n, max_live ) )
+			cs = map[cs];
+		else
+			cs = chunked_chunk_run( cs, p + done, p + done + n );
+	}
+	return cs;
+}
+
+static int combined_state( const char *p, int len, int piece )
+{
+	int done, n, s;
+	int total[MAX_STATES], map[MAX_STATES];
+
+	for ( s = 0; s < MAX_STATES; s++ )
+		total[s] = s;
+
+	for ( done = 0; done < len; done += n ) {
+		n = piece < len - done ? piece : len - done;
+		if ( !chunked_chunk_map( map, p + done, p + done + n, MAX_STATES ) )
+			return -1;
+		chunked_chunk_combine( total, total, map );
+	}
+	return total[chunked_start];
+}
+
+static const int pieces[] = { 1, 7, 64, 100, 1000 };
+
+void test( const char *buf )
+{
+	int len = strlen( buf ), i, wrong = 0;
+	int cs = chunked_chunk_run( chunked_start, buf, buf + len );
+
+	for ( i = 0; i < 5; i++ ) {
+		if ( chunked_state( buf, len, pieces[i], 1 ) != cs )
+			wrong += 1;
+		if ( chunked_state( buf, len, pieces[i], MAX_STATES ) != cs )
+			wrong += 1;
+		if ( combined_state( buf, len, pieces[i] ) != cs )
+			wrong += 1;
+	}
+
+	printf( "%s %d\n",
+			cs == chunked_error ? "ERR" :
+			cs >= chunked_first_final ? "ACC" : "FIN", wrong );
+}
+
+int main()
+{
+	char buf[1024];
+
+	test( "x = 1;\n" );
+
+	/* A long string with escaped quotes. */
+	strcpy( buf, "s = \"" );
+	memset( buf + 5, 'q', 150 );
+	strcpy( buf + 155, "\\\"\\\\\";\n" );
+	test( buf );
+
+	/* A long comment with stars and quotes inside, then more after it. */
+	strcpy( buf, "/*" );
+	memset( buf + 2, '*', 200 );
+	memcpy( buf + 40, "\" @ \"", 5 );
+	strcpy( buf + 202, " */ y = \"s\";\n" );
+	test( buf );
+
+	/* Ends inside the comment. */
+	buf[150] = 0;
+	test( buf );
+
+	/* Bytes that are not allowed outside strings and comments. */
+	test( "a = @ b" );
+	memset( buf, 'z', 300 );
+	strcpy( buf + 300, " \"@\" @" );
+	test( buf );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+ACC 0
+ACC 0
+ACC 0
+FIN 0
+ERR 0
+ERR 0
+#endif
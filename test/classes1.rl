@@ -0,0 +1,88 @@
+/*
+ * @LANG: c
+ * @RAGELOPTS: --byte-classes
+ */
+
+/*
+ * Flat tables over byte classes. The machine tells apart only a few groups
+ * of bytes, some of them above 0x7f, where a signed char alphabet puts them
+ * below the printable ones.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+struct classes
+{
+	int cs;
+	int idents;
+	int numbers;
+	int wide;
+};
+
+%%{
+	machine classes;
+	variable cs fsm->cs;
+
+	action ident { fsm->idents += 1; }
+	action number { fsm->numbers += 1; }
+	action wide { fsm->wide += 1; }
+
+	utf8 = 0xc2..0xdf 0x80..0xbf | 0xe0..0xef 0x80..0xbf 0x80..0xbf;
+
+	ident = [a-zA-Z_] [a-zA-Z_0-9]* %ident;
+	number = [0-9]+ ( '.' [0-9]+ )? %number;
+	wide = utf8+ %wide;
+
+	main := ( ( ident | number | wide ) [ ,]+ )*;
+}%%
+
+%% write data;
+
+void classes_init( struct classes *fsm )
+{
+	fsm->idents = 0;
+	fsm->numbers = 0;
+	fsm->wide = 0;
+	%% write init;
+}
+
+void classes_execute( struct classes *fsm, const char *data, int len )
+{
+	const char *p = data;
+	const char *pe = data + len;
+
+	%% write exec;
+}
+
+void test( const char *buf )
+{
+	struct classes fsm;
+	classes_init( &fsm );
+	classes_execute( &fsm, buf, strlen( buf ) );
+	printf( "%d %d %d %s\n", fsm.idents, fsm.numbers, fsm.wide,
+			fsm.cs == classes_error ? "ERR" :
+			fsm.cs >= classes_first_final ? "ACC" : "FIN" );
+}
+
+int main()
+{
+	test( "abc, x1 42 3.14, _Zz9 " );
+	test( "\xc3\xa9\xc3\xa9, \xe2\x82\xac\xe2\x82\xac cafe " );
+	test( "\xc3\xa9t " );
+	test( "1.2.3 " );
+	test( "abc \xc3" );
+	test( "\xe2\x82 " );
+	test( "x\x7f " );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+3 2 0 ACC
+1 0 2 ACC
+0 0 0 ERR
+0 0 0 ERR
+1 0 0 FIN
+0 0 0 ERR
+0 0 0 ERR
+#endif
@@ -0,0 +1,85 @@
+#!/bin/bash
+
+#
+#   Copyright 2026 agent <agent@local>
+#
+
+#   This file is part of Ragel.
+#
+#   Ragel is free software; you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation; either version 2 of the License, or
+#   (at your option) any later version.
+#
+#   Ragel is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with Ragel; if not, write to the Free Software
+#   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+# Tests of the states that --split-cold marks cold. The states of main are
+# reached from the start state, some of them only through the default
+# transition of the state before. The states of recover are entered only from
+# the error action and are cold, as is the error state.
+
+work=coldtests.tmp
+rm -rf $work
+mkdir -p $work
+
+cat > $work/cold.rl <<'END'
+%%{
+	machine cold;
+
+	action recover { fhold; fgoto recover; }
+
+	recover := [^;]* ';' @{ fgoto main; };
+
+	main := ( -128..100 'z' '\n' )* $!recover;
+}%%
+
+%% write data;
+
+int cold_exec( const char *p, const char *pe )
+{
+	const char *eof = pe;
+	int cs;
+	%% write init;
+	%% write exec;
+	return cs;
+}
+END
+
+if ! ../src/ragel -C -G2 --split-cold -o $work/cold.c $work/cold.rl; then
+	echo "coldtests: ragel failed"
+	exit 1
+fi
+
+# The state labels, with the cold marker after the cold ones.
+grep '^st[0-9]*:' $work/cold.c > $work/labels
+
+start=`sed -n 's/^static const int cold_start = \([0-9]*\);/\1/p' $work/cold.c`
+recover=`sed -n 's/^static const int cold_en_recover = \([0-9]*\);/\1/p' $work/cold.c`
+
+hot=`grep -vc '_cold_cold;' $work/labels`
+cold=`grep -c '_cold_cold;' $work/labels`
+if [ "$hot" != 3 ] || [ "$cold" != 3 ]; then
+	echo "coldtests: expected 3 hot and 3 cold states, got $hot and $cold"
+	exit 1
+fi
+
+if grep "^st$start: _cold_cold;" $work/labels > /dev/null; then
+	echo "coldtests: the start state is marked cold"
+	exit 1
+fi
+
+if ! grep "^st$recover: _cold_cold;" $work/labels > /dev/null ||
+		! grep "^st0: _cold_cold;" $work/labels > /dev/null; then
+	echo "coldtests: the recover or error state is not marked cold"
+	exit 1
+fi
+
+rm -rf $work
+echo "coldtests: passed"
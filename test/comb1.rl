@@ -0,0 +1,83 @@
+/*
+ * @LANG: c
+ * @RAGELOPTS: --comb
+ */
+
+/*
+ * Flat tables with the rows of the states overlaid in one comb. Keywords give
+ * many states with a few transitions each, spread over the alphabet, next to
+ * states with wide ranges.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+struct comb
+{
+	int cs;
+	int kw;
+	int idents;
+};
+
+%%{
+	machine comb;
+	variable cs fsm->cs;
+
+	action kw { fsm->kw += 1; }
+	action ident { fsm->idents += 1; }
+
+	keyword = ( 'while' | 'when' | 'whence' | 'if' | 'iff' | 'int' |
+			'return' | 'ret' | 'zebra' | '~~' | '@at' | 'Q!' ) %kw;
+	ident = ( [a-z] [a-z0-9]* ) - keyword;
+
+	main := ( ( keyword | ident %ident ) ' '+ )*;
+}%%
+
+%% write data;
+
+void comb_init( struct comb *fsm )
+{
+	fsm->kw = 0;
+	fsm->idents = 0;
+	%% write init;
+}
+
+void comb_execute( struct comb *fsm, const char *data, int len )
+{
+	const char *p = data;
+	const char *pe = data + len;
+
+	%% write exec;
+}
+
+void test( const char *buf )
+{
+	struct comb fsm;
+	comb_init( &fsm );
+	comb_execute( &fsm, buf, strlen( buf ) );
+	printf( "%d %d %s\n", fsm.kw, fsm.idents,
+			fsm.cs == comb_error ? "ERR" :
+			fsm.cs >= comb_first_final ? "ACC" : "FIN" );
+}
+
+int main()
+{
+	test( "while when whence whenc whi " );
+	test( "if iff int in i ret return returns " );
+	test( "zebra zebr ~~ @at Q! " );
+	test( "~ " );
+	test( "Q " );
+	test( "x\xff " );
+	test( "retur" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+3 2 ACC
+5 3 ACC
+4 1 ACC
+0 0 ERR
+0 0 ERR
+0 0 ERR
+0 0 FIN
+#endif
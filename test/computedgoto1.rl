@@ -0,0 +1,98 @@
+/*
+ * @LANG: c
+ * @RAGELOPTS: --computed-goto
+ * @ALLOW_GENFLAGS: -T0 -T2 -F0
+ */
+
+/*
+ * Transition actions threaded through a table of label addresses. Some
+ * transitions run several actions in a row, and some of the actions jump with
+ * fhold, fgoto and fbreak, so the end of each action must still reach the
+ * right place.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+struct threaded
+{
+	int cs;
+	int num;
+	int sum;
+	int words;
+	int breaks;
+};
+
+%%{
+	machine threaded;
+	variable cs fsm->cs;
+
+	action clear { fsm->num = 0; }
+	action digit { fsm->num = fsm->num * 10 + ( fc - '0' ); }
+	action add { fsm->sum += fsm->num; }
+	action word { fsm->words += 1; }
+	action stop { fsm->breaks += 1; fbreak; }
+	action skip { fhold; fgoto skip; }
+
+	skip := [^;]* ';' @{ fgoto main; };
+
+	number = ( [0-9] @digit )+ >clear %add;
+	word = [a-z]+ %word;
+
+	main := (
+		( number | word ) ' ' |
+		'!' @stop |
+		'#' @skip
+	)*;
+}%%
+
+%% write data;
+
+void threaded_init( struct threaded *fsm )
+{
+	fsm->num = 0;
+	fsm->sum = 0;
+	fsm->words = 0;
+	fsm->breaks = 0;
+	%% write init;
+}
+
+void threaded_execute( struct threaded *fsm, const char *data, int len )
+{
+	const char *p = data;
+	const char *pe = data + len;
+
+	%% write exec;
+
+	/* Resume after an fbreak. */
+	if ( p < pe && fsm->cs != threaded_error )
+		threaded_execute( fsm, p, pe - p );
+}
+
+void test( const char *buf )
+{
+	struct threaded fsm;
+	threaded_init( &fsm );
+	threaded_execute( &fsm, buf, strlen( buf ) );
+	printf( "%d %d %d %s\n", fsm.sum, fsm.words, fsm.breaks,
+			fsm.cs == threaded_error ? "ERR" :
+			fsm.cs >= threaded_first_final ? "ACC" : "FIN" );
+}
+
+int main()
+{
+	test( "12 30 abc 7 " );
+	test( "1 !2 !!x 3 " );
+	test( "5 #skipped 99 ;6 " );
+	test( "4 #no end" );
+	test( "8 ?" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+49 1 0 ACC
+6 1 3 ACC
+11 0 0 ACC
+4 0 0 FIN
+8 0 0 ERR
+#endif
@@ -1,5 +1,6 @@
 /*
  * @LANG: c
+ * @ALLOW_GENFLAGS: -T0 -T1 -T2 -F0 -F1 -G0 -G1 -G2
  */
 
 #include <stdio.h>
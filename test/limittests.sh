@@ -0,0 +1,86 @@
+#!/bin/bash
+
+#
+#   Copyright 2026 agent <agent@local>
+#
+
+#   This file is part of Ragel.
+#
+#   Ragel is free software; you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation; either version 2 of the License, or
+#   (at your option) any later version.
+#
+#   Ragel is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with Ragel; if not, write to the Free Software
+#   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+# Tests of --max-states and --max-memory. A machine that blows up stops at
+# the limit, and the error names the operation, its location and the sizes of
+# its operands.
+
+work=limittests.tmp
+rm -rf $work
+mkdir -p $work
+
+# The last concatenation needs a state for every set of the last eleven
+# characters that were an 'x', which is more than two thousand. Its operands
+# have a few states each. It starts on line 3, at column 20.
+cat > $work/limit.rl <<'END'
+%%{
+	machine limit;
+main := any* . 'x' . any{10};
+}%%
+%% write data;
+END
+
+if ../src/ragel -C --max-states=100 -o $work/limit.c $work/limit.rl \
+		2> $work/states.err; then
+	echo "limittests: ragel succeeded over the state limit"
+	exit 1
+fi
+if ! grep "limit.rl:3:20: concatenation exceeded the state limit" \
+		$work/states.err > /dev/null; then
+	echo "limittests: the state limit error does not name the concatenation"
+	cat $work/states.err
+	exit 1
+fi
+if ! grep "operands have [0-9][0-9]* and [0-9][0-9]* states" \
+		$work/states.err > /dev/null; then
+	echo "limittests: the state limit error does not give the operand sizes"
+	cat $work/states.err
+	exit 1
+fi
+
+if ../src/ragel -C --max-memory=1k -o $work/limit.c $work/limit.rl \
+		2> $work/memory.err; then
+	echo "limittests: ragel succeeded over the memory limit"
+	exit 1
+fi
+if ! grep "exceeded the memory limit" $work/memory.err > /dev/null; then
+	echo "limittests: no memory limit error"
+	cat $work/memory.err
+	exit 1
+fi
+
+# Only the first operation to go over is reported.
+if [ `grep -c 'exceeded the' $work/states.err` != 1 ] ||
+		[ `grep -c 'exceeded the' $work/memory.err` != 1 ]; then
+	echo "limittests: more than one limit error"
+	exit 1
+fi
+
+# Under the limits the machine is built.
+if ! ../src/ragel -C --max-states=10000 --max-memory=64m \
+		-o $work/limit.c $work/limit.rl; then
+	echo "limittests: ragel failed under the limits"
+	exit 1
+fi
+
+rm -rf $work
+echo "limittests: passed"
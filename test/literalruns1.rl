@@ -0,0 +1,114 @@
+/*
+ * @LANG: c
+ * @RAGELOPTS: --literal-runs
+ */
+
+/*
+ * Chains of states that each match one byte, compared as a whole when enough
+ * input remains. Keywords share prefixes so runs start after a branch, and the
+ * input is also run in small pieces so that runs meet pe part way through.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+struct runs
+{
+	int cs;
+	int begins;
+	int ends;
+	int arrows;
+};
+
+%%{
+	machine runs;
+	variable cs fsm->cs;
+
+	action begin { fsm->begins += 1; }
+	action end { fsm->ends += 1; }
+	action arrow { fsm->arrows += 1; }
+
+	keyword = 'BEGIN_TRANSACTION' @begin |
+			'BEGIN_BLOCK' @begin |
+			'END_OF_TRANSMISSION' @end |
+			'-->' @arrow;
+
+	main := ( keyword ' '+ )*;
+}%%
+
+%% write data;
+
+void runs_init( struct runs *fsm )
+{
+	fsm->begins = 0;
+	fsm->ends = 0;
+	fsm->arrows = 0;
+	%% write init;
+}
+
+void runs_execute( struct runs *fsm, const char *data, int len )
+{
+	const char *p = data;
+	const char *pe = data + len;
+
+	%% write exec;
+}
+
+void test_pieces( const char *buf, int piece )
+{
+	struct runs fsm;
+	int len = strlen( buf ), done = 0;
+
+	runs_init( &fsm );
+	while ( done < len ) {
+		int n = piece < len - done ? piece : len - done;
+		runs_execute( &fsm, buf + done, n );
+		done += n;
+	}
+
+	printf( "%d %d %d %s\n", fsm.begins, fsm.ends, fsm.arrows,
+			fsm.cs == runs_error ? "ERR" :
+			fsm.cs >= runs_first_final ? "ACC" : "FIN" );
+}
+
+void test( const char *buf )
+{
+	test_pieces( buf, strlen( buf ) );
+	test_pieces( buf, 5 );
+}
+
+int main()
+{
+	test( "BEGIN_TRANSACTION BEGIN_BLOCK --> END_OF_TRANSMISSION " );
+	test( "END_OF_TRANSMISSION  --> -->  BEGIN_BLOCK " );
+
+	/* Mismatches at the start, middle and last byte of a run. */
+	test( "BEGIN_BLOCK XND_OF_TRANSMISSION " );
+	test( "BEGIN_BLOCK END_OF_TRANSXISSION " );
+	test( "BEGIN_BLOCK END_OF_TRANSMISSIOX " );
+	test( "BEGIN_TRANSACTIOn " );
+
+	/* Ends inside a run. */
+	test( "--> END_OF_TRANSM" );
+	test( "BEGIN_TRANSACTION" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+2 1 1 ACC
+2 1 1 ACC
+1 1 2 ACC
+1 1 2 ACC
+1 0 0 ERR
+1 0 0 ERR
+1 0 0 ERR
+1 0 0 ERR
+1 0 0 ERR
+1 0 0 ERR
+0 0 0 ERR
+0 0 0 ERR
+0 0 1 FIN
+0 0 1 FIN
+1 0 0 FIN
+1 0 0 FIN
+#endif
@@ -0,0 +1,101 @@
+/*
+ * @LANG: c
+ */
+
+/*
+ * The machine with its actions taken out must accept the same inputs as the
+ * full machine. Actions on transitions, EOF actions and error actions make
+ * states differ only by their actions, which the match machine merges.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+struct nums
+{
+	int ints;
+	int negs;
+	int fracs;
+	int errs;
+	int done;
+};
+
+%%{
+	machine nums;
+
+	action integer { fsm->ints += 1; }
+	action negative { fsm->ints += 1; fsm->negs += 1; }
+	action frac { fsm->fracs += 1; }
+	action reject { fsm->errs += 1; }
+	action done { fsm->done += 1; }
+
+	dec = '+' [0-9]+ %integer | '-' [0-9]+ %negative | [0-9]+ %integer;
+	frac = dec '.' [0-9]+ %frac;
+	hex = '0x' [0-9a-f]+ %integer;
+
+	main := ( ( dec | frac | hex ) ( ',' ( dec | frac | hex ) )* )
+			$!reject %/done;
+}%%
+
+%% write data;
+%% write match;
+
+int nums_run( const char *data, int len )
+{
+	struct nums n, *fsm = &n;
+	const char *p = data;
+	const char *pe = data + len;
+	const char *eof = pe;
+	int cs;
+
+	fsm->ints = fsm->negs = fsm->fracs = fsm->errs = fsm->done = 0;
+	%% write init;
+	%% write exec;
+
+	return cs >= nums_first_final;
+}
+
+static const char *inputs[] = {
+	"1",
+	"-12,3.5,0x1f",
+	"+4,-5.25,+0",
+	"+-1",
+	"0x",
+	"1.",
+	"1.5.2",
+	"-",
+	",1",
+	"7,",
+	"0xff,-0,10.01",
+	"",
+	"12a",
+};
+
+int main()
+{
+	int i;
+	for ( i = 0; i < (int)( sizeof(inputs) / sizeof(inputs[0]) ); i++ ) {
+		const char *in = inputs[i];
+		int full = nums_run( in, strlen( in ) );
+		int match = nums_match_exec( in, in + strlen( in ) ) != 0;
+		printf( "%s %s\n", full ? "ACC" : "REJ",
+				full == match ? "same" : "different" );
+	}
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+ACC same
+ACC same
+ACC same
+REJ same
+REJ same
+REJ same
+REJ same
+REJ same
+REJ same
+REJ same
+ACC same
+REJ same
+REJ same
+#endif
@@ -0,0 +1,87 @@
+/*
+ * @LANG: c
+ * @ALLOW_GENFLAGS: -T0 -F0
+ * @ALLOW_MINFLAGS: -m
+ * @MINLEVEL: -b
+ * @MEMLIMIT: 131072
+ */
+
+/*
+ * Stable minimization of a machine with many states. There are more than
+ * 46341 states before minimization, so the number of state pairs does not fit
+ * in an int, and a bit for every pair would not fit in the memory limit.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+struct min
+{
+	int cs;
+};
+
+%%{
+	machine min;
+	variable cs fsm->cs;
+
+	main := ( 
+		( 'a' . any{24000} ) | 
+		( 'b' . any{24000} )
+	) . '\n';
+}%%
+
+%% write data;
+
+void min_init( struct min *fsm )
+{
+	%% write init;
+}
+
+void min_execute( struct min *fsm, const char *_data, int _len )
+{
+	const char *p = _data;
+	const char *pe = _data+_len;
+
+	%% write exec;
+}
+
+int min_finish( struct min *fsm )
+{
+	if ( fsm->cs == min_error )
+		return -1;
+	if ( fsm->cs >= min_first_final )
+		return 1;
+	return 0;
+}
+
+struct min fsm;
+
+void test( char c, int n )
+{
+	char buf[24003];
+	buf[0] = c;
+	memset( buf + 1, 'x', n );
+	buf[n+1] = '\n';
+	min_init( &fsm );
+	min_execute( &fsm, buf, n + 2 );
+	if ( min_finish( &fsm ) > 0 )
+		printf("ACCEPT\n");
+	else
+		printf("FAIL\n");
+}
+
+int main()
+{
+	test( 'a', 24000 );
+	test( 'b', 24000 );
+	test( 'a', 23999 );
+	test( 'c', 24000 );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+ACCEPT
+ACCEPT
+FAIL
+FAIL
+#endif
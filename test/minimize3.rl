@@ -0,0 +1,104 @@
+/*
+ * @LANG: c
+ * @MINLEVEL: -c
+ */
+
+/*
+ * Minimization by partition refinement (Hopcroft). The machine has actions
+ * on transitions, EOF actions and ranges cut on different boundaries, so the
+ * initial partitions need several rounds of splitting. The output must not
+ * change with the minimization algorithm.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+struct min
+{
+	int cs;
+};
+
+%%{
+	machine min;
+	variable cs fsm->cs;
+
+	action ident { printf("ident\n"); }
+	action number { printf("number\n"); }
+	action hex { printf("hex\n"); }
+	action done { printf("done\n"); }
+
+	ident = [a-z] [a-z0-9]* %ident;
+	number = [1-9] [0-9]* %number;
+	hex = '0x' [0-9a-fA-F]+ %hex;
+
+	item = ident | number | hex | ( 'x' [0-9]{2,4} ) %ident;
+
+	main := ( item ( ' ' item )* ) %/done '\n'?;
+}%%
+
+%% write data;
+
+void min_init( struct min *fsm )
+{
+	%% write init;
+}
+
+void min_execute( struct min *fsm, const char *_data, int _len )
+{
+	const char *p = _data;
+	const char *pe = _data+_len;
+	const char *eof = pe;
+
+	%% write exec;
+}
+
+int min_finish( struct min *fsm )
+{
+	if ( fsm->cs == min_error )
+		return -1;
+	if ( fsm->cs >= min_first_final )
+		return 1;
+	return 0;
+}
+
+struct min fsm;
+
+void test( char *buf )
+{
+	int len = strlen( buf );
+	min_init( &fsm );
+	min_execute( &fsm, buf, len );
+	if ( min_finish( &fsm ) > 0 )
+		printf("ACCEPT\n");
+	else
+		printf("FAIL\n");
+}
+
+int main()
+{
+	test( "abc 123 0x1F" );
+	test( "x12 x1 x12345" );
+	test( "0x\n" );
+	test( "a1 07" );
+	test( "z9 42\n" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+ident
+number
+hex
+done
+ACCEPT
+ident
+ident
+ident
+done
+ACCEPT
+FAIL
+ident
+FAIL
+ident
+number
+ACCEPT
+#endif
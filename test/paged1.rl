@@ -0,0 +1,134 @@
+/*
+ * @LANG: c
+ * @RAGELOPTS: --paged
+ * @ALLOW_GENFLAGS: -T2 -F0 -F1
+ */
+
+/*
+ * Flat tables of a wide alphabet built from shared pages. The ranges span
+ * many pages, some pages are cut by several ranges, and keys fall below the
+ * lowest and above the highest page of a state. The start state also spans
+ * nearly the whole alphabet, up to the keys just below INT_MAX, while taking
+ * only a few ranges.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+struct paged
+{
+	int cs;
+	int words;
+	int numbers;
+	int astral;
+	int marks;
+	int tops;
+};
+
+%%{
+	machine paged;
+	variable cs fsm->cs;
+	alphtype int;
+
+	action word { fsm->words += 1; }
+	action number { fsm->numbers += 1; }
+	action astral { fsm->astral += 1; }
+	action mark { fsm->marks += 1; }
+	action top { fsm->tops += 1; }
+
+	wletter = 'a'..'z' | 'A'..'Z' | 0xc0..0x24f | 0x370..0x3ff |
+			0x4e00..0x9fff;
+	wdigit = '0'..'9' | 0x660..0x669 | 0xff10..0xff19;
+	wspace = ' ' | 0x3000;
+
+	main := (
+		wletter+ %word |
+		wdigit+ %number |
+		wspace |
+		0x10000..0x10ffff @astral |
+		-40000..-1 @mark |
+		0x7ffffff0..0x7fffffff @top
+	)**;
+}%%
+
+%% write data;
+
+void paged_init( struct paged *fsm )
+{
+	fsm->words = 0;
+	fsm->numbers = 0;
+	fsm->astral = 0;
+	fsm->marks = 0;
+	fsm->tops = 0;
+	%% write init;
+}
+
+void paged_execute( struct paged *fsm, const int *data, int len )
+{
+	const int *p = data;
+	const int *pe = data + len;
+	const int *eof = pe;
+
+	%% write exec;
+}
+
+void test( const int *buf, int len )
+{
+	struct paged fsm;
+	paged_init( &fsm );
+	paged_execute( &fsm, buf, len );
+	printf( "%d %d %d %d %d %s\n", fsm.words, fsm.numbers, fsm.astral,
+			fsm.marks, fsm.tops,
+			fsm.cs == paged_error ? "ERR" :
+			fsm.cs >= paged_first_final ? "ACC" : "FIN" );
+}
+
+/* Words across the latin, greek and cjk pages. */
+static const int words[] = {
+	'a', 0xe9, 0x24f, ' ', 0x3b1, 0x3ff, 0x3000, 0x4e00, 0x9fff, ' '
+};
+
+/* Numbers in ascii, arabic-indic and fullwidth digits. */
+static const int numbers[] = { '1', 0x660, 0xff19, ' ', 0x669, 0xff10, ' ' };
+
+/* Astral keys and negative keys between the items. */
+static const int outside[] = { 0x10000, 'x', 0x10ffff, -1, -40000, '7', ' ' };
+
+/* Keys next to the pages and ranges that are taken. */
+static const int after[] = { 'a', 0x250 };
+static const int gaps[] = { 0x36f, 0x110000, -40001, 0x2fff, 0xff1a,
+		0x7fffffef, 0x40000000 };
+
+/* Keys at the far end of the alphabet, between other items. */
+static const int top[] = { 0x7fffffff, 'a', 0x7ffffff0, ' ', 0x7ffffff7 };
+
+#define LEN( b ) ( sizeof(b) / sizeof(int) )
+
+int main()
+{
+	int i;
+
+	test( words, LEN( words ) );
+	test( numbers, LEN( numbers ) );
+	test( outside, LEN( outside ) );
+	test( after, LEN( after ) );
+	test( top, LEN( top ) );
+	for ( i = 0; i < (int)LEN( gaps ); i++ )
+		test( gaps + i, 1 );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+3 0 0 0 0 ACC
+0 2 0 0 0 ACC
+1 1 2 2 0 ACC
+0 0 0 0 0 ERR
+1 0 0 0 3 ACC
+0 0 0 0 0 ERR
+0 0 0 0 0 ERR
+0 0 0 0 0 ERR
+0 0 0 0 0 ERR
+0 0 0 0 0 ERR
+0 0 0 0 0 ERR
+0 0 0 0 0 ERR
+#endif
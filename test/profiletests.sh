@@ -0,0 +1,144 @@
+#!/bin/bash
+
+#
+#   Copyright 2026 agent <agent@local>
+#
+
+#   This file is part of Ragel.
+#
+#   Ragel is free software; you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation; either version 2 of the License, or
+#   (at your option) any later version.
+#
+#   Ragel is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with Ragel; if not, write to the Free Software
+#   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+# Round trip of --instrument and --profile-use. The machine is built with
+# --instrument in each style and run to write a profile. Every style counts
+# the same transitions under the same state numbers, so the profiles are the
+# same. The machine is then built with --profile-use in each style and must
+# give the same results. States are reordered by the profile but keep their
+# numbers, which is what lets a profile written by one build be read by the
+# next.
+
+work=profiletests.tmp
+rm -rf $work
+mkdir -p $work
+
+cc=${CC:-gcc}
+styles="-G2 -G0 -G1 -T0 -T1"
+
+cat > $work/prof.rl <<'END'
+#include <stdio.h>
+#include <string.h>
+
+%%{
+	machine prof;
+
+	action word { words += 1; }
+	action number { numbers += 1; }
+
+	main := ( [a-z]+ %word | [0-9]+ %number | ' ' | '\n' )*;
+}%%
+
+%% write data;
+
+static int words, numbers;
+
+static const char *run( const char *data )
+{
+	const char *p = data;
+	const char *pe = data + strlen( data );
+	const char *eof = pe;
+	int cs;
+
+	words = numbers = 0;
+	%% write init;
+	%% write exec;
+
+	return cs == prof_error ? "ERR" : cs >= prof_first_final ? "ACC" : "FIN";
+}
+
+static const char *inputs[] = {
+	"hello world 42\n",
+	"a1b2 c3",
+	"abc!def",
+	"",
+	"the 3 quick brown foxes jumped over 12 lazy dogs 99 times\n"
+};
+
+int main( int argc, char **argv )
+{
+	unsigned int i;
+	for ( i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++ ) {
+		const char *result = run( inputs[i] );
+		printf( "%d %d %s\n", words, numbers, result );
+	}
+
+#ifdef INSTRUMENT
+	if ( argc < 2 || prof_write_profile( argv[1] ) != 0 )
+		return 1;
+#endif
+	return 0;
+}
+END
+
+cat > $work/expected <<'END'
+2 1 ACC
+3 3 ACC
+0 0 ERR
+0 0 ACC
+9 3 ACC
+END
+
+# Build the machine with the style and options given, run it and check its
+# results. Extra arguments are passed to the program.
+function run_style()
+{
+	name=$1; style=$2; opts=$3; shift 3
+	if ! ../src/ragel -C $style $opts -o $work/$name.c $work/prof.rl; then
+		echo "profiletests: ragel failed on $name"
+		exit 1
+	fi
+	if ! $cc $cflags -o $work/$name $work/$name.c; then
+		echo "profiletests: $cc failed on $name"
+		exit 1
+	fi
+	if ! $work/$name "$@" > $work/$name.out; then
+		echo "profiletests: $name failed"
+		exit 1
+	fi
+	if ! cmp -s $work/expected $work/$name.out; then
+		echo "profiletests: $name gave the wrong results"
+		diff $work/expected $work/$name.out
+		exit 1
+	fi
+}
+
+cflags=-DINSTRUMENT
+for style in $styles; do
+	run_style instr$style $style --instrument $work/prof$style
+	if ! grep '^machine prof$' $work/prof$style > /dev/null; then
+		echo "profiletests: no profile written by $style"
+		exit 1
+	fi
+	if ! cmp -s $work/prof-G2 $work/prof$style; then
+		echo "profiletests: the profiles of -G2 and $style differ"
+		exit 1
+	fi
+done
+
+cflags=
+for style in $styles; do
+	run_style use$style $style --profile-use=$work/prof-G2
+done
+
+rm -rf $work
+echo "profiletests: passed"
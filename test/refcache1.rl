@@ -0,0 +1,84 @@
+/*
+ * @LANG: c
+ */
+
+/*
+ * Machines referenced many times. Plain machines are copied from the first
+ * walk, machines with embedded actions are walked for every reference.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+struct refcache
+{
+	int cs;
+};
+
+%%{
+	machine refcache;
+	variable cs fsm->cs;
+
+	hex = [0-9a-fA-F]+;
+	word = [a-z]+;
+	number = digit+ >{ printf("num "); } %{ printf("end "); };
+
+	pair = word ':' hex;
+	item = pair | number | ( word '=' word );
+
+	main := (
+		( item ' ' )* .
+		( hex '-' hex ) .
+		( ' ' number )?
+	) . '\n' @{ printf("ACCEPT\n"); };
+}%%
+
+%% write data;
+
+void refcache_init( struct refcache *fsm )
+{
+	%% write init;
+}
+
+void refcache_execute( struct refcache *fsm, const char *_data, int _len )
+{
+	const char *p = _data;
+	const char *pe = _data+_len;
+
+	%% write exec;
+}
+
+int refcache_finish( struct refcache *fsm )
+{
+	if ( fsm->cs == refcache_error )
+		return -1;
+	if ( fsm->cs >= refcache_first_final )
+		return 1;
+	return 0;
+}
+
+struct refcache fsm;
+
+void test( const char *buf )
+{
+	refcache_init( &fsm );
+	refcache_execute( &fsm, buf, strlen(buf) );
+	if ( refcache_finish( &fsm ) <= 0 )
+		printf("FAIL\n");
+}
+
+int main()
+{
+	test( "a:1f 12 b=c 0-ff 7\n" );
+	test( "x:ab 3 ef-10\n" );
+	test( "a:1f 12 b=c 0-fg\n" );
+	test( "a=1 0-1\n" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+num end num num end ACCEPT
+num end ACCEPT
+num end num FAIL
+FAIL
+#endif
@@ -0,0 +1,127 @@
+/*
+ * @LANG: c
+ * @RAGELOPTS: --simd
+ */
+
+/*
+ * Skip loops for states that loop back to themselves on most bytes. The
+ * exits are placed around the widths of the vector compares, and the input is
+ * run both in one piece and in small pieces so that skips stop at pe.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+struct skip
+{
+	int cs;
+	int comments;
+	int strings;
+};
+
+%%{
+	machine skip;
+	variable cs fsm->cs;
+
+	action comment { fsm->comments += 1; }
+	action string { fsm->strings += 1; }
+
+	comment = '/*' any* :>> '*/' @comment;
+	string = '"' ( [^"\\] | '\\' any )* '"' @string;
+
+	main := ( [ \t\n;] | comment | string )*;
+}%%
+
+%% write data;
+
+void skip_init( struct skip *fsm )
+{
+	fsm->comments = 0;
+	fsm->strings = 0;
+	%% write init;
+}
+
+void skip_execute( struct skip *fsm, const char *data, int len )
+{
+	const char *p = data;
+	const char *pe = data + len;
+
+	%% write exec;
+}
+
+void test_pieces( const char *buf, int piece )
+{
+	struct skip fsm;
+	int len = strlen( buf ), done = 0;
+
+	skip_init( &fsm );
+	while ( done < len ) {
+		int n = piece < len - done ? piece : len - done;
+		skip_execute( &fsm, buf + done, n );
+		done += n;
+	}
+
+	printf( "%d %d %s\n", fsm.comments, fsm.strings,
+			fsm.cs == skip_error ? "ERR" :
+			fsm.cs >= skip_first_final ? "ACC" : "FIN" );
+}
+
+void test( const char *buf )
+{
+	test_pieces( buf, strlen( buf ) );
+	test_pieces( buf, 7 );
+}
+
+int main()
+{
+	char buf[512];
+	int i;
+
+	test( "/* short */ \"str\";" );
+
+	/* Exits at offsets around 16 and 32 bytes into the skip. */
+	for ( i = 13; i <= 35; i += 11 ) {
+		memset( buf, 0, sizeof(buf) );
+		strcpy( buf, "/*" );
+		memset( buf + 2, 'x', i );
+		strcat( buf, "*/ \"" );
+		memset( buf + strlen( buf ), 'y', i + 1 );
+		strcat( buf, "\\\"\";" );
+		test( buf );
+	}
+
+	/* A long comment with stars that do not end it, and high bytes. */
+	memset( buf, 0, sizeof(buf) );
+	strcpy( buf, "/*" );
+	for ( i = 0; i < 300; i++ )
+		buf[2+i] = i % 37 == 0 ? '*' : (char)( 0x80 + i % 100 );
+	strcat( buf, "*/\n\"\xff\xfe\"" );
+	test( buf );
+
+	/* Ends inside a comment and inside a string. */
+	test( "/* unterminated comment that goes on for a while ..." );
+	test( "\"an unterminated string that goes on for a while ..." );
+
+	/* Bytes that are not allowed between the items. */
+	test( "/* ok */ x" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+1 1 ACC
+1 1 ACC
+1 1 ACC
+1 1 ACC
+1 1 ACC
+1 1 ACC
+1 1 ACC
+1 1 ACC
+1 1 ACC
+1 1 ACC
+0 0 FIN
+0 0 FIN
+0 0 FIN
+0 0 FIN
+1 0 ERR
+1 0 ERR
+#endif
@@ -0,0 +1,83 @@
+/*
+ * @LANG: c
+ * @RAGELOPTS: --split-cold
+ * @ALLOW_GENFLAGS: -G2
+ */
+
+/*
+ * Cold states moved out of line in -G2. The recovery machine is entered only
+ * from the error action, so its states are cold.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+struct cold
+{
+	int cs;
+	int good;
+	int bad;
+};
+
+%%{
+	machine cold;
+	variable cs fsm->cs;
+
+	action good { fsm->good += 1; }
+	action bad { fsm->bad += 1; }
+
+	action recover {
+		fhold;
+		fgoto recover;
+	}
+
+	line = ( [a-z]+ '=' [0-9]+ ) '\n' @good;
+
+	recover := ( [^\n]* '\n' ) @bad @{ fgoto main; };
+
+	main := line* $!recover;
+}%%
+
+%% write data;
+
+void cold_init( struct cold *fsm )
+{
+	fsm->good = 0;
+	fsm->bad = 0;
+	%% write init;
+}
+
+void cold_execute( struct cold *fsm, const char *data, int len )
+{
+	const char *p = data;
+	const char *pe = data + len;
+	const char *eof = 0;
+
+	%% write exec;
+}
+
+void test( const char *buf )
+{
+	struct cold fsm;
+	cold_init( &fsm );
+	cold_execute( &fsm, buf, strlen( buf ) );
+	printf( "%d %d %s\n", fsm.good, fsm.bad,
+			fsm.cs == cold_error ? "ERR" :
+			fsm.cs >= cold_first_final ? "ACC" : "FIN" );
+}
+
+int main()
+{
+	test( "a=1\nbb=22\n" );
+	test( "a=1\n=2\nc=3\nd==4\ne=5\n" );
+	test( "x\ny\n" );
+	test( "a=1\nb=" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+2 0 ACC
+3 2 ACC
+0 2 ACC
+1 0 FIN
+#endif
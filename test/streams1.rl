@@ -0,0 +1,103 @@
+/*
+ * @LANG: c
+ * @ALLOW_GENFLAGS: -T0 -T1 -T2 -F0 -F1
+ */
+
+/*
+ * Records run a few at a time in lockstep. There are more records than
+ * lanes, the records have very different lengths, some are empty and some
+ * fail early, so lanes pick up new records while others still run. Each
+ * record must end in the state a serial run gives.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+%%{
+	machine streams;
+
+	name = [A-Za-z] [A-Za-z0-9\-]*;
+	value = [^\r\n]*;
+
+	main := name ':' ' '* value '\r'?;
+}%%
+
+%% write data;
+%% write exec_streams;
+
+int streams_serial( const char *data, int len )
+{
+	const char *p = data;
+	const char *pe = data + len;
+	int cs;
+
+	%% write init;
+	%% write exec;
+
+	return cs;
+}
+
+static const char *records[] = {
+	"Host: example.com\r",
+	"",
+	"Content-Length: 12",
+	"X-A-Very-Long-Header-Name-That-Goes-On: with a value that is also long,"
+		" long enough to still be running when the short ones are done\r",
+	": no name",
+	"Accept:",
+	"Bad Header: space in the name",
+	"A:b",
+	"Line: two\r\nlines",
+	"User-Agent: test/1.0\r",
+	"X",
+	"Cookie:  a=1; b=2; c=3; d=4; e=5; f=6; g=7; h=8; i=9; j=10\r",
+	"9: starts with a digit",
+};
+
+#define NUM_RECORDS (int)( sizeof(records) / sizeof(records[0]) )
+
+int main()
+{
+	const char *ps[NUM_RECORDS], *pes[NUM_RECORDS];
+	int css[NUM_RECORDS], i, n;
+
+	for ( i = 0; i < NUM_RECORDS; i++ ) {
+		ps[i] = records[i];
+		pes[i] = records[i] + strlen( records[i] );
+	}
+
+	/* All of the records, then fewer records than lanes. */
+	for ( n = NUM_RECORDS; n > 0; n = n > 2 ? 2 : 0 ) {
+		for ( i = 0; i < n; i++ )
+			css[i] = -1;
+
+		streams_exec_streams( ps, pes, css, n );
+
+		for ( i = 0; i < n; i++ ) {
+			int cs = css[i];
+			printf( "%d %s%s\n", i,
+					cs == streams_error ? "ERR" :
+					cs >= streams_first_final ? "ACC" : "FIN",
+					cs == streams_serial( ps[i], pes[i] - ps[i] ) ? "" : " wrong" );
+		}
+	}
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+0 ACC
+1 FIN
+2 ACC
+3 ACC
+4 ERR
+5 ACC
+6 ERR
+7 ACC
+8 ERR
+9 ACC
+10 FIN
+11 ACC
+12 ERR
+0 ACC
+1 FIN
+#endif
@@ -0,0 +1,76 @@
+#!/bin/bash
+
+#
+#   Copyright 2026 agent <agent@local>
+#
+
+#   This file is part of Ragel.
+#
+#   Ragel is free software; you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation; either version 2 of the License, or
+#   (at your option) any later version.
+#
+#   Ragel is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with Ragel; if not, write to the Free Software
+#   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+# Tests of --timings=json. Every phase of the compilation is reported with
+# its times and peak memory, under version 1 of the schema.
+
+work=timingtests.tmp
+rm -rf $work
+mkdir -p $work
+
+cat > $work/timings.rl <<'END'
+%%{
+	machine timings;
+	main := ( [a-z]+ ' ' | [0-9]+ ( '.' [0-9]+ )? ' ' )*;
+}%%
+%% write data;
+%% write init;
+%% write exec;
+END
+
+if ! ../src/ragel -C --timings=json:$work/timings.json \
+		-o $work/timings.c $work/timings.rl; then
+	echo "timingtests: ragel failed"
+	exit 1
+fi
+
+json=$work/timings.json
+
+if ! grep '^  "schema": "ragel-timings",$' $json > /dev/null ||
+		! grep '^  "version": 1,$' $json > /dev/null; then
+	echo "timingtests: wrong schema or version"
+	exit 1
+fi
+
+if ! grep '^  "total": { "wall_s": [0-9.]*, "cpu_s": [0-9.]*, "peak_rss_bytes": [1-9][0-9]* },$' \
+		$json > /dev/null; then
+	echo "timingtests: missing or malformed total"
+	exit 1
+fi
+
+for phase in scan parse emit walk minimize analyze codegen; do
+	if ! grep "^    { \"phase\": \"$phase\"" $json > /dev/null; then
+		echo "timingtests: phase $phase is missing"
+		exit 1
+	fi
+done
+
+# Every phase has its times and the peak memory when it ended.
+phases=`grep -c '^    { "phase": ' $json`
+complete=`grep -c '^    { "phase": .*"wall_s": [0-9.]*, "cpu_s": [0-9.]*, "peak_rss_bytes": [1-9][0-9]*' $json`
+if [ "$phases" != "$complete" ]; then
+	echo "timingtests: $complete of $phases phases have times and peak memory"
+	exit 1
+fi
+
+rm -rf $work
+echo "timingtests: passed"